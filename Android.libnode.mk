@@ -42,6 +42,7 @@ LOCAL_GENERATED_SOURCES += $(GEN_NODE)
 LOCAL_CPP_EXTENSION := .cc
 LOCAL_SRC_FILES := \
   src/node_buffer.cc \
+  src/node_buffer_list.cc \
   src/node.cc \
   src/node_child_process.cc \
   src/node_constants.cc \
@@ -54,9 +55,11 @@ LOCAL_SRC_FILES := \
   src/node_os.cc \
   src/node_script.cc \
   src/node_signal_watcher.cc \
+  src/node_socket_reader.cc \
   src/node_stat_watcher.cc \
   src/node_stdio.cc \
   src/node_string.cc \
+  src/node_string_decoder.cc \
   src/node_timer.cc \
   src/node_permission.cc \
   src/timer_wrap.cc \
@@ -72,6 +75,13 @@ LOCAL_SRC_FILES := \
   deps/uv/src/ev/ev.c \
   deps/http_parser/http_parser.c
 
+# base64/hex kernels, the .neon suffix builds just this file with NEON
+ifeq ($(ARCH_ARM_HAVE_NEON),true)
+LOCAL_SRC_FILES += src/node_buffer_codec.cc.neon
+else
+LOCAL_SRC_FILES += src/node_buffer_codec.cc
+endif
+
 LOCAL_CFLAGS += \
   -fno-strict-aliasing \
   -Wno-endif-labels \
@@ -0,0 +1,37 @@
+// base64 and hex throughput of Buffer, encode (toString) and decode (write)
+// across sizes. Compare against NODE_CODEC=scalar for the vector kernels.
+var SlowBuffer = require('buffer').SlowBuffer;
+
+var SIZES = [64, 1024, 16 * 1024, 256 * 1024, 4 * 1024 * 1024];
+var BYTES_PER_RUN = 64 * 1024 * 1024;
+
+console.log('codec kernels: ' + process.binding('buffer').codecKernels);
+
+function mbps(bytes, ms) {
+  return (bytes / (1024 * 1024) / (ms / 1000)).toFixed(1);
+}
+
+SIZES.forEach(function(size) {
+  var data = new SlowBuffer(size);
+  for (var i = 0; i < size; i++) data[i] = (i * 7 + 3) & 0xff;
+  var iterations = Math.max(1, Math.floor(BYTES_PER_RUN / size));
+  var line = [size + ' bytes'];
+
+  ['base64', 'hex'].forEach(function(encoding) {
+    var string = data.toString(encoding, 0, size);
+    var target = new SlowBuffer(size);
+
+    var start = Date.now();
+    for (var i = 0; i < iterations; i++) data.toString(encoding, 0, size);
+    var encodeMs = Date.now() - start;
+
+    start = Date.now();
+    for (var i = 0; i < iterations; i++) target.write(string, 0, encoding);
+    var decodeMs = Date.now() - start;
+
+    line.push(encoding + ' encode ' + mbps(size * iterations, encodeMs) +
+        ' MB/s decode ' + mbps(size * iterations, decodeMs) + ' MB/s');
+  });
+
+  console.log(line.join('  '));
+});
@@ -0,0 +1,58 @@
+// Buffer#indexOf against the byte loop multipart and websocket parsers use
+// today: a single byte (memchr), a CRLF (short needle) and a multipart
+// boundary (Boyer-Moore-Horspool) in a 1MB body with the match at the end.
+var size = 1024 * 1024;
+var iterations = 200;
+
+var boundary = new Buffer('\r\n------------------------------7d93b2d2a0b1e');
+var body = new Buffer(size);
+for (var i = 0; i < size; i++) body[i] = 0x20 + (i * 31) % 90;
+
+function jsIndexOf(haystack, needle, from) {
+  var first = needle[0], last = haystack.length - needle.length;
+  outer:
+  for (var i = from; i <= last; i++) {
+    if (haystack[i] !== first) continue;
+    for (var j = 1; j < needle.length; j++) {
+      if (haystack[i + j] !== needle[j]) continue outer;
+    }
+    return i;
+  }
+  return -1;
+}
+
+function mbps(ms) {
+  return (size * iterations / 1048576 / (ms / 1000)).toFixed(0);
+}
+
+[new Buffer([0x0a]), new Buffer('\r\n'), boundary].forEach(function(needle) {
+  needle.copy(body, size - needle.length);
+
+  var start = Date.now();
+  for (var i = 0; i < iterations; i++) jsIndexOf(body, needle, 0);
+  var jsMs = Date.now() - start;
+
+  start = Date.now();
+  for (var i = 0; i < iterations; i++) body.indexOf(needle);
+  var nativeMs = Date.now() - start;
+
+  console.log('needle ' + needle.length + ' bytes: js ' + mbps(jsMs) +
+      ' MB/s native ' + mbps(nativeMs) + ' MB/s');
+});
+
+var a = new Buffer(size), b = new Buffer(size);
+a.fill(7);
+b.fill(7);
+
+var start = Date.now();
+for (var i = 0; i < iterations; i++) {
+  for (var j = 0; j < size && a[j] === b[j]; j++);
+}
+var jsMs = Date.now() - start;
+
+start = Date.now();
+for (var i = 0; i < iterations; i++) a.equals(b);
+var nativeMs = Date.now() - start;
+
+console.log('equals: js ' + mbps(jsMs) + ' MB/s native ' + mbps(nativeMs) +
+    ' MB/s');
@@ -0,0 +1,41 @@
+// Collecting a body of many chunks and flattening it: an array of buffers
+// copied together in JS (what stream consumers do) against BufferList.
+var BufferList = require('buffer').BufferList;
+
+var chunkSize = 1460;
+var chunks = 700; // ~1MB body
+var iterations = 500;
+
+var data = [];
+for (var i = 0; i < chunks; i++) {
+  var chunk = new Buffer(chunkSize);
+  chunk.fill(i & 0xff, 0, chunkSize);
+  data.push(chunk);
+}
+
+function bench(name, fn) {
+  var start = Date.now();
+  for (var i = 0; i < iterations; i++) fn();
+  var ms = Date.now() - start;
+  console.log(name + ': ' + (ms / iterations).toFixed(3) + ' ms/body');
+}
+
+bench('array + copy', function() {
+  var buffers = [], nread = 0;
+  for (var i = 0; i < chunks; i++) {
+    buffers.push(data[i]);
+    nread += data[i].length;
+  }
+  var body = new Buffer(nread), n = 0;
+  buffers.forEach(function(b) {
+    b.copy(body, n, 0, b.length);
+    n += b.length;
+  });
+  return body;
+});
+
+bench('BufferList', function() {
+  var list = new BufferList();
+  for (var i = 0; i < chunks; i++) list.push(data[i]);
+  return list.concat();
+});
@@ -0,0 +1,43 @@
+// Typed reads and writes on a Buffer: floats and doubles through the native
+// accessors against buffer_ieee754.js (what Buffer used before), with the
+// integer accessors alongside for scale.
+var IEEE754 = require('buffer_ieee754');
+
+var iterations = 1000000;
+var buffer = new Buffer(64);
+buffer.fill(0x41, 0, buffer.length);
+
+function bench(name, fn) {
+  var start = Date.now();
+  for (var i = 0; i < iterations; i++) fn(i & 31);
+  var ms = Date.now() - start;
+  console.log(name + ': ' + (ms * 1e6 / iterations).toFixed(0) + ' ns/op');
+}
+
+bench('readUInt32 big', function(offset) {
+  return buffer.readUInt32(offset, 'big');
+});
+bench('readInt16 little', function(offset) {
+  return buffer.readInt16(offset, 'little');
+});
+
+['big', 'little'].forEach(function(endian) {
+  bench('readFloat ' + endian + ' (js)', function(offset) {
+    return IEEE754.readIEEE754(buffer, offset, endian, 23, 4);
+  });
+  bench('readFloat ' + endian, function(offset) {
+    return buffer.readFloat(offset, endian);
+  });
+  bench('readDouble ' + endian + ' (js)', function(offset) {
+    return IEEE754.readIEEE754(buffer, offset, endian, 52, 8);
+  });
+  bench('readDouble ' + endian, function(offset) {
+    return buffer.readDouble(offset, endian);
+  });
+  bench('writeDouble ' + endian + ' (js)', function(offset) {
+    IEEE754.writeIEEE754(buffer, offset * 1.5, offset, endian, 52, 8);
+  });
+  bench('writeDouble ' + endian, function(offset) {
+    buffer.writeDouble(offset * 1.5, offset, endian);
+  });
+});
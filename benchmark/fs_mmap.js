@@ -0,0 +1,45 @@
+// Serving a large read-only file: fs.readFileSync (copy into a new buffer)
+// against fs.mmap (pages mapped in on first touch), both followed by one
+// pass over the data. Give a file as the argument or a 64MB one is made.
+var fs = require('fs');
+
+var file = process.argv[2];
+var tmp = !file;
+if (tmp) {
+  file = '/tmp/fs_mmap_bench.bin';
+  var chunk = new Buffer(1024 * 1024);
+  for (var i = 0; i < chunk.length; i++) chunk[i] = i & 0xff;
+  var fd = fs.openSync(file, 'w');
+  for (var i = 0; i < 64; i++) fs.writeSync(fd, chunk, 0, chunk.length, null);
+  fs.closeSync(fd);
+}
+
+var size = fs.statSync(file).size;
+var iterations = 20;
+
+function touch(b) {
+  var sum = 0;
+  for (var i = 0; i < b.length; i += 4096) sum += b[i];
+  return sum;
+}
+
+function run(name, fn) {
+  var start = Date.now();
+  for (var i = 0; i < iterations; i++) touch(fn());
+  var ms = Date.now() - start;
+  console.log(name + ': ' + (ms / iterations).toFixed(2) + ' ms/pass ' +
+      (size * iterations / 1048576 / (ms / 1000)).toFixed(0) + ' MB/s');
+}
+
+run('readFileSync', function() {
+  return fs.readFileSync(file);
+});
+
+run('mmap', function() {
+  var fd = fs.openSync(file, 'r');
+  var b = fs.mmap(fd, 0, null, 'r', { advise: ['sequential', 'willneed'] });
+  fs.closeSync(fd);
+  return b;
+});
+
+if (tmp) fs.unlinkSync(file);
@@ -0,0 +1,58 @@
+// Idle cost of the libev thread and latency of the first request after
+// an idle period.
+//
+// While this script spins on the main thread the loop has no active
+// watchers, so the only thing running in the background is the libev
+// thread waiting for work. Its context switches over that window are the
+// idle wakeups. Right after that the first timer and the first fs request
+// are issued, and the time till their callbacks run is the first-I/O latency.
+//
+// usage: node benchmark/idle_wakeups.js [idle ms]
+var fs = require('fs');
+
+var IDLE_MS = parseInt(process.argv[2], 10) || 2000;
+
+// voluntary context switches of every thread but the main one
+function backgroundSwitches() {
+  var total = 0;
+  fs.readdirSync('/proc/self/task').forEach(function(tid) {
+    if (tid == process.pid) return;
+    var status;
+    try {
+      status = fs.readFileSync('/proc/self/task/' + tid + '/status', 'ascii');
+    } catch (e) {
+      return; // thread went away
+    }
+    var m = /voluntary_ctxt_switches:\s+(\d+)/.exec(status);
+    if (m) total += parseInt(m[1], 10);
+  });
+  return total;
+}
+
+var before = backgroundSwitches();
+var start = Date.now();
+while (Date.now() - start < IDLE_MS);
+var switches = backgroundSwitches() - before;
+
+console.log('idle window: %d ms', IDLE_MS);
+console.log('idle wakeups: %d (%d/s)', switches,
+            Math.round(switches * 1000 / IDLE_MS));
+
+function report() {
+  if (typeof test != 'undefined' && test.loopStats) {
+    console.log('loop stats: %j', test.loopStats());
+  }
+}
+
+var pending = 2;
+var issued = Date.now();
+setTimeout(function() {
+  console.log('first timer latency: %d ms', Date.now() - issued);
+  if (--pending == 0) report();
+}, 0);
+
+fs.stat(__filename, function(err) {
+  if (err) throw err;
+  console.log('first fs latency: %d ms', Date.now() - issued);
+  if (--pending == 0) report();
+});
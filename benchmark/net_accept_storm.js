@@ -0,0 +1,58 @@
+// Connection storm: waves of short lived connections against one server, or
+// against WORKERS processes sharing the port through reusePort.
+//
+//   node benchmark/net_accept_storm.js [workers]
+var net = require('net');
+var spawn = require('child_process').spawn;
+
+var PORT = 12346;
+var WAVE = 500;
+var WAVES = 40;
+
+if (process.argv[2] == 'worker') {
+  net.createServer({ reusePort: true }, function(socket) {
+    socket.end('x');
+  }).listen(PORT, '127.0.0.1');
+  return;
+}
+
+var workers = [];
+var nworkers = parseInt(process.argv[2], 10) || 0;
+
+if (nworkers) {
+  for (var i = 0; i < nworkers; i++) {
+    workers.push(spawn(process.execPath, [__filename, 'worker']));
+  }
+  setTimeout(run, 1000);
+} else {
+  net.createServer(function(socket) {
+    socket.end('x');
+  }).listen(PORT, '127.0.0.1', run);
+}
+
+function run() {
+  var done = 0;
+  var wave = 0;
+  var start = Date.now();
+
+  function onEnd() {
+    if (++done % WAVE) return;
+    if (++wave < WAVES) return storm();
+
+    var ms = Date.now() - start;
+    console.log((nworkers || 1) + ' server(s): ' +
+        Math.round(done / (ms / 1000)) + ' connections/s');
+    workers.forEach(function(w) { w.kill(); });
+    process.exit(0);
+  }
+
+  function storm() {
+    for (var i = 0; i < WAVE; i++) {
+      var c = net.createConnection(PORT, '127.0.0.1');
+      c.on('data', function() {});
+      c.on('end', onEnd);
+    }
+  }
+
+  storm();
+}
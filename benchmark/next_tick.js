@@ -0,0 +1,25 @@
+// nextTick throughput, a chain of ticks and a wide batch of them
+console.log("wait...");
+var N = 1000000;
+
+var chained = 0;
+var begin = new Date();
+(function next() {
+  if (++chained < N) {
+    process.nextTick(next);
+    return;
+  }
+
+  var chainEnd = new Date();
+  var done = 0;
+  for (var i = 0; i < N; i++) {
+    process.nextTick(function () {
+      if (++done == N) {
+        var end = new Date();
+        console.log("smaller is better");
+        console.log("chained: %d", chainEnd - begin);
+        console.log("batch: %d", end - chainEnd);
+      }
+    });
+  }
+})();
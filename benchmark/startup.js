@@ -18,6 +18,11 @@ function startNode() {
     } else{
       var duration = +new Date - start;
       console.log('Started node %d times in %s ms. %d ms / start.', starts, duration, duration / starts);
+
+      // bootstrap of this node instance alone (Init/Load), under proteus
+      if (typeof test !== 'undefined' && test.instanceStats) {
+        console.log('Instance bootstrap %s ms.', test.instanceStats().startup.toFixed(3));
+      }
     }
   });
 }
@@ -0,0 +1,53 @@
+// string <-> Buffer throughput for ASCII, latin1 and multi-byte text, in the
+// encodings that have an ASCII fast path. Compare against NODE_CODEC=scalar.
+var SlowBuffer = require('buffer').SlowBuffer;
+
+var SIZES = [64, 1024, 16 * 1024, 256 * 1024];
+var CHARS_PER_RUN = 32 * 1024 * 1024;
+
+var INPUTS = {
+  ascii: function(i) { return 32 + i % 95; },
+  latin1: function(i) { return i % 8 ? 32 + i % 95 : 0xC0 + i % 64; },
+  multibyte: function(i) { return i % 8 ? 32 + i % 95 : 0x4E00 + i % 512; }
+};
+
+console.log('codec kernels: ' + process.binding('buffer').codecKernels);
+
+function mbps(bytes, ms) {
+  return (bytes / (1024 * 1024) / (ms / 1000)).toFixed(1);
+}
+
+function run(label, bytes, iterations, fn) {
+  var start = Date.now();
+  for (var i = 0; i < iterations; i++) fn();
+  return label + ' ' + mbps(bytes * iterations, Date.now() - start) + ' MB/s';
+}
+
+Object.keys(INPUTS).forEach(function(name) {
+  SIZES.forEach(function(size) {
+    var chars = [];
+    for (var i = 0; i < size; i++) chars.push(String.fromCharCode(INPUTS[name](i)));
+    var string = chars.join('');
+    var iterations = Math.max(1, Math.floor(CHARS_PER_RUN / size));
+
+    var utf8 = new Buffer(string, 'utf8');
+    var binary = new Buffer(string, 'binary');
+    var target = new SlowBuffer(utf8.length);
+    var line = [name + ' ' + size + ' chars'];
+
+    line.push(run('utf8 write', utf8.length, iterations, function() {
+      target.utf8Write(string, 0);
+    }));
+    line.push(run('utf8 slice', utf8.length, iterations, function() {
+      utf8.toString('utf8');
+    }));
+    line.push(run('binary write', size, iterations, function() {
+      target.binaryWrite(string, 0);
+    }));
+    line.push(run('binary slice', size, iterations, function() {
+      binary.toString('binary');
+    }));
+
+    console.log(line.join('  '));
+  });
+});
@@ -0,0 +1,32 @@
+// StringDecoder#write throughput on socket sized chunks, ASCII and mixed
+// text, with the chunks cut through multi-byte characters.
+var StringDecoder = require('string_decoder').StringDecoder;
+
+var chunkSize = 1460;
+var total = 64 * 1024 * 1024;
+
+function run(name, text, encoding) {
+  var data = new Buffer(text, encoding);
+  var chunks = [];
+  for (var i = 0; i + chunkSize <= data.length; i += chunkSize) {
+    chunks.push(data.slice(i, i + chunkSize));
+  }
+
+  var decoder = new StringDecoder(encoding);
+  var bytes = 0;
+  var start = Date.now();
+  while (bytes < total) {
+    for (var i = 0; i < chunks.length; i++) decoder.write(chunks[i]);
+    bytes += chunks.length * chunkSize;
+  }
+  var ms = Date.now() - start;
+  console.log(name + ': ' + (bytes / 1048576 / (ms / 1000)).toFixed(0) +
+      ' MB/s');
+}
+
+var ascii = new Array(20000).join('GET /index.html HTTP/1.1\r\n');
+var mixed = new Array(20000).join('naïve café – 東京 ');
+
+run('utf8 ascii', ascii, 'utf8');
+run('utf8 mixed', mixed, 'utf8');
+run('ucs2 mixed', mixed, 'ucs2');
@@ -45,6 +45,8 @@ set(node_sources
   src/node_main.cc
   src/node.cc
   src/node_buffer.cc
+  src/node_buffer_codec.cc
+  src/node_buffer_list.cc
   src/node_javascript.cc
   src/node_extensions.cc
   src/node_http_parser.cc
@@ -56,6 +58,7 @@ set(node_sources
   src/node_events.cc
   src/node_file.cc
   src/node_signal_watcher.cc
+  src/node_socket_reader.cc
   src/node_stat_watcher.cc
   src/node_stdio.cc
   src/node_timer.cc
@@ -63,6 +66,7 @@ set(node_sources
   src/node_os.cc
   src/node_dtrace.cc
   src/node_string.cc
+  src/node_string_decoder.cc
   src/node_natives.h
   ${node_extra_src})
 
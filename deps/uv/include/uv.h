@@ -283,6 +283,14 @@ int uv_tcp_init(uv_tcp_t* handle);
 int uv_tcp_bind(uv_tcp_t* handle, struct sockaddr_in);
 int uv_tcp_bind6(uv_tcp_t* handle, struct sockaddr_in6);
 
+/*
+ * Lets several sockets, in one or more processes, bind and listen on the
+ * same address and port; the kernel spreads incoming connections over them.
+ * Call before uv_tcp_bind. Fails with UV_ENOTSUP where the platform has no
+ * SO_REUSEPORT.
+ */
+int uv_tcp_reuseport(uv_tcp_t* handle, int enable);
+
 int uv_tcp_connect(uv_req_t* req, struct sockaddr_in);
 int uv_tcp_connect6(uv_req_t* req, struct sockaddr_in6);
 
@@ -2137,6 +2137,7 @@ void noinline
 ev_invoke_pending (EV_P)
 {
   int pri;
+  void *owner = current_owner;
 
   for (pri = NUMPRI; pri--; )
     while (pendingcnt [pri])
@@ -2144,9 +2145,97 @@ ev_invoke_pending (EV_P)
         ANPENDING *p = pendings [pri] + --pendingcnt [pri];
 
         p->w->pending = 0;
+        /* proteus: watchers started from a callback belong to its owner */
+        current_owner = p->w->owner;
         EV_CB_INVOKE (p->w, p->events);
         EV_FREQUENT_CHECK;
       }
+
+  current_owner = owner;
+}
+
+/* proteus: per owner view of the pending queue, lets the embedder drain */
+/* the pending watchers of several owners round-robin */
+unsigned int
+ev_pending_count_owner (EV_P_ void *owner)
+{
+  int pri, i;
+  unsigned int count = 0;
+
+  for (pri = NUMPRI; pri--; )
+    for (i = 0; i < pendingcnt [pri]; ++i)
+      if (pendings [pri][i].w->owner == owner && pendings [pri][i].w != (W)&pending_w)
+        ++count;
+
+  return count;
+}
+
+/* proteus: slot level access to the pending queue, lets the embedder sort */
+/* the pending watchers by owner in one pass and then invoke them owner by */
+/* owner (ev_pending_count_owner per owner would be a pass each). slots keep */
+/* their index until ev_pending_compact, callbacks only append new ones */
+int
+ev_pending_slots (EV_P_ int pri)
+{
+  return pendingcnt [pri];
+}
+
+/* returns 0 if the slot was invoked or cleared already */
+int
+ev_pending_slot_owner (EV_P_ int pri, int slot, void **owner)
+{
+  W w = pendings [pri][slot].w;
+
+  if (w == (W)&pending_w)
+    return 0;
+
+  *owner = w->owner;
+  return 1;
+}
+
+/* returns 0 if the slot was invoked or cleared (by an earlier callback) */
+int
+ev_invoke_pending_slot (EV_P_ int pri, int slot)
+{
+  W w = pendings [pri][slot].w;
+  int events = pendings [pri][slot].events;
+  void *prev = current_owner;
+
+  if (w == (W)&pending_w)
+    return 0;
+
+  pendings [pri][slot].w = (W)&pending_w;
+  w->pending = 0;
+  current_owner = w->owner;
+  EV_CB_INVOKE (w, events);
+  current_owner = prev;
+
+  return 1;
+}
+
+/* drop the slots invoked by ev_invoke_pending_slot (and the ones */
+/* ev_clear_pending left behind), keeping the order of the rest */
+void noinline
+ev_pending_compact (EV_P)
+{
+  int pri, i, j;
+
+  for (pri = NUMPRI; pri--; )
+    {
+      j = 0;
+
+      for (i = 0; i < pendingcnt [pri]; ++i)
+        if (pendings [pri][i].w != (W)&pending_w)
+          {
+            pendings [pri][j] = pendings [pri][i];
+            pendings [pri][j].w->pending = j + 1;
+            ++j;
+          }
+
+      pendingcnt [pri] = j;
+    }
+
+  EV_FREQUENT_CHECK;
 }
 
 #if EV_IDLE_ENABLE
@@ -2549,7 +2638,8 @@ ev_break (EV_P_ int how)
 void
 ev_ref (EV_P)
 {
-  ++activecnt;
+  if (expect_false (++activecnt == 1) && activate_cb)
+    activate_cb (EV_A);
 }
 
 void
@@ -2563,6 +2653,74 @@ ev_activecnt(EV_P) {
   return activecnt;
 }
 
+/* proteus: fd an embedder can wait on for the loop to have work (epoll */
+/* and kqueue only, -1 otherwise), see also ev_next_timeout */
+int
+ev_backend_fd (EV_P)
+{
+  return backend_fd;
+}
+
+/* proteus: time till ev_run has to be called again even if the backend */
+/* fd did not become readable (timers, idle watchers, fd changes that are */
+/* not reified yet), -1. if it is enough to wait for the backend fd */
+ev_tstamp
+ev_next_timeout (EV_P)
+{
+  ev_tstamp waittime = -1.;
+
+  if (fdchangecnt || idleall || ev_pending_count (EV_A))
+    return 0.;
+
+  time_update (EV_A_ 1e100);
+
+  if (timercnt)
+    {
+      ev_tstamp to = ANHE_at (timers [HEAP0]) - mn_now;
+      waittime = to > 0. ? to : 0.;
+    }
+
+#if EV_PERIODIC_ENABLE
+  if (periodiccnt)
+    {
+      ev_tstamp to = ANHE_at (periodics [HEAP0]) - ev_rt_now;
+      if (to < 0.) to = 0.;
+      if (waittime < 0. || waittime > to) waittime = to;
+    }
+#endif
+
+  return waittime;
+}
+
+/* proteus: lets a thread that waits for the loop to get its first */
+/* watcher block instead of polling ev_activecnt */
+void
+ev_set_activate_cb (EV_P_ void (*activate)(EV_P))
+{
+  activate_cb = activate;
+}
+
+/* proteus: watchers started from now on (outside of a callback, which */
+/* passes on the owner of its own watcher) are tagged with owner */
+void
+ev_set_owner (EV_P_ void *owner)
+{
+  current_owner = owner;
+}
+
+void *
+ev_owner (EV_P)
+{
+  return current_owner;
+}
+
+/* proteus: lets a thread that modified the loop while another thread */
+/* is blocked in backend_poll find out if it has to wake that thread up */
+unsigned int
+ev_modcount(EV_P) {
+  return modcount;
+}
+
 void
 ev_now_update (EV_P)
 {
@@ -2655,6 +2813,8 @@ ev_start (EV_P_ W w, int active)
 {
   pri_adjust (EV_A_ w);
   w->active = active;
+  w->owner = current_owner;
+  ++modcount;
   ev_ref (EV_A);
 }
 
@@ -2662,6 +2822,7 @@ inline_size void
 ev_stop (EV_P_ W w)
 {
   ev_unref (EV_A);
+  ++modcount;
   w->active = 0;
 }
 
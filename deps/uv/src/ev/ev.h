@@ -264,6 +264,7 @@ enum {
 #define EV_WATCHER(type)			\
   int active; /* private */			\
   int pending; /* private */			\
+  void *owner; /* private, proteus */		\
   EV_DECL_PRIORITY /* private */		\
   EV_COMMON /* rw */				\
   EV_CB_DECLARE (type) /* private */
@@ -662,6 +663,7 @@ void ev_resume  (EV_P);
 #define ev_init(ev,cb_) do {			\
   ((ev_watcher *)(void *)(ev))->active  =	\
   ((ev_watcher *)(void *)(ev))->pending = 0;	\
+  ((ev_watcher *)(void *)(ev))->owner = 0;	\
   ev_set_priority ((ev), 0);			\
   ev_set_cb ((ev), cb_);			\
 } while (0)
@@ -824,6 +826,17 @@ void ev_async_send     (EV_P_ ev_async *w);
 #endif
 
 int ev_activecnt(EV_P);
+unsigned int ev_modcount(EV_P); /* number of watcher starts/stops so far */
+void ev_set_activate_cb (EV_P_ void (*activate)(EV_P)); /* activecnt went from 0 to 1 */
+int ev_backend_fd (EV_P); /* epoll/kqueue fd for embedders, -1 if none */
+ev_tstamp ev_next_timeout (EV_P); /* seconds till ev_run is needed without fd activity, -1. if none */
+void ev_set_owner (EV_P_ void *owner); /* tag watchers started from now on with owner */
+void *ev_owner (EV_P);
+unsigned int ev_pending_count_owner (EV_P_ void *owner); /* pending watchers of owner */
+int ev_pending_slots (EV_P_ int pri); /* pending slots of priority pri (0 .. EV_MAXPRI - EV_MINPRI) */
+int ev_pending_slot_owner (EV_P_ int pri, int slot, void **owner); /* 0 if the slot was invoked/cleared */
+int ev_invoke_pending_slot (EV_P_ int pri, int slot); /* 0 if the slot was invoked/cleared */
+void ev_pending_compact (EV_P); /* drop invoked/cleared slots, renumbers the rest */
 
 EV_CPP(})
 
@@ -199,5 +199,14 @@ VAR (acquire_cb, void (*acquire_cb)(EV_P))
 VAR (invoke_cb , void (*invoke_cb) (EV_P))
 #endif
 
+/* proteus: bumped on every watcher start/stop, see ev_modcount */
+VARx(unsigned int, modcount)
+
+/* proteus: called when activecnt goes from 0 to 1, see ev_set_activate_cb */
+VAR (activate_cb, void (*activate_cb)(EV_P))
+
+/* proteus: owner given to the watchers started from now on, see ev_set_owner */
+VARx(void *, current_owner)
+
 #undef VARx
 
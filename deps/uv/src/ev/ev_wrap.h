@@ -96,6 +96,9 @@
 #define release_cb ((loop)->release_cb)
 #define acquire_cb ((loop)->acquire_cb)
 #define invoke_cb ((loop)->invoke_cb)
+#define modcount ((loop)->modcount)
+#define activate_cb ((loop)->activate_cb)
+#define current_owner ((loop)->current_owner)
 #else
 #undef EV_WRAP_H
 #undef now_floor
@@ -193,4 +196,7 @@
 #undef release_cb
 #undef acquire_cb
 #undef invoke_cb
+#undef modcount
+#undef activate_cb
+#undef current_owner
 #endif
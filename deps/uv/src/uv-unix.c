@@ -39,6 +39,10 @@
 #include <mach-o/dyld.h> /* _NSGetExecutablePath */
 #endif
 
+#if defined(__linux__)
+#include <sys/syscall.h> /* __NR_accept4 */
+#endif
+
 #if defined(__FreeBSD__)
 #include <sys/sysctl.h>
 #endif
@@ -73,9 +77,18 @@ enum {
   UV_CLOSED   = 0x00000002, /* close(2) finished. */
   UV_READING  = 0x00000004, /* uv_read_start() called. */
   UV_SHUTTING = 0x00000008, /* uv_shutdown() called but not complete. */
-  UV_SHUT     = 0x00000010  /* Write side closed. */
+  UV_SHUT     = 0x00000010, /* Write side closed. */
+  UV_REUSEPORT = 0x00000020 /* uv_tcp_reuseport() called. */
 };
 
+/* Most connections uv__server_io() accepts per readiness event. */
+#define UV__ACCEPT_BATCH 32
+
+/* Kept open so that on EMFILE there is a descriptor to give up for
+ * accepting (and closing) the pending connections, see uv__emfile_trick().
+ */
+static int uv__reserved_fd = -1;
+
 
 void uv_flag_set(uv_handle_t* handle, int flag) {
   handle->flags |= flag;
@@ -138,6 +151,7 @@ static uv_err_code uv_translate_sys_error(int sys_errno) {
     case ECONNREFUSED: return UV_ECONNREFUSED;
     case EADDRINUSE: return UV_EADDRINUSE;
     case EADDRNOTAVAIL: return UV_EADDRNOTAVAIL;
+    case ENOTSUP: return UV_ENOTSUP;
     default: return UV_UNKNOWN;
   }
 }
@@ -289,6 +303,16 @@ int uv__bind(uv_tcp_t* tcp, int domain, struct sockaddr* addr, int addrsize) {
       close(fd);
       return -2;
     }
+
+#ifdef SO_REUSEPORT
+    if (uv_flag_is_set((uv_handle_t*)tcp, UV_REUSEPORT)) {
+      int yes = 1;
+      if (setsockopt(fd, SOL_SOCKET, SO_REUSEPORT, &yes, sizeof yes)) {
+        uv_err_new((uv_handle_t*)tcp, errno);
+        return -1;
+      }
+    }
+#endif
   }
 
   assert(tcp->fd >= 0);
@@ -332,21 +356,50 @@ int uv_tcp_bind6(uv_tcp_t* tcp, struct sockaddr_in6 addr) {
 }
 
 
-int uv_tcp_open(uv_tcp_t* tcp, int fd) {
+int uv_tcp_reuseport(uv_tcp_t* tcp, int enable) {
+#ifdef SO_REUSEPORT
+  int yes = enable ? 1 : 0;
+
+  if (tcp->fd >= 0 &&
+      setsockopt(tcp->fd, SOL_SOCKET, SO_REUSEPORT, &yes, sizeof yes)) {
+    uv_err_new((uv_handle_t*)tcp, errno);
+    return -1;
+  }
+
+  if (enable) {
+    uv_flag_set((uv_handle_t*)tcp, UV_REUSEPORT);
+  } else {
+    uv_flag_unset((uv_handle_t*)tcp, UV_REUSEPORT);
+  }
+
+  return 0;
+#else
+  uv_err_new((uv_handle_t*)tcp, ENOTSUP);
+  return -1;
+#endif
+}
+
+
+/* accepted: the fd came from uv__accept() so it is non-blocking already,
+ * and SO_REUSEADDR means nothing for it.
+ */
+static int uv__tcp_open(uv_tcp_t* tcp, int fd, int accepted) {
   int yes;
   int r;
 
   assert(fd >= 0);
   tcp->fd = fd;
 
-  /* Set non-blocking. */
-  yes = 1;
-  r = fcntl(fd, F_SETFL, O_NONBLOCK);
-  assert(r == 0);
+  if (!accepted) {
+    /* Set non-blocking. */
+    yes = 1;
+    r = fcntl(fd, F_SETFL, O_NONBLOCK);
+    assert(r == 0);
 
-  /* Reuse the port address. */
-  r = setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &yes, sizeof(int));
-  assert(r == 0);
+    /* Reuse the port address. */
+    r = setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &yes, sizeof(int));
+    assert(r == 0);
+  }
 
   /* Associate the fd with each ev_io watcher. */
   ev_io_set(&tcp->read_watcher, fd, EV_READ);
@@ -363,10 +416,97 @@ int uv_tcp_open(uv_tcp_t* tcp, int fd) {
 }
 
 
+int uv_tcp_open(uv_tcp_t* tcp, int fd) {
+  return uv__tcp_open(tcp, fd, 0);
+}
+
+
+/* accept(2) returning a non-blocking, close-on-exec fd. Done in one syscall
+ * with accept4() where the kernel has it, with fcntl() otherwise.
+ */
+static int uv__accept(int sockfd, struct sockaddr* saddr, socklen_t* slen) {
+  int fd;
+  int saved_errno;
+
+#if defined(__linux__) && defined(__NR_accept4) && defined(SOCK_NONBLOCK)
+  static int no_accept4;
+
+  if (!no_accept4) {
+    fd = syscall(__NR_accept4, sockfd, saddr, slen,
+                 SOCK_NONBLOCK | SOCK_CLOEXEC);
+    if (fd >= 0 || errno != ENOSYS) {
+      return fd;
+    }
+    no_accept4 = 1;
+  }
+#endif
+
+  fd = accept(sockfd, saddr, slen);
+  if (fd < 0) {
+    return -1;
+  }
+
+  if (fcntl(fd, F_SETFL, O_NONBLOCK) || fcntl(fd, F_SETFD, FD_CLOEXEC)) {
+    saved_errno = errno;
+    close(fd);
+    errno = saved_errno;
+    return -1;
+  }
+
+  return fd;
+}
+
+
+static void uv__reserve_fd() {
+  if (uv__reserved_fd >= 0) {
+    return;
+  }
+
+  /* Like the accepted fds, not to be inherited by child processes. */
+#ifdef O_CLOEXEC
+  uv__reserved_fd = open("/dev/null", O_RDONLY | O_CLOEXEC);
+#else
+  uv__reserved_fd = open("/dev/null", O_RDONLY);
+  if (uv__reserved_fd >= 0) {
+    fcntl(uv__reserved_fd, F_SETFD, FD_CLOEXEC);
+  }
+#endif
+}
+
+
+/* Out of descriptors: give up the reserved one, accept and close what is
+ * pending so the peers get a reset instead of hanging in the backlog (and
+ * the level triggered watcher doesn't spin), then take it back.
+ */
+static void uv__emfile_trick(uv_tcp_t* tcp) {
+  int fd;
+  int i;
+
+  if (uv__reserved_fd < 0) {
+    return;
+  }
+
+  close(uv__reserved_fd);
+  uv__reserved_fd = -1;
+
+  for (i = 0; i < UV__ACCEPT_BATCH; i++) {
+    fd = accept(tcp->fd, NULL, NULL);
+    if (fd < 0) {
+      if (errno == EINTR || errno == ECONNABORTED) continue;
+      break;
+    }
+    close(fd);
+  }
+
+  uv__reserve_fd();
+}
+
+
 void uv__server_io(EV_P_ ev_io* watcher, int revents) {
   int fd;
+  int i;
   struct sockaddr_storage addr;
-  socklen_t addrlen = sizeof(struct sockaddr_storage);
+  socklen_t addrlen;
   uv_tcp_t* tcp = watcher->data;
 
   assert(watcher == &tcp->read_watcher ||
@@ -380,20 +520,28 @@ void uv__server_io(EV_P_ ev_io* watcher, int revents) {
     return;
   }
 
-  while (1) {
+  /* At most UV__ACCEPT_BATCH connections, the watcher is level triggered so
+   * the rest of a large backlog comes on the next loop iteration, after the
+   * other watchers had their turn.
+   */
+  for (i = 0; i < UV__ACCEPT_BATCH; i++) {
     assert(tcp->accepted_fd < 0);
-    fd = accept(tcp->fd, (struct sockaddr*)&addr, &addrlen);
+    addrlen = sizeof(struct sockaddr_storage);
+    fd = uv__accept(tcp->fd, (struct sockaddr*)&addr, &addrlen);
 
     if (fd < 0) {
-      if (errno == EAGAIN) {
+      if (errno == EAGAIN || errno == EWOULDBLOCK) {
         /* No problem. */
         return;
-      } else if (errno == EMFILE) {
-        /* TODO special trick. unlock reserved socket, accept, close. */
+      } else if (errno == EINTR || errno == ECONNABORTED) {
+        continue;
+      } else if (errno == EMFILE || errno == ENFILE) {
+        uv__emfile_trick(tcp);
         return;
       } else {
         uv_err_new((uv_handle_t*)tcp, errno);
         tcp->connection_cb((uv_handle_t*)tcp, -1);
+        return;
       }
 
     } else {
@@ -418,10 +566,10 @@ int uv_accept(uv_handle_t* server, uv_stream_t* client) {
     return -1;
   }
 
-  if (uv_tcp_open(tcpClient, tcpServer->accepted_fd)) {
+  if (uv__tcp_open(tcpClient, tcpServer->accepted_fd, 1)) {
     /* Ignore error for now */
-    tcpServer->accepted_fd = -1;
     close(tcpServer->accepted_fd);
+    tcpServer->accepted_fd = -1;
     return -1;
   } else {
     tcpServer->accepted_fd = -1;
@@ -447,6 +595,8 @@ int uv_tcp_listen(uv_tcp_t* tcp, int backlog, uv_connection_cb cb) {
     return -1;
   }
 
+  uv__reserve_fd();
+
   tcp->connection_cb = cb;
 
   /* Start listening for connections. */
@@ -585,110 +735,154 @@ static void uv__drain(uv_tcp_t* tcp) {
 }
 
 
-/* On success returns NULL. On error returns a pointer to the write request
- * which had the error.
+/* Most iovecs uv__write() hands to a single writev(). They live on the stack
+ * so don't go all the way up to a big IOV_MAX.
+ */
+#if defined(IOV_MAX) && IOV_MAX < 1024
+# define UV__WRITE_IOV_MAX IOV_MAX
+#else
+# define UV__WRITE_IOV_MAX 1024
+#endif
+
+
+/* Writes as much of the write queue as the socket takes. The pending buffers
+ * of consecutive requests are gathered into one writev() (up to
+ * UV__WRITE_IOV_MAX of them), and that repeats until the queue is empty or
+ * the kernel stops taking everything. Finished requests move to
+ * write_completed_queue in queue order, their callbacks run from the
+ * write_watcher on a fresh stack.
+ *
+ * On success returns NULL. On error returns a pointer to the write request
+ * which had the error, unless requests were finished before it in the same
+ * call, then it returns NULL and the error comes back from the next call.
  */
 static uv_req_t* uv__write(uv_tcp_t* tcp) {
+  struct iovec iov[UV__WRITE_IOV_MAX];
   uv_req_t* req;
-  struct iovec* iov;
+  ngx_queue_t* q;
   int iovcnt;
+  int completed = 0;
+  int i;
+  size_t total;
   ssize_t n;
 
   assert(tcp->fd >= 0);
 
-  /* TODO: should probably while(1) here until EAGAIN */
-
-  /* Get the request at the head of the queue. */
-  req = uv_write_queue_head(tcp);
-  if (!req) {
-    assert(tcp->write_queue_size == 0);
-    return NULL;
-  }
-
-  assert(req->handle == (uv_handle_t*)tcp);
-
   /* Cast to iovec. We had to have our own uv_buf_t instead of iovec
    * because Windows's WSABUF is not an iovec.
    */
   assert(sizeof(uv_buf_t) == sizeof(struct iovec));
-  iov = (struct iovec*) &(req->bufs[req->write_index]);
-  iovcnt = req->bufcnt - req->write_index;
 
-  /* Now do the actual writev. Note that we've been updating the pointers
-   * inside the iov each time we write. So there is no need to offset it.
-   */
+  while (!ngx_queue_empty(&tcp->write_queue)) {
+    /* Gather what's left of the queued requests, in order. Note that we've
+     * been updating the pointers inside the bufs each time we write. So
+     * there is no need to offset them.
+     */
+    iovcnt = 0;
+    total = 0;
+    for (q = ngx_queue_head(&tcp->write_queue);
+         q != ngx_queue_sentinel(&tcp->write_queue);
+         q = ngx_queue_next(q)) {
+      req = ngx_queue_data(q, struct uv_req_s, queue);
+      assert(req->handle == (uv_handle_t*)tcp);
+
+      for (i = req->write_index;
+           i < req->bufcnt && iovcnt < UV__WRITE_IOV_MAX;
+           i++) {
+        iov[iovcnt].iov_base = req->bufs[i].base;
+        iov[iovcnt].iov_len = req->bufs[i].len;
+        total += req->bufs[i].len;
+        iovcnt++;
+      }
 
-  if (iovcnt == 1) {
-    n = write(tcp->fd, iov[0].iov_base, iov[0].iov_len);
-  }
-  else {
-    n = writev(tcp->fd, iov, iovcnt);
-  }
+      if (iovcnt == UV__WRITE_IOV_MAX) break;
+    }
 
-  if (n < 0) {
-    if (errno != EAGAIN) {
-      /* Error */
+    if (iovcnt == 1) {
+      n = write(tcp->fd, iov[0].iov_base, iov[0].iov_len);
+    }
+    else {
+      n = writev(tcp->fd, iov, iovcnt);
+    }
+
+    if (n < 0) {
+      if (errno == EINTR) continue;
+      if (errno == EAGAIN) break;
+
+      /* Error. Requests finished earlier in this call get their callbacks
+       * first: the error is left for the next call, which the write_watcher
+       * makes right away since the socket stays writable.
+       */
+      if (completed) break;
+
+      req = uv_write_queue_head(tcp);
       uv_err_new((uv_handle_t*)tcp, errno);
       return req;
     }
-  } else {
-    /* Successful write */
 
-    /* Update the counters. */
-    while (n > 0) {
-      uv_buf_t* buf = &(req->bufs[req->write_index]);
-      size_t len = buf->len;
+    /* Successful write. Update the counters, request by request. Empty
+     * bufs count as written once everything before them is.
+     */
+    total -= n;
+
+    while ((req = uv_write_queue_head(tcp)) != NULL) {
+      uv_buf_t* buf;
+      size_t len;
 
       assert(req->write_index < req->bufcnt);
 
+      buf = &(req->bufs[req->write_index]);
+      len = buf->len;
+
       // proteus: Fix g++ warning
       if (n < (ssize_t) len) {
+        /* There is more to write. */
         buf->base += n;
         buf->len -= n;
         tcp->write_queue_size -= n;
         n = 0;
-
-        /* There is more to write. Break and ensure the watcher is pending. */
         break;
+      }
 
-      } else {
-        /* Finished writing the buf at index req->write_index. */
-        req->write_index++;
-
-        assert(n >= len);
-        n -= len;
-
-        assert(tcp->write_queue_size >= len);
-        tcp->write_queue_size -= len;
-
-        if (req->write_index == req->bufcnt) {
-          /* Then we're done! */
-          assert(n == 0);
-
-          /* Pop the req off tcp->write_queue. */
-          ngx_queue_remove(&req->queue);
-          if (req->bufs != req->bufsml) {
-            free(req->bufs);
-          }
-          req->bufs = NULL;
-
-          /* Add it to the write_completed_queue where it will have its
-           * callback called in the near future.
-           * TODO: start trying to write the next request.
-           */
-          ngx_queue_insert_tail(&tcp->write_completed_queue, &req->queue);
-          ev_feed_event(EV_DEFAULT_ &tcp->write_watcher, EV_WRITE);
-          return NULL;
+      /* Finished writing the buf at index req->write_index. */
+      req->write_index++;
+      n -= len;
+
+      assert(tcp->write_queue_size >= len);
+      tcp->write_queue_size -= len;
+
+      if (req->write_index == req->bufcnt) {
+        /* Pop the req off tcp->write_queue. */
+        ngx_queue_remove(&req->queue);
+        if (req->bufs != req->bufsml) {
+          free(req->bufs);
         }
+        req->bufs = NULL;
+
+        /* Add it to the write_completed_queue where it will have its
+         * callback called in the near future.
+         */
+        ngx_queue_insert_tail(&tcp->write_completed_queue, &req->queue);
+        completed++;
       }
     }
+
+    assert(n == 0);
+
+    /* A short write means the socket buffer is full, the next write would
+     * only get EAGAIN.
+     */
+    if (total > 0) break;
   }
 
-  /* Either we've counted n down to zero or we've got EAGAIN. */
-  assert(n == 0 || n == -1);
+  if (completed) {
+    ev_feed_event(EV_DEFAULT_ &tcp->write_watcher, EV_WRITE);
+  }
 
-  /* We're not done. */
-  ev_io_start(EV_DEFAULT_ &tcp->write_watcher);
+  if (!ngx_queue_empty(&tcp->write_queue)) {
+    /* We're not done. */
+    ev_io_start(EV_DEFAULT_ &tcp->write_watcher);
+  }
 
   return NULL;
 }
@@ -373,6 +373,7 @@ static uv_err_code uv_translate_sys_error(int sys_errno) {
     case ERROR_INVALID_FLAGS:               return UV_EBADF;
     case ERROR_INVALID_PARAMETER:           return UV_EINVAL;
     case ERROR_NO_UNICODE_TRANSLATION:      return UV_ECHARSET;
+    case WSAEOPNOTSUPP:                     return UV_ENOTSUP;
     default:                                return UV_UNKNOWN;
   }
 }
@@ -870,6 +871,13 @@ int uv_tcp_bind6(uv_tcp_t* handle, struct sockaddr_in6 addr) {
 }
 
 
+int uv_tcp_reuseport(uv_tcp_t* handle, int enable) {
+  /* Winsock's SO_REUSEADDR doesn't balance connections, so don't pretend. */
+  uv_set_sys_error(WSAEOPNOTSUPP);
+  return -1;
+}
+
+
 static void uv_queue_accept(uv_tcp_t* handle) {
   uv_req_t* req;
   BOOL success;
@@ -23,6 +23,10 @@ TEST_DECLARE   (ping_pong)
 TEST_DECLARE   (ping_pong_v6)
 TEST_DECLARE   (delayed_accept)
 TEST_DECLARE   (tcp_writealot)
+TEST_DECLARE   (tcp_write_queue)
+TEST_DECLARE   (tcp_write_queue_reset)
+TEST_DECLARE   (tcp_accept_batch)
+TEST_DECLARE   (tcp_reuseport)
 TEST_DECLARE   (bind_error_addrinuse)
 TEST_DECLARE   (bind_error_addrnotavail_1)
 TEST_DECLARE   (bind_error_addrnotavail_2)
@@ -69,6 +73,14 @@ TASK_LIST_START
   TEST_ENTRY  (tcp_writealot)
   TEST_HELPER (tcp_writealot, echo_server)
 
+  TEST_ENTRY  (tcp_write_queue)
+  TEST_HELPER (tcp_write_queue, echo_server)
+
+  TEST_ENTRY  (tcp_write_queue_reset)
+
+  TEST_ENTRY  (tcp_accept_batch)
+  TEST_ENTRY  (tcp_reuseport)
+
   TEST_ENTRY  (bind_error_addrinuse)
   TEST_ENTRY  (bind_error_addrnotavail_1)
   TEST_ENTRY  (bind_error_addrnotavail_2)
@@ -0,0 +1,222 @@
+/* Copyright Joyent, Inc. and other Node contributors. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include "uv.h"
+#include "task.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+#ifndef _WIN32
+# include <fcntl.h>
+#endif
+
+/* More than one uv__server_io batch, and more than the listen backlog the
+ * clients can pile up in before the loop gets to run.
+ */
+#define CLIENTS 100
+
+static uv_tcp_t server;
+
+static int connection_cb_called = 0;
+static int connect_cb_called = 0;
+static int client_close_cb_called = 0;
+static int accepted_close_cb_called = 0;
+static int server_close_cb_called = 0;
+
+
+static uv_buf_t alloc_cb(uv_stream_t* tcp, size_t size) {
+  uv_buf_t buf;
+  buf.base = (char*)malloc(size);
+  buf.len = size;
+  return buf;
+}
+
+
+static void server_close_cb(uv_handle_t* handle) {
+  ASSERT(handle == (uv_handle_t*)&server);
+  server_close_cb_called++;
+}
+
+
+static void accepted_close_cb(uv_handle_t* handle) {
+  free(handle);
+  accepted_close_cb_called++;
+}
+
+
+static void client_close_cb(uv_handle_t* handle) {
+  free(handle);
+  client_close_cb_called++;
+}
+
+
+static void connection_cb(uv_handle_t* handle, int status) {
+  uv_tcp_t* accepted = (uv_tcp_t*)malloc(sizeof *accepted);
+  int r;
+
+  ASSERT(handle == (uv_handle_t*)&server);
+  ASSERT(status == 0);
+  ASSERT(accepted != NULL);
+
+  r = uv_tcp_init(accepted);
+  ASSERT(r == 0);
+
+  r = uv_accept(handle, (uv_stream_t*)accepted);
+  ASSERT(r == 0);
+
+#ifndef _WIN32
+  /* accept4() or the fallback hands out ready to use descriptors. */
+  ASSERT(fcntl(accepted->fd, F_GETFL) & O_NONBLOCK);
+  ASSERT(fcntl(accepted->fd, F_GETFD) & FD_CLOEXEC);
+#endif
+
+  r = uv_close((uv_handle_t*)accepted, accepted_close_cb);
+  ASSERT(r == 0);
+
+  if (++connection_cb_called == CLIENTS) {
+    r = uv_close((uv_handle_t*)&server, server_close_cb);
+    ASSERT(r == 0);
+  }
+}
+
+
+static void read_cb(uv_stream_t* tcp, ssize_t nread, uv_buf_t buf) {
+  if (buf.base) {
+    free(buf.base);
+  }
+
+  if (nread == -1) {
+    ASSERT(uv_last_error().code == UV_EOF ||
+           uv_last_error().code == UV_ECONNRESET);
+    uv_close((uv_handle_t*)tcp, client_close_cb);
+  } else {
+    ASSERT(nread == 0);
+  }
+}
+
+
+static void connect_cb(uv_req_t* req, int status) {
+  int r;
+
+  ASSERT(status == 0);
+
+  /* Wait for the server side to close. */
+  r = uv_read_start((uv_stream_t*)req->handle, alloc_cb, read_cb);
+  ASSERT(r == 0);
+
+  connect_cb_called++;
+  free(req);
+}
+
+
+static void client_connect() {
+  struct sockaddr_in addr = uv_ip4_addr("127.0.0.1", TEST_PORT);
+  uv_tcp_t* client = (uv_tcp_t*)malloc(sizeof *client);
+  uv_req_t* connect_req = (uv_req_t*)malloc(sizeof *connect_req);
+  int r;
+
+  ASSERT(client != NULL);
+  ASSERT(connect_req != NULL);
+
+  r = uv_tcp_init(client);
+  ASSERT(r == 0);
+
+  uv_req_init(connect_req, (uv_handle_t*)client, connect_cb);
+  r = uv_tcp_connect(connect_req, addr);
+  ASSERT(r == 0);
+}
+
+
+TEST_IMPL(tcp_accept_batch) {
+  struct sockaddr_in addr = uv_ip4_addr("0.0.0.0", TEST_PORT);
+  int i;
+  int r;
+
+  uv_init();
+
+  r = uv_tcp_init(&server);
+  ASSERT(r == 0);
+  r = uv_tcp_bind(&server, addr);
+  ASSERT(r == 0);
+  r = uv_tcp_listen(&server, 128, connection_cb);
+  ASSERT(r == 0);
+
+  for (i = 0; i < CLIENTS; i++) {
+    client_connect();
+  }
+
+  uv_run();
+
+  ASSERT(connection_cb_called == CLIENTS);
+  ASSERT(connect_cb_called == CLIENTS);
+  ASSERT(accepted_close_cb_called == CLIENTS);
+  ASSERT(client_close_cb_called == CLIENTS);
+  ASSERT(server_close_cb_called == 1);
+
+  return 0;
+}
+
+
+static void noop_connection_cb(uv_handle_t* handle, int status) {
+  ASSERT(0 && "should not be called");
+}
+
+
+TEST_IMPL(tcp_reuseport) {
+  struct sockaddr_in addr = uv_ip4_addr("127.0.0.1", TEST_PORT);
+  uv_tcp_t first, second;
+  int r;
+
+  uv_init();
+
+  r = uv_tcp_init(&first);
+  ASSERT(r == 0);
+  r = uv_tcp_init(&second);
+  ASSERT(r == 0);
+
+  r = uv_tcp_reuseport(&first, 1);
+  if (r) {
+    /* No SO_REUSEPORT on this platform. */
+    ASSERT(uv_last_error().code == UV_ENOTSUP);
+    return 0;
+  }
+
+  r = uv_tcp_reuseport(&second, 1);
+  ASSERT(r == 0);
+
+  r = uv_tcp_bind(&first, addr);
+  ASSERT(r == 0);
+  r = uv_tcp_listen(&first, 128, noop_connection_cb);
+  ASSERT(r == 0);
+
+  /* Without the flag this is the EADDRINUSE of bind_error_addrinuse. */
+  r = uv_tcp_bind(&second, addr);
+  ASSERT(r == 0);
+  r = uv_tcp_listen(&second, 128, noop_connection_cb);
+  ASSERT(r == 0);
+
+  uv_close((uv_handle_t*)&first, NULL);
+  uv_close((uv_handle_t*)&second, NULL);
+
+  uv_run();
+
+  return 0;
+}
@@ -0,0 +1,355 @@
+/* Copyright Joyent, Inc. and other Node contributors. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include "uv.h"
+#include "task.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifndef _WIN32
+# include <signal.h>
+# include <sys/socket.h>
+#endif
+
+
+/* Queues lots of small multi-buf writes at once, more bufs than fit in one
+ * writev(), and checks that the echoed bytes come back in order and that
+ * the write callbacks run in the order the writes were queued.
+ */
+
+#define WRITES            2000
+#define HEADER_SIZE       8
+#define MAX_BODY_SIZE     97
+
+
+static char headers[WRITES][HEADER_SIZE + 1];
+static char bodies[MAX_BODY_SIZE];
+static uv_req_t write_reqs[WRITES];
+
+static char* expected;
+static int expected_size = 0;
+static char* received;
+static int received_size = 0;
+
+static int connect_cb_called = 0;
+static int write_cb_called = 0;
+static int shutdown_cb_called = 0;
+static int close_cb_called = 0;
+
+
+static uv_buf_t alloc_cb(uv_stream_t* tcp, size_t size) {
+  uv_buf_t buf;
+  buf.base = (char*)malloc(size);
+  buf.len = size;
+  return buf;
+}
+
+
+static void close_cb(uv_handle_t* handle) {
+  ASSERT(handle != NULL);
+
+  free(handle);
+
+  close_cb_called++;
+}
+
+
+static void shutdown_cb(uv_req_t* req, int status) {
+  ASSERT(req);
+  ASSERT(status == 0);
+  ASSERT(((uv_tcp_t*)req->handle)->write_queue_size == 0);
+  ASSERT(write_cb_called == WRITES);
+
+  shutdown_cb_called++;
+
+  free(req);
+}
+
+
+static void read_cb(uv_stream_t* tcp, ssize_t nread, uv_buf_t buf) {
+  ASSERT(tcp != NULL);
+
+  if (nread < 0) {
+    ASSERT(uv_last_error().code == UV_EOF);
+
+    if (buf.base) {
+      free(buf.base);
+    }
+
+    uv_close((uv_handle_t*)tcp, close_cb);
+    return;
+  }
+
+  ASSERT(received_size + nread <= expected_size);
+  memcpy(received + received_size, buf.base, nread);
+  received_size += nread;
+
+  free(buf.base);
+}
+
+
+static void write_cb(uv_req_t* req, int status) {
+  ASSERT(status == 0);
+
+  /* In the order they were queued. */
+  ASSERT(req == &write_reqs[write_cb_called]);
+  write_cb_called++;
+}
+
+
+static void connect_cb(uv_req_t* req, int status) {
+  uv_buf_t bufs[3];
+  uv_tcp_t* tcp;
+  int i, r;
+
+  ASSERT(req != NULL);
+  ASSERT(status == 0);
+
+  tcp = (uv_tcp_t*)req->handle;
+
+  connect_cb_called++;
+  free(req);
+
+  for (i = 0; i < WRITES; i++) {
+    snprintf(headers[i], sizeof headers[i], "%07d\n", i);
+
+    bufs[0].base = headers[i];
+    bufs[0].len = HEADER_SIZE;
+    /* empty bufs are done once the ones before them are */
+    bufs[1].base = bodies;
+    bufs[1].len = 0;
+    bufs[2].base = bodies;
+    bufs[2].len = i % MAX_BODY_SIZE;
+
+    memcpy(expected + expected_size, bufs[0].base, bufs[0].len);
+    expected_size += bufs[0].len;
+    memcpy(expected + expected_size, bufs[2].base, bufs[2].len);
+    expected_size += bufs[2].len;
+
+    uv_req_init(&write_reqs[i], (uv_handle_t*)tcp, write_cb);
+    r = uv_write(&write_reqs[i], bufs, 3);
+    ASSERT(r == 0);
+  }
+
+  req = (uv_req_t*)malloc(sizeof *req);
+  ASSERT(req != NULL);
+  uv_req_init(req, (uv_handle_t*)tcp, shutdown_cb);
+  r = uv_shutdown(req);
+  ASSERT(r == 0);
+
+  r = uv_read_start((uv_stream_t*)tcp, alloc_cb, read_cb);
+  ASSERT(r == 0);
+}
+
+
+TEST_IMPL(tcp_write_queue) {
+  struct sockaddr_in addr = uv_ip4_addr("127.0.0.1", TEST_PORT);
+  uv_tcp_t* client = (uv_tcp_t*)malloc(sizeof *client);
+  uv_req_t* connect_req = (uv_req_t*)malloc(sizeof *connect_req);
+  int i, r;
+
+  ASSERT(client != NULL);
+  ASSERT(connect_req != NULL);
+
+  for (i = 0; i < MAX_BODY_SIZE; i++) {
+    bodies[i] = 'a' + i % 26;
+  }
+
+  expected = (char*)malloc(WRITES * (HEADER_SIZE + MAX_BODY_SIZE));
+  received = (char*)malloc(WRITES * (HEADER_SIZE + MAX_BODY_SIZE));
+  ASSERT(expected != NULL);
+  ASSERT(received != NULL);
+
+  uv_init();
+
+  r = uv_tcp_init(client);
+  ASSERT(r == 0);
+
+  uv_req_init(connect_req, (uv_handle_t*)client, connect_cb);
+  r = uv_tcp_connect(connect_req, addr);
+  ASSERT(r == 0);
+
+  uv_run();
+
+  ASSERT(connect_cb_called == 1);
+  ASSERT(write_cb_called == WRITES);
+  ASSERT(shutdown_cb_called == 1);
+  ASSERT(close_cb_called == 1);
+  ASSERT(received_size == expected_size);
+  ASSERT(memcmp(received, expected, expected_size) == 0);
+
+  free(expected);
+  free(received);
+
+  return 0;
+}
+
+
+/* The peer resets the connection while big writes are still queued. Requests
+ * that made it out before the reset must get their (successful) callbacks
+ * before the failing one gets its error, closing the handle from that error
+ * callback must not lose them.
+ */
+
+#define RESET_WRITES      64
+#define RESET_WRITE_SIZE  (256 * 1024)
+
+static uv_tcp_t reset_server;
+static uv_tcp_t* reset_peer;
+static uv_timer_t reset_timer;
+static uv_req_t reset_reqs[RESET_WRITES];
+static char* reset_data;
+
+static int reset_write_cb_called = 0;
+static int reset_write_ok = 0;
+static int reset_write_error = 0;
+static int reset_close_cb_called = 0;
+
+
+static void reset_close_cb(uv_handle_t* handle) {
+  reset_close_cb_called++;
+}
+
+
+static void reset_peer_close_cb(uv_handle_t* handle) {
+  free(handle);
+  reset_close_cb_called++;
+}
+
+
+static void reset_write_cb(uv_req_t* req, int status) {
+  /* In the order they were queued, nothing skipped. */
+  ASSERT(req == &reset_reqs[reset_write_cb_called]);
+  reset_write_cb_called++;
+
+  if (status == 0) {
+    ASSERT(reset_write_error == 0);
+    reset_write_ok++;
+    return;
+  }
+
+  ASSERT(status == -1);
+  reset_write_error++;
+  uv_close((uv_handle_t*)req->handle, close_cb);
+}
+
+
+static void reset_timer_cb(uv_timer_t* handle, int status) {
+#ifndef _WIN32
+  /* Close with a RST rather than a FIN. */
+  struct linger l;
+  l.l_onoff = 1;
+  l.l_linger = 0;
+  ASSERT(0 == setsockopt(reset_peer->fd, SOL_SOCKET, SO_LINGER, &l, sizeof l));
+#endif
+
+  uv_close((uv_handle_t*)reset_peer, reset_peer_close_cb);
+  uv_close((uv_handle_t*)&reset_server, reset_close_cb);
+  uv_close((uv_handle_t*)handle, reset_close_cb);
+}
+
+
+static void reset_connection_cb(uv_handle_t* server, int status) {
+  int r;
+
+  ASSERT(status == 0);
+
+  reset_peer = (uv_tcp_t*)malloc(sizeof *reset_peer);
+  ASSERT(reset_peer != NULL);
+  r = uv_tcp_init(reset_peer);
+  ASSERT(r == 0);
+  r = uv_accept(server, (uv_stream_t*)reset_peer);
+  ASSERT(r == 0);
+
+  /* Don't read, let the client's writes pile up first. */
+  r = uv_timer_init(&reset_timer);
+  ASSERT(r == 0);
+  r = uv_timer_start(&reset_timer, reset_timer_cb, 100, 0);
+  ASSERT(r == 0);
+}
+
+
+static void reset_connect_cb(uv_req_t* req, int status) {
+  uv_buf_t buf;
+  int i, r;
+
+  ASSERT(status == 0);
+
+  for (i = 0; i < RESET_WRITES; i++) {
+    buf.base = reset_data;
+    buf.len = RESET_WRITE_SIZE;
+    uv_req_init(&reset_reqs[i], req->handle, reset_write_cb);
+    r = uv_write(&reset_reqs[i], &buf, 1);
+    ASSERT(r == 0);
+  }
+
+  connect_cb_called++;
+  free(req);
+}
+
+
+TEST_IMPL(tcp_write_queue_reset) {
+  struct sockaddr_in addr = uv_ip4_addr("127.0.0.1", TEST_PORT);
+  uv_tcp_t* client = (uv_tcp_t*)malloc(sizeof *client);
+  uv_req_t* connect_req = (uv_req_t*)malloc(sizeof *connect_req);
+  int r;
+
+  ASSERT(client != NULL);
+  ASSERT(connect_req != NULL);
+
+#ifndef _WIN32
+  /* Writes after the reset fail with EPIPE. */
+  signal(SIGPIPE, SIG_IGN);
+#endif
+
+  reset_data = (char*)calloc(1, RESET_WRITE_SIZE);
+  ASSERT(reset_data != NULL);
+
+  uv_init();
+
+  r = uv_tcp_init(&reset_server);
+  ASSERT(r == 0);
+  r = uv_tcp_bind(&reset_server, addr);
+  ASSERT(r == 0);
+  r = uv_tcp_listen(&reset_server, 128, reset_connection_cb);
+  ASSERT(r == 0);
+
+  r = uv_tcp_init(client);
+  ASSERT(r == 0);
+  uv_req_init(connect_req, (uv_handle_t*)client, reset_connect_cb);
+  r = uv_tcp_connect(connect_req, addr);
+  ASSERT(r == 0);
+
+  uv_run();
+
+  ASSERT(connect_cb_called == 1);
+  /* 16M can't all be buffered, so some write has to see the reset. */
+  ASSERT(reset_write_error == 1);
+  ASSERT(reset_write_cb_called == reset_write_ok + 1);
+  ASSERT(reset_write_cb_called <= RESET_WRITES);
+  ASSERT(close_cb_called == 1);
+  ASSERT(reset_close_cb_called == 3);
+
+  free(reset_data);
+
+  return 0;
+}
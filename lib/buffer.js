@@ -20,7 +20,7 @@
 // USE OR OTHER DEALINGS IN THE SOFTWARE.
 
 var SlowBuffer = process.binding('buffer').SlowBuffer;
-var IEEE754 = require('buffer_ieee754');
+var BufferList = process.binding('buffer').BufferList;
 var assert = require('assert');
 
 
@@ -40,21 +40,6 @@ SlowBuffer.prototype.inspect = function() {
 };
 
 
-SlowBuffer.prototype.hexSlice = function(start, end) {
-  var len = this.length;
-
-  if (!start || start < 0) start = 0;
-  if (!end || end < 0 || end > len) end = len;
-
-  var out = '';
-  for (var i = start; i < end; i++) {
-    out += toHex(this[i]);
-  }
-  return out;
-};
-
-
-
 SlowBuffer.prototype.toString = function(encoding, start, end) {
   encoding = String(encoding || 'utf8').toLowerCase();
   start = +start || 0;
@@ -92,23 +77,6 @@ SlowBuffer.prototype.toString = function(encoding, start, end) {
 };
 
 
-SlowBuffer.prototype.hexWrite = function(string, offset) {
-  var len = string.length;
-  offset = +offset || 0;
-
-  // must be an even number of digits
-  if (len % 2) {
-    throw new Error('Invalid hex string');
-  }
-  for (var i = 0; i < len / 2; i++) {
-    var byte = parseInt(string.substr(i * 2, 2), 16);
-    if (isNaN(byte)) throw new Error('Invalid hex string');
-    this[offset + i] = byte;
-  }
-  return i;
-};
-
-
 SlowBuffer.prototype.write = function(string, offset, encoding) {
   // Support both (string, offset, encoding)
   // and the legacy (string, encoding, offset)
@@ -232,6 +200,7 @@ function isArrayIsh(subject) {
 
 exports.SlowBuffer = SlowBuffer;
 exports.Buffer = Buffer;
+exports.BufferList = BufferList;
 
 Buffer.poolSize = 8 * 1024;
 var pool;
@@ -458,6 +427,62 @@ Buffer.prototype.slice = function(start, end) {
 };
 
 
+// indexOf(value, byteOffset=0, [encoding])
+// value is a Buffer, a string (in encoding, utf8 by default) or a byte, a
+// negative byteOffset counts from the end
+Buffer.prototype.indexOf = function indexOf(value, byteOffset, encoding) {
+  if (typeof byteOffset === 'string') {
+    encoding = byteOffset;
+    byteOffset = 0;
+  }
+  byteOffset = ~~byteOffset;
+  if (byteOffset < 0) byteOffset = Math.max(this.length + byteOffset, 0);
+  if (byteOffset > this.length) byteOffset = this.length;
+
+  if (typeof value === 'string') {
+    value = new Buffer(value, encoding);
+  } else if (typeof value === 'number') {
+    value = value & 0xff;
+  } else if (!Buffer.isBuffer(value)) {
+    throw new TypeError('value must be a Buffer, string or number');
+  }
+
+  if (typeof value !== 'number' && value.length === 0) return byteOffset;
+
+  var index = this.parent.indexOf(value,
+                                  byteOffset + this.offset,
+                                  this.length + this.offset);
+  return index < 0 ? -1 : index - this.offset;
+};
+
+
+// compare(target), -1, 0 or 1 as this sorts before, with or after target
+Buffer.prototype.compare = function compare(target) {
+  if (!Buffer.isBuffer(target)) {
+    throw new TypeError('Argument must be a Buffer');
+  }
+  return this.parent.compare(target, this.offset, this.offset + this.length);
+};
+
+
+Buffer.prototype.equals = function equals(target) {
+  if (!Buffer.isBuffer(target)) {
+    throw new TypeError('Argument must be a Buffer');
+  }
+  if (this === target) return true;
+  if (this.length !== target.length) return false;
+  return this.compare(target) === 0;
+};
+
+
+Buffer.compare = function compare(a, b) {
+  if (!Buffer.isBuffer(a) || !Buffer.isBuffer(b)) {
+    throw new TypeError('Arguments must be Buffers');
+  }
+  return a.compare(b);
+};
+
+
 // Legacy methods for backwards compatibility.
 
 Buffer.prototype.utf8Slice = function(start, end) {
@@ -635,7 +660,7 @@ Buffer.prototype.readInt8 = function(offset, endian) {
 
 Buffer.prototype.readInt16 = function(offset, endian) {
   var buffer = this;
-  var neg;
+  var neg, val;
 
   assert.ok(endian !== undefined && endian !== null,
     'missing endian');
@@ -661,7 +686,7 @@ Buffer.prototype.readInt16 = function(offset, endian) {
 
 Buffer.prototype.readInt32 = function(offset, endian) {
   var buffer = this;
-  var neg;
+  var neg, val;
 
   assert.ok(endian !== undefined && endian !== null,
     'missing endian');
@@ -697,10 +722,12 @@ Buffer.prototype.readFloat = function(offset, endian) {
   assert.ok(offset !== undefined && offset !== null,
     'missing offset');
 
-  assert.ok(offset + 3 < buffer.length,
+  assert.ok(offset >= 0 && offset + 3 < buffer.length,
     'Trying to read beyond buffer length');
 
-  return IEEE754.readIEEE754(buffer, offset, endian, 23, 4);
+  offset += buffer.offset;
+  return endian == 'big' ? buffer.parent.readFloatBE(offset) :
+                           buffer.parent.readFloatLE(offset);
 };
 
 Buffer.prototype.readDouble = function(offset, endian) {
@@ -715,10 +742,12 @@ Buffer.prototype.readDouble = function(offset, endian) {
   assert.ok(offset !== undefined && offset !== null,
     'missing offset');
 
-  assert.ok(offset + 7 < buffer.length,
+  assert.ok(offset >= 0 && offset + 7 < buffer.length,
     'Trying to read beyond buffer length');
 
-  return IEEE754.readIEEE754(buffer, offset, endian, 52, 8);
+  offset += buffer.offset;
+  return endian == 'big' ? buffer.parent.readDoubleBE(offset) :
+                           buffer.parent.readDoubleLE(offset);
 };
 
 
@@ -990,11 +1019,16 @@ Buffer.prototype.writeFloat = function(value, offset, endian) {
   assert.ok(offset !== undefined && offset !== null,
     'missing offset');
 
-  assert.ok(offset + 3 < buffer.length,
+  assert.ok(offset >= 0 && offset + 3 < buffer.length,
     'Trying to read beyond buffer length');
 
   verifIEEE754(value, 3.4028234663852886e+38, -3.4028234663852886e+38);
-  IEEE754.writeIEEE754(buffer, value, offset, endian, 23, 4);
+  offset += buffer.offset;
+  if (endian == 'big') {
+    buffer.parent.writeFloatBE(value, offset);
+  } else {
+    buffer.parent.writeFloatLE(value, offset);
+  }
 };
 
 
@@ -1013,9 +1047,47 @@ Buffer.prototype.writeDouble = function(value, offset, endian) {
   assert.ok(offset !== undefined && offset !== null,
     'missing offset');
 
-  assert.ok(offset + 7 < buffer.length,
+  assert.ok(offset >= 0 && offset + 7 < buffer.length,
     'Trying to read beyond buffer length');
 
   verifIEEE754(value, 1.7976931348623157E+308, -1.7976931348623157E+308);
-  IEEE754.writeIEEE754(buffer, value, offset, endian, 52, 8);
+  offset += buffer.offset;
+  if (endian == 'big') {
+    buffer.parent.writeDoubleBE(value, offset);
+  } else {
+    buffer.parent.writeDoubleLE(value, offset);
+  }
+};
+
+
+// BufferList, native push/consume/copy/find/clear and length, see
+// src/node_buffer_list.h
+
+// concat(start=0, end=list.length), the bytes in one new buffer
+BufferList.prototype.concat = function(start, end) {
+  start = +start || 0;
+  if (end === undefined || end > this.length) end = this.length;
+  if (start > end) throw new Error('oob');
+
+  var buffer = new Buffer(end - start);
+  if (buffer.length) this.copy(buffer, 0, start, end);
+  return buffer;
+};
+
+
+// slice(start=0, end=list.length), references the chunk when a single one
+// holds the range and copies it out otherwise
+BufferList.prototype.slice = function(start, end) {
+  start = +start || 0;
+  if (end === undefined || end > this.length) end = this.length;
+  if (start > end) throw new Error('oob');
+
+  var hit = this.find(start, end);
+  if (hit) return hit[0].slice(hit[1], hit[1] + end - start);
+  return this.concat(start, end);
+};
+
+
+BufferList.prototype.toString = function(encoding, start, end) {
+  return this.slice(start, end).toString(encoding);
 };
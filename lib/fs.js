@@ -26,6 +26,7 @@ var binding = process.binding('fs');
 var constants = process.binding('constants');
 var fs = exports;
 var Stream = require('stream').Stream;
+var BufferList = require('buffer').BufferList;
 var EventEmitter = require('events').EventEmitter;
 
 var kMinPoolSpace = 128;
@@ -75,12 +76,10 @@ fs.readFile = function(path, encoding_) {
   var callback = arguments[arguments.length - 1];
   if (typeof(callback) !== 'function') callback = noop;
   var readStream = fs.createReadStream(path);
-  var buffers = [];
-  var nread = 0;
+  var chunks = new BufferList();
 
   readStream.on('data', function(chunk) {
-    buffers.push(chunk);
-    nread += chunk.length;
+    chunks.push(chunk);
   });
 
   readStream.on('error', function(er) {
@@ -89,21 +88,9 @@ fs.readFile = function(path, encoding_) {
   });
 
   readStream.on('end', function() {
-    // copy all the buffers into one
-    var buffer;
-    switch (buffers.length) {
-      case 0: buffer = new Buffer(0); break;
-      case 1: buffer = buffers[0]; break;
-      default: // concat together
-        buffer = new Buffer(nread);
-        var n = 0;
-        buffers.forEach(function(b) {
-          var l = b.length;
-          b.copy(buffer, n, 0, l);
-          n += l;
-        });
-        break;
-    }
+    // a single chunk is handed out as is, more are copied into one buffer
+    var buffer = chunks.slice();
+    chunks.clear();
     if (encoding) {
       try {
         buffer = buffer.toString(encoding);
@@ -117,40 +104,18 @@ fs.readFile = function(path, encoding_) {
 
 fs.readFileSync = function(path, encoding) {
   var fd = fs.openSync(path, constants.O_RDONLY, 0666);
-  var buffer = new Buffer(4048);
-  var buffers = [];
-  var nread = 0;
-  var lastRead = 0;
+  var chunks = new BufferList();
+  var lastRead;
 
   do {
-    if (lastRead) {
-      buffer._bytesRead = lastRead;
-      nread += lastRead;
-      buffers.push(buffer);
-    }
     var buffer = new Buffer(4048);
     lastRead = fs.readSync(fd, buffer, 0, buffer.length, null);
+    chunks.push(buffer, 0, lastRead);
   } while (lastRead > 0);
 
   fs.closeSync(fd);
 
-  if (buffers.length > 1) {
-    var offset = 0;
-    var i;
-    buffer = new Buffer(nread);
-    buffers.forEach(function(i) {
-      if (!i._bytesRead) return;
-      i.copy(buffer, offset, 0, i._bytesRead);
-      offset += i._bytesRead;
-    });
-  } else if (buffers.length) {
-    // buffers has exactly 1 (possibly zero length) buffer, so this should
-    // be a shortcut
-    buffer = buffers[0].slice(0, buffers[0]._bytesRead);
-  } else {
-    buffer = new Buffer(0);
-  }
-
+  buffer = chunks.slice();
   if (encoding) buffer = buffer.toString(encoding);
   return buffer;
 };
@@ -277,6 +242,71 @@ fs.readSync = function(fd, buffer, offset, length, position) {
   return [str, r];
 };
 
+// REQ: buffer backed by a mapping of the file instead of a copy of it,
+// the mapping goes away with the buffer. prot is 'rw' (default), 'r' or
+// PROT_* bits, options.shared maps with MAP_SHARED (writes go to the file)
+// instead of MAP_PRIVATE, options.advise is one or a list of 'normal',
+// 'random', 'sequential', 'willneed', 'dontneed'. A buffer is always
+// writable from JS, so the default is a private (copy-on-write) writable
+// mapping, which works on read-only fds too. With 'r' any write to the
+// buffer is a SIGSEGV that kills the process.
+var madvise = {
+  normal: constants.MADV_NORMAL,
+  random: constants.MADV_RANDOM,
+  sequential: constants.MADV_SEQUENTIAL,
+  willneed: constants.MADV_WILLNEED,
+  dontneed: constants.MADV_DONTNEED
+};
+
+fs.mmap = function(fd, offset, length, prot, options) {
+  if (typeof prot === 'object') {
+    options = prot;
+    prot = undefined;
+  }
+  options = options || {};
+  offset = offset || 0;
+
+  if (length === undefined || length === null) {
+    length = Math.max(fs.fstatSync(fd).size - offset, 0);
+  }
+  if (!length) return new Buffer(0);
+
+  switch (prot) {
+    case 'r':
+      prot = constants.PROT_READ;
+      break;
+    case undefined:
+    case 'rw':
+      prot = constants.PROT_READ | constants.PROT_WRITE;
+      break;
+  }
+  var flags = options.shared ? constants.MAP_SHARED : constants.MAP_PRIVATE;
+
+  var advice;
+  if (options.advise) {
+    advice = [].concat(options.advise).map(function(name) {
+      if (!(name in madvise)) throw new Error('Unknown advice: ' + name);
+      return madvise[name];
+    });
+  }
+
+  return binding.mmap(fd, offset, length, prot, flags, advice);
+};
+
+// REQ: writes all of a BufferList with writev(2) (pwrite(2) per chunk when
+// position is given), without concatenating it first
+fs.writevSync = function(fd, list, position) {
+  var written = 0;
+  var length = list.length;
+  while (written < length) {
+    var pos = typeof position === 'number' ? position + written : null;
+    var n = binding.writev(fd, list, written, pos);
+    if (!n) break;
+    written += n;
+  }
+  return written;
+};
+
 fs.write = function(fd, buffer, offset, length, position, callback) {
   if (!Buffer.isBuffer(buffer)) {
     // legacy string interface (fd, data, position, encoding, callback)
@@ -309,11 +309,9 @@ Module.prototype.load = function(filename) {
 
 
 // Returns exception if any
+// content null: the file is compiled through the process wide module cache
 Module.prototype._compile = function(content, filename) {
   var self = this;
- 
-  // remove shebang
-  content = content.replace(/^\#\!.*/, '');
 
   function require(path) {
     return Module._load(path, self);
@@ -332,17 +330,25 @@ Module.prototype._compile = function(content, filename) {
 
   // create wrapper function
   var dirname = path.dirname(filename);
-  var wrapper = Module.wrap(content);
-  var compiledWrapper = runInThisContext(wrapper, filename, true);
+  var compiledWrapper;
+  if (content === null) {
+    compiledWrapper = process._compileModule(filename);
+  } else {
+    // remove shebang
+    content = content.replace(/^\#\!.*/, '');
+    var wrapper = Module.wrap(content);
+    compiledWrapper = runInThisContext(wrapper, filename, true);
+  }
   var args = [process, self.exports, require, self, filename, dirname, process.Buffer];
   return compiledWrapper.apply(self.exports, args);
 };
 
 // REQ: modules can be js files (.js extension), or native shared libs (.so or .node) extension
 // Native extension for .js
+// REQ: the source and preparse data are shared by all the node instances
+//   >: (pages), the file is only read again once it changed on disk
 Module._extensions['.js'] = function(module, filename) {
-  var content = NativeModule.require('fs').readFileSync(filename, 'utf8');
-  module._compile(content, filename);
+  module._compile(null, filename);
 };
 
 // Native extension for .node
@@ -49,6 +49,7 @@ var binding = process.binding('net');
 var FreeList = require('freelist').FreeList;
 
 var IOWatcher = process.binding('io_watcher').IOWatcher;
+var SocketReader = process.binding('io_watcher').SocketReader;
 var constants = process.binding('constants');
 var assert = require('assert').ok;
 
@@ -63,6 +64,7 @@ var read = binding.read;
 var write = binding.write;
 var toRead = binding.toRead;
 var setNoDelay = binding.setNoDelay;
+var setReusePort = binding.setReusePort;
 var setKeepAlive = binding.setKeepAlive;
 var socketError = binding.socketError;
 var getsockname = binding.getsockname;
@@ -76,11 +78,26 @@ var EMFILE = constants.EMFILE;
 
 var END_OF_FILE = 42;
 
+// Most connections a listening socket accepts per readiness event. The
+// watcher is level triggered, so a larger backlog is picked up on the next
+// tick of the loop after the other watchers had their turn.
+var kAcceptBatch = 32;
+
 
 var ioWatchers = new FreeList('iowatcher', 100, function() {
   return new IOWatcher();
 });
 
+// Reads tcp sockets (and plain fds) natively, unix sockets stay on an
+// IOWatcher + recvMsg() because of fd passing.
+var socketReaders = new FreeList('socketreader', 100, function() {
+  var reader = new SocketReader();
+  reader.ondata = onReaderData;
+  reader.onend = onReaderEnd;
+  reader.onerror = onReaderError;
+  return reader;
+});
+
 exports.isIP = binding.isIP;
 
 exports.isIPv4 = function(input) {
@@ -179,6 +196,24 @@ function onReadable(readable, writable) {
 }
 
 
+function onReaderData(buffer, start, end) {
+  assert(this.socket);
+  this.socket._onData(buffer, start, end);
+}
+
+
+function onReaderEnd() {
+  assert(this.socket);
+  this.socket._onEnd();
+}
+
+
+function onReaderError(e) {
+  assert(this.socket);
+  this.socket._onReadError(e);
+}
+
+
 function onWritable(readable, writable) {
   assert(this.socket);
   var socket = this.socket;
@@ -191,9 +226,13 @@ function onWritable(readable, writable) {
 }
 
 function initSocket(self) {
-  self._readWatcher = ioWatchers.alloc();
+  if (self.type == 'unix') {
+    self._readWatcher = ioWatchers.alloc();
+    self._readWatcher.callback = onReadable;
+  } else {
+    self._readWatcher = socketReaders.alloc();
+  }
   self._readWatcher.socket = self;
-  self._readWatcher.callback = onReadable;
   self.readable = self.destroyed = false;
 
   // Queue of buffers and string that need to be written to socket.
@@ -248,12 +287,12 @@ Socket.prototype._onTimeout = function() {
 
 
 Socket.prototype.open = function(fd, type) {
-  initSocket(this);
-
   this.fd = fd;
   this.type = type || null;
   this.readable = true;
 
+  initSocket(this);
+
   setImplmentationMethods(this);
 
   this._writeWatcher.set(this.fd, false, true);
@@ -636,11 +675,7 @@ Socket.prototype._onReadable = function() {
                                pool.length - pool.used);
     DTRACE_NET_SOCKET_READ(this, bytesRead);
   } catch (e) {
-    if (e.code == 'ECONNRESET') {
-      self.destroy();
-    } else {
-      self.destroy(e);
-    }
+    self._onReadError(e);
     return;
   }
 
@@ -649,39 +684,61 @@ Socket.prototype._onReadable = function() {
   // (but not an error).
 
   if (bytesRead === 0) {
-    self.readable = false;
-    self._readWatcher.stop();
-
-    if (!self.writable) self.destroy();
-    // Note: 'close' not emitted until nextTick.
-
-    if (!self.allowHalfOpen) self.end();
-    if (self._events && self._events['end']) self.emit('end');
-    if (self.onend) self.onend();
+    self._onEnd();
   } else if (bytesRead > 0) {
-
-    timers.active(self);
-
     var start = pool.used;
-    var end = pool.used + bytesRead;
     pool.used += bytesRead;
+    self._onData(pool, start, pool.used);
+  }
+};
 
-    debug('socket ' + self.fd + ' received ' + bytesRead + ' bytes');
 
-    if (self._decoder) {
-      // emit String
-      var string = self._decoder.write(pool.slice(start, end));
-      if (string.length) self.emit('data', string);
-    } else {
-      // emit buffer
-      if (self._events && self._events['data']) {
-        // emit a slice
-        self.emit('data', pool.slice(start, end));
-      }
+// The rest of a read, from _onReadable() or straight from the SocketReader
+// which has already stopped itself on EOF and errors.
+Socket.prototype._onData = function(buffer, start, end) {
+  var self = this;
+
+  timers.active(self);
+
+  debug('socket ' + self.fd + ' received ' + (end - start) + ' bytes');
+
+  if (self._decoder) {
+    // emit String
+    var string = self._decoder.write(buffer.slice(start, end));
+    if (string.length) self.emit('data', string);
+  } else {
+    // emit buffer
+    if (self._events && self._events['data']) {
+      // emit a slice
+      self.emit('data', buffer.slice(start, end));
     }
+  }
 
-    // Optimization: emit the original buffer with end points
-    if (self.ondata) self.ondata(pool, start, end);
+  // Optimization: emit the original buffer with end points
+  if (self.ondata) self.ondata(buffer, start, end);
+};
+
+
+Socket.prototype._onEnd = function() {
+  var self = this;
+
+  self.readable = false;
+  self._readWatcher.stop();
+
+  if (!self.writable) self.destroy();
+  // Note: 'close' not emitted until nextTick.
+
+  if (!self.allowHalfOpen) self.end();
+  if (self._events && self._events['end']) self.emit('end');
+  if (self.onend) self.onend();
+};
+
+
+Socket.prototype._onReadError = function(e) {
+  if (e.code == 'ECONNRESET') {
+    this.destroy();
+  } else {
+    this.destroy(e);
   }
 };
 
@@ -692,6 +749,8 @@ Socket.prototype._onReadable = function() {
 // socket.connect('/tmp/socket')    - UNIX connect to socket specified by path
 Socket.prototype.connect = function() {
   var self = this;
+  var port = toPort(arguments[0]);
+  if (port === false) self.type = 'unix';
   initSocket(self);
   if (typeof self.fd === 'number') throw new Error('Socket already opened');
   if (!self._readWatcher) throw new Error('No readWatcher');
@@ -711,7 +770,6 @@ Socket.prototype.connect = function() {
     }
   }
 
-  var port = toPort(arguments[0]);
   if (port === false) {
     // UNIX
     self.fd = socket('unix');
@@ -819,7 +877,11 @@ Socket.prototype.destroy = function(exception) {
   if (this._readWatcher) {
     this._readWatcher.stop();
     this._readWatcher.socket = null;
-    ioWatchers.free(this._readWatcher);
+    if (this._readWatcher instanceof SocketReader) {
+      socketReaders.free(this._readWatcher);
+    } else {
+      ioWatchers.free(this._readWatcher);
+    }
     this._readWatcher = null;
   }
 
@@ -907,6 +969,10 @@ function Server(/* [ options, ] listener */) {
 
   self.allowHalfOpen = options.allowHalfOpen || false;
 
+  // SO_REUSEPORT: several servers, usually in different processes, listen on
+  // the same port and the kernel balances the connections between them.
+  self.reusePort = options.reusePort || false;
+
   self.watcher = new IOWatcher();
   self.watcher.host = self;
   self.watcher.callback = function() {
@@ -919,26 +985,30 @@ function Server(/* [ options, ] listener */) {
       self.watcher.stop();
     }
 
-    while (typeof self.fd === 'number') {
-      try {
-        var peerInfo = accept(self.fd);
-      } catch (e) {
-        if (e.errno != EMFILE) throw e;
+    if (typeof self.fd !== 'number') return;
 
-        // Gracefully reject pending clients by freeing up a file
-        // descriptor.
-        rescueEMFILE(function() {
-          self._rejectPending();
-        });
-        return;
-      }
-      if (!peerInfo) return;
+    try {
+      var peers = accept(self.fd, kAcceptBatch);
+    } catch (e) {
+      if (e.errno != EMFILE) throw e;
 
-      if (self.maxConnections && self.connections >= self.maxConnections) {
-        // Close the connection we just had
-        close(peerInfo.fd);
-        // Reject all other pending connectins.
+      // Gracefully reject pending clients by freeing up a file
+      // descriptor.
+      rescueEMFILE(function() {
         self._rejectPending();
+      });
+      return;
+    }
+
+    for (var i = 0; i < peers.length; i++) {
+      var peerInfo = peers[i];
+
+      if (typeof self.fd !== 'number' ||
+          (self.maxConnections && self.connections >= self.maxConnections)) {
+        // Close the connections we just had
+        for (; i < peers.length; i++) close(peers[i].fd);
+        // Reject all other pending connectins.
+        if (typeof self.fd === 'number') self._rejectPending();
         return;
       }
 
@@ -963,7 +1033,6 @@ function Server(/* [ options, ] listener */) {
         s.emit('connect');
       } catch (e) {
         s.destroy(e);
-        return;
       }
     }
   };
@@ -1000,21 +1069,13 @@ Server.prototype.pause = function(msecs) {
 
 
 Server.prototype._rejectPending = function() {
-  var self = this;
-  var acceptCount = 0;
-  // Accept and close the waiting clients one at a time.
+  // Accept and close the waiting clients.
   // Single threaded programming ftw.
-  while (true) {
-    var peerInfo = accept(this.fd);
-    if (!peerInfo) return;
-    close(peerInfo.fd);
-
-    // Don't become DoS'd by incoming requests
-    if (++acceptCount > 50) {
-      this.pause();
-      return;
-    }
-  }
+  var peers = accept(this.fd, 51);
+  for (var i = 0; i < peers.length; i++) close(peers[i].fd);
+
+  // Don't become DoS'd by incoming requests
+  if (peers.length > 50) this.pause();
 };
 
 
@@ -1105,6 +1166,7 @@ Server.prototype._doListen = function() {
   getDummyFD();
 
   try {
+    if (self.reusePort && self.type != 'unix') setReusePort(self.fd, true);
     bind(self.fd, arguments[0], arguments[1]);
   } catch (err) {
     self.close();
@@ -9,6 +9,7 @@ var TCP = process.binding('tcp_wrap').TCP;
 var FLAG_GOT_EOF      = 1 << 0;
 var FLAG_SHUTDOWN     = 1 << 1;
 var FLAG_DESTROY_SOON = 1 << 2;
+var FLAG_CORKED       = 1 << 3;
 
 
 var debug;
@@ -39,6 +40,8 @@ function initSocketHandle(self) {
 
   self._flags = 0;
   self._connectQueueSize = 0;
+  self._corkQueue = null;
+  self._corkQueueSize = 0;
   self.destroyed = false;
 }
 
@@ -111,7 +114,8 @@ Object.defineProperty(Socket.prototype, 'readyState', {
 
 Object.defineProperty(Socket.prototype, 'bufferSize', {
   get: function() {
-    return this._handle.writeQueueSize + this._connectQueueSize;
+    return this._handle.writeQueueSize + this._connectQueueSize +
+           this._corkQueueSize;
   }
 });
 
@@ -128,9 +132,10 @@ Socket.prototype.resume = function() {
 
 Socket.prototype.end = function(data, encoding) {
   if (!this.writable) return;
-  this.writable = false;
 
   if (data) this.write(data, encoding);
+  this.uncork();
+  this.writable = false;
   DTRACE_NET_STREAM_END(this);
 
   if (this._flags & FLAG_GOT_EOF) {
@@ -156,6 +161,7 @@ function afterShutdown(status, handle, req) {
 
 
 Socket.prototype.destroySoon = function() {
+  this.uncork();
   this.writable = false;
   this._flags |= FLAG_DESTROY_SOON;
 
@@ -177,6 +183,10 @@ Socket.prototype.destroy = function(exception) {
 
   self._connectQueueCleanUp();
 
+  this._flags &= ~FLAG_CORKED;
+  this._corkQueue = null;
+  this._corkQueueSize = 0;
+
   debug('destroy ' + this.fd);
 
   this.readable = this.writable = false;
@@ -291,6 +301,16 @@ Socket.prototype.write = function(data /* [encoding], [fd], [cb] */) {
     return false;
   }
 
+  // Corked, collect it for a single writeBuffers() on uncork.
+  if (this._flags & FLAG_CORKED) {
+    this._corkQueueSize += data.length;
+    if (this._corkQueue) {
+      this._corkQueue.push([data, cb]);
+    } else {
+      this._corkQueue = [ [data, cb] ];
+    }
+    return true;
+  }
 
   var writeReq = this._handle.write(data);
   writeReq.oncomplete = afterWrite;
@@ -301,6 +321,52 @@ Socket.prototype.write = function(data /* [encoding], [fd], [cb] */) {
 };
 
 
+// Holds back writes until uncork(), which sends them all as one request
+// (one writev() in libuv) instead of one request per write().
+Socket.prototype.cork = function() {
+  this._flags |= FLAG_CORKED;
+};
+
+
+Socket.prototype.uncork = function() {
+  if (!(this._flags & FLAG_CORKED)) return;
+  this._flags &= ~FLAG_CORKED;
+
+  var queue = this._corkQueue;
+  if (!queue) return;
+  this._corkQueue = null;
+  this._corkQueueSize = 0;
+
+  if (queue.length == 1) {
+    this.write(queue[0][0], queue[0][1]);
+    return;
+  }
+
+  var buffers = new Array(queue.length);
+  var callbacks = null;
+  for (var i = 0; i < queue.length; i++) {
+    buffers[i] = queue[i][0];
+    if (queue[i][1]) {
+      if (!callbacks) callbacks = [];
+      callbacks.push(queue[i][1]);
+    }
+  }
+
+  var writeReq = this._handle.writeBuffers(buffers);
+  if (!writeReq) {
+    this.destroy(errnoException(errno, 'write'));
+    return;
+  }
+  writeReq.oncomplete = afterWrite;
+  if (callbacks) {
+    writeReq.cb = function() {
+      for (var i = 0; i < callbacks.length; i++) callbacks[i]();
+    };
+  }
+  this._writeRequests.push(writeReq);
+};
+
+
 function afterWrite(status, handle, req, buffer) {
   var self = handle.socket;
 
@@ -401,10 +467,13 @@ function afterConnect(status, handle, req) {
 
     if (self._connectQueue) {
       debug('Drain the connect queue');
+      var corked = self._flags & FLAG_CORKED;
+      self.cork();
       for (var i = 0; i < self._connectQueue.length; i++) {
         self.write.apply(self, self._connectQueue[i]);
       }
       self._connectQueueCleanUp()
+      if (!corked) self.uncork();
     }
 
     self.emit('connect');
@@ -450,6 +519,10 @@ function Server(/* [ options, ] listener */) {
   this.connections = 0;
   this.allowHalfOpen = options.allowHalfOpen || false;
 
+  // SO_REUSEPORT: several servers, usually in different processes, listen on
+  // the same port and the kernel balances the connections between them.
+  this.reusePort = options.reusePort || false;
+
   this._handle = null;
 }
 util.inherits(Server, events.EventEmitter);
@@ -467,7 +540,11 @@ function listenip(self, ip, port, addressType) {
   self._handle.socket = self;
   self._handle.onconnection = onconnection;
 
-  if (ip && port) {
+  if (self.reusePort) {
+    r = self._handle.setReusePort(true);
+  }
+
+  if (!r && ip && port) {
     debug("bind to " + ip);
     if (addressType == 6) {
       r = self._handle.bind6(ip, port);
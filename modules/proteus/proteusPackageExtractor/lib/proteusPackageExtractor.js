@@ -228,6 +228,9 @@ var unZipAndInstall = function(package, installPath, moduleName){
 
 		fs.renameSync(tempPath , installPath);
 
+		// pages loading the module from now on must not get the old sources
+		process.invalidateModuleCache(installPath);
+
 		console.info("Done with the Move ");
 
         // delete the downloaded file & temp folder.
@@ -238,6 +241,7 @@ var unZipAndInstall = function(package, installPath, moduleName){
 		fs.rmdirRSync(TEMP_PATH);
 		// delete files/folder install path folder.
 		fs.rmdirRSync(installPath);
+		process.invalidateModuleCache(installPath);
 		throw ("Zip contents are invalid");
       }
 }
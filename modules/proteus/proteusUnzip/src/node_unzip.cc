@@ -131,6 +131,8 @@ class UnzipUtil: ObjectWrap {
       unsize = get_zipentry_size(entry);
       size = unsize * 1.001;
       scratch = malloc(size);
+      if (!scratch)
+	return v8::ThrowException(v8::String::New("out of memory"));
 
       NODE_LOGI("%s, scratch=%p\n", __FUNCTION__, scratch);
 
@@ -138,12 +140,15 @@ class UnzipUtil: ObjectWrap {
       err = decompress_zipentry(entry, scratch, size);
       if (err != 0) {
 	NODE_LOGI("%s, error decompressing file\n", __FUNCTION__);
+	free(scratch);
 	return v8::ThrowException(v8::String::New("error decompressing file"));
       }
 
-      node::Buffer *return_buffer = node::Buffer::New( (char*)scratch, size );
-
-      free(scratch);
+      // the buffer takes the scratch memory over, no copy
+      node::Buffer *return_buffer = node::Buffer::Adopt((char*)scratch, size,
+	  node::Buffer::ReleaseFree, NULL);
+      if (!return_buffer)
+	return v8::ThrowException(v8::String::New("out of memory"));
 
       return scope.Close( return_buffer->handle_ );
 
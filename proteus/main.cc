@@ -33,6 +33,7 @@
 #include <unistd.h>
 #include <pthread.h>
 #include <errno.h>
+#include <poll.h>
 #include <v8.h>
 #include <vector>
 
@@ -57,6 +58,8 @@ class NodeProxy : public NodeClient {
     void runTest(const char *test);
     static int* pipefd(){ return s_pipefd; }
     void processNodeEvents();
+    void processNodeEventsEmbedded();
+    void dumpInstanceStats();
 
     // NodeClient interface
     void HandleNodeEvent(NodeEvent *ev);
@@ -77,6 +80,8 @@ class NodeProxy : public NodeClient {
 
 bool s_multiple = false;
 bool s_parallel = false;
+bool s_embedded = false;
+int s_deadline = 0;
 int s_useMultipleContexts = 0;
 int s_runTestsInNewNodeParallely = 0;
 int s_runTestsInNewNodeSerially = 0;
@@ -169,7 +174,27 @@ char* BrowserCode(const char *test) {
   return jssource;
 }
 
+// DEADLINE=<ms> drains in slices of at most that long, as a browser would
+// with a task per slice
+static bool InvokePending() {
+  if (!s_deadline) {
+    return Node::InvokePending();
+  }
+
+  bool more = true;
+  bool done = false;
+  while (more && !done) {
+    done = Node::InvokePending(s_deadline, &more);
+  }
+  return done;
+}
+
 void NodeProxy::processNodeEvents() {
+  if (s_embedded) {
+    processNodeEventsEmbedded();
+    return;
+  }
+
   NODE_LOGF();
   HandleScope scope;
 
@@ -184,7 +209,7 @@ void NodeProxy::processNodeEvents() {
     }
     else if (s[0] == '0') {
       NODE_LOGM("%s, ** wakeup handling pending callbacks", __FUNCTION__);
-      if (Node::InvokePending()) {
+      if (InvokePending()) {
         Node::CheckTestStatus(false);
         NODE_LOGE("%s, InvokePending returned done processing", __FUNCTION__);
         if (s_nodes.size() <= 1) {
@@ -210,6 +235,56 @@ void NodeProxy::processNodeEvents() {
   NODE_LOGFR();
 }
 
+// LOOP_EMBEDDED: no libev thread, we wait on the backend fd (and the pipe for
+// OnTestDone) ourselves and run the ready callbacks in place
+void NodeProxy::processNodeEventsEmbedded() {
+  NODE_LOGF();
+  HandleScope scope;
+
+  struct pollfd fds[2];
+  fds[0].fd = Node::BackendFd();
+  fds[0].events = POLLIN;
+  fds[1].fd = s_pipefd[0];
+  fds[1].events = POLLIN;
+
+  m_testDone = false;
+  while (1) {
+    int timeout = -1;
+    if (Node::RunOnce(&timeout)) {
+      Node::CheckTestStatus(false);
+      NODE_LOGE("%s, RunOnce returned done processing", __FUNCTION__);
+      if (s_nodes.size() <= 1) {
+        NODE_LOGFR();
+        return;
+      }
+    }
+
+    if (!Node::LoopAlive()) {
+      NODE_LOGD("%s, ** done event processing ", __FUNCTION__);
+      Node::CheckTestStatus(true);
+      NODE_LOGFR();
+      return;
+    }
+
+    fds[0].revents = fds[1].revents = 0;
+    int ret = poll(fds, 2, timeout);
+    if (ret == -1 && errno != EINTR) {
+      NODE_LOGE("%s, **error** poll failed: %s", __FUNCTION__, strerror(errno));
+      return;
+    }
+
+    if (fds[1].revents & POLLIN) {
+      char s[2] = "";
+      read(s_pipefd[0], s, sizeof(s));
+      // NODE_EVENT_TEST_DONE
+      if (s[0] == '2' && s_nodes.size() <= 1) {
+        NODE_LOGFR();
+        return;
+      }
+    }
+  }
+}
+
 Handle<Value> NodeProxy::loadModuleCallback(const Arguments& args) {
   NODE_LOGF();
 
@@ -220,8 +295,15 @@ Handle<Value> NodeProxy::loadModuleCallback(const Arguments& args) {
 
   Handle<Object> navigator = args.Holder()->ToObject();
   NodeProxy *np = static_cast<NodeProxy*>(navigator->GetPointerFromInternalField(0));
-  np->m_node = new Node(np);
+  np->m_node = Node::Create(np);
   s_nodes.push_back(np->m_node);
+
+  // the first instance preparses the builtins, the others reuse it, with
+  // NODE_POOL=<n> the bootstrap happened ahead of time
+  InstanceStats stats;
+  Node::GetInstanceStats(np->m_node, &stats);
+  NODE_LOGI("%s, node %d bootstrapped in %.3fms, %u bytes of heap, attached in %.3fms",
+      __FUNCTION__, s_nodes.size(), stats.startup, stats.heap, stats.attach);
   Handle<Function> loadModuleSync = np->m_node->GetLoadModuleSync();
   NODE_ASSERT(!loadModuleSync.IsEmpty() && loadModuleSync->IsFunction());
   if (!loadModuleSync.IsEmpty() && loadModuleSync->IsFunction()) {
@@ -282,6 +364,52 @@ NodeProxy::~NodeProxy() {
   }
 }
 
+// libev thread handoff counters, compare NODE_HANDOFF=condvar|queue
+void DumpLoopStats() {
+  LoopStats stats;
+  Node::GetLoopStats(&stats);
+  NODE_LOGE("** loop stats: wakeups(%u) batches(%u) coalesced(%u) stalls(%u) drains(%u) idle(%u)",
+      stats.wakeups, stats.batches, stats.coalesced, stats.stalls, stats.drains,
+      stats.idleWakeups);
+  NODE_LOGE("** loop stats: handoff latency avg(%.3fms) max(%.3fms)",
+      stats.batches ? stats.latencyTotal / stats.batches : 0, stats.latencyMax);
+
+  std::string histogram;
+  for (int i = 0; i < NODE_DRAIN_BUCKETS; i++) {
+    char bucket[32];
+    snprintf(bucket, sizeof(bucket), " %s%dms(%u)", i < NODE_DRAIN_BUCKETS - 1 ? "<" : ">=",
+        1 << (i < NODE_DRAIN_BUCKETS - 1 ? i : i - 1), stats.drainHistogram[i]);
+    histogram += bucket;
+  }
+  NODE_LOGE("** loop stats: drains%s max(%.3fms) yields(%u)",
+      histogram.c_str(), stats.drainMax, stats.yields);
+}
+
+// bootstrapped instances handed out by Node::Create, compare NODE_POOL=<n>
+void DumpPoolStats() {
+  PoolStats stats;
+  Node::GetPoolStats(&stats);
+  if (!stats.size && !stats.refills) {
+    return;
+  }
+  NODE_LOGE("** pool stats: size(%u) ready(%u) hits(%u) misses(%u) refills(%u) refill(%.3fms) attach max(%.3fms)",
+      stats.size, stats.ready, stats.hits, stats.misses, stats.refills, stats.refillTime,
+      stats.attachMax);
+}
+
+// round-robin share of the node instance, compare the tests run with
+// MULTIPLE=1 PARALLEL=1
+void NodeProxy::dumpInstanceStats() {
+  if (!m_node) {
+    return;
+  }
+  InstanceStats stats;
+  Node::GetInstanceStats(m_node, &stats);
+  NODE_LOGE("** instance stats: %s invoked(%u) turns(%u) depth max(%u) service(%.3fms) max(%.3fms)",
+      m_test, stats.invoked, stats.turns, stats.depthMax, stats.serviceTime, stats.serviceMax);
+  NODE_LOGE("** instance stats: %s startup(%.3fms) heap(%u)", m_test, stats.startup, stats.heap);
+}
+
 int main(int argc, char *argv[]) {
   for (int i = 1; i < argc; i++){
     if (strstr(argv[i], "--wait")){
@@ -299,6 +427,12 @@ int main(int argc, char *argv[]) {
   // should we run tests parallely
   s_parallel = getenv("PARALLEL") ? true : false;
 
+  // should we drive the event loop from this thread (no libev thread)
+  s_embedded = getenv("EMBEDDED") ? true : false;
+
+  // main thread budget per InvokePending (ms), 0 drains everything
+  s_deadline = getenv("DEADLINE") ? atoi(getenv("DEADLINE")) : 0;
+
   if (s_multiple && s_parallel) {
     s_runTestsInNewNodeParallely = true;
   } else if (s_multiple && !s_parallel) {
@@ -311,7 +445,17 @@ int main(int argc, char *argv[]) {
   int ret = pipe(NodeProxy::pipefd());
   assert(ret == 0);
 
-  Node::Initialize(false, isAndroid ? "/data/data/com.android.browser" : getenv("PWD"));
+  Node::Initialize(false, isAndroid ? "/data/data/com.android.browser" : getenv("PWD"),
+      s_embedded ? LOOP_EMBEDDED : LOOP_THREAD);
+
+  // Initialize falls back to the libev thread if the backend has no fd
+  if (s_embedded && Node::BackendFd() < 0) {
+    NODE_LOGW("** embedded loop not supported, using the libev thread");
+    s_embedded = false;
+  }
+
+  // NODE_POOL=<n>: warm up the pool before the first test asks for a node
+  Node::RefillPool(0);
   int nTests = argc - 1;
   if (s_useMultipleContexts) {
     NodeProxy *tests = new NodeProxy[nTests];
@@ -329,6 +473,9 @@ int main(int argc, char *argv[]) {
       proxy[i-1].runTest(argv[i]);
     }
     proxy[0].processNodeEvents();
+    for (int i = 0; i < nTests; i++ ) {
+      proxy[i].dumpInstanceStats();
+    }
     NODE_LOGI("main, deleting NodeProxy for all tests");
     delete []proxy;
   }
@@ -351,5 +498,7 @@ int main(int argc, char *argv[]) {
     }
   }
 
+  DumpLoopStats();
+  DumpPoolStats();
   return 0;
 }
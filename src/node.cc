@@ -29,29 +29,76 @@
 #include <string.h>
 #include <unistd.h>
 #include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
 #include <sys/types.h>
+#include <sys/stat.h>
 #include <dlfcn.h>
 #include <stdarg.h>
 #include <sys/syscall.h>
 #include <sys/time.h>
+#include <time.h>
 
 #include <node_buffer.h>
 #include <node_io_watcher.h>
+#include <node_socket_reader.h>
 #include <node_timer.h>
 #include <node_constants.h>
 #include <node_javascript.h>
 #include <node_string.h>
+#include <node_buffer_codec.h>
 #include <node_script.h>
+#include <platform.h>
+
+#include <map>
 
 #ifdef ANDROID
 #include <sys/system_properties.h>
 #endif
 
+#ifdef __linux__
+#include <sys/eventfd.h>
+#endif
+
 namespace node {
 
 using namespace v8;
 using namespace std;
 
+// a batch of pending watchers handed over by the libev thread, the watchers
+// themselves stay in libev's pending array
+struct PendingBatch {
+  double postedAt;
+  unsigned int pending;
+};
+
+// max callbacks of one node instance invoked before moving to the next one
+#define NODE_DISPATCH_BUDGET 64
+
+// a slot of libev's pending queue, see DispatchPending
+struct PendingSlot {
+  int pri;
+  int slot;
+};
+
+// wrapped source and preparse data of an installed module, shared by the
+// external strings of all the node instances that compiled it
+struct ModuleSource {
+  ino_t ino;          // an install renames the new files in place
+  time_t mtime;
+  long mtimeNsec;     // rewrites within the same second
+  off_t size;
+  char *ascii;        // one of the two, the other one is NULL
+  uint16_t *twoByte;
+  size_t length;
+  ScriptData *preparse;
+  int refs;           // the cache and every external string made from it
+
+  Local<String> NewString();
+  size_t Bytes() const { return ascii ? length : length * sizeof(uint16_t); }
+  void Unref();
+};
+
 class NodeStatic {
   public:
     static NodeStatic* instance() {
@@ -59,15 +106,18 @@ class NodeStatic {
       return s_instance;
     }
 
-    static void create(bool isBrowser, std::string moduleRootPath) {
+    static void create(bool isBrowser, std::string moduleRootPath, LoopMode loopMode) {
       NODE_ASSERT(!s_instance);
-      s_instance = new NodeStatic(isBrowser, moduleRootPath);
+      s_instance = new NodeStatic(isBrowser, moduleRootPath, loopMode);
     }
 
   private:
-    NodeStatic(bool isBrowser, std::string moduleRootPath);
+    NodeStatic(bool isBrowser, std::string moduleRootPath, LoopMode loopMode);
     static NodeStatic* s_instance;
 
+    // thread (default) or embedder driven event loop
+    LoopMode s_loopMode;
+
     // idle watcher for triggering another eio_poll
     uv_idle_t s_eio_poller;
 
@@ -86,12 +136,89 @@ class NodeStatic {
     pthread_mutex_t s_mutex;
     pthread_cond_t s_cond;
 
+    // REQ: pending batches are handed over either in lock-step (condvar, the
+    // libev thread waits till the main thread has invoked them) or queued
+    // (queue, the libev thread goes back to polling and only waits when it
+    // has nothing new to hand over). Set with NODE_HANDOFF. Both hand over
+    // under s_mutex: the pending watchers live in libev's pending array,
+    // which the drain and the libev thread must not touch at the same time
+    enum HandoffMode { HANDOFF_CONDVAR, HANDOFF_QUEUE };
+    HandoffMode s_handoffMode;
+
+    // batches handed over by the libev thread, drained by the main thread,
+    // both with s_mutex held
+    vector<PendingBatch> s_batches;
+
+    // queue mode: a wakeup was posted and the main thread has not drained yet
+    bool s_handoffOutstanding;
+
+    // queue mode: ev_pending_count when the last batch was handed over
+    unsigned int s_handedOff;
+
+    // a wakeup went out and InvokePending has not drained yet, with several
+    // clients notified for the same batch only the first one has work to do
+    volatile bool s_invokePosted;
+
+    // queue mode: libev thread is blocked in the backend poll without s_mutex
+    volatile bool s_evThreadPolling;
+
+    // queue mode: wakes up the libev thread so that it picks up the
+    // watchers started/stopped by the main thread while it was polling
+    uv_async_t s_loop_wakeup;
+
+    LoopStats s_loopStats;
+
+    // REQ: while the loop has no active watchers, the libev thread blocks on
+    // s_idle_fd (an eventfd, a pipe elsewhere) till LoopActivated signals it
+    int s_idle_fd[2];
+    volatile bool s_evThreadIdle;
+
     // global list of all active v8 contexts
     std::vector<v8::Persistent<v8::Context>* > s_contexts;
 
+    // process/test objects of every node instance, see CreateTemplates
+    v8::Persistent<v8::FunctionTemplate> s_processTemplate;
+    v8::Persistent<v8::FunctionTemplate> s_testTemplate;
+    void CreateTemplates();
+    static void SetTemplateMethod(v8::Handle<v8::ObjectTemplate> t, const char *name,
+        v8::InvocationCallback callback);
+
     // global list of all active nodes
     std::vector<Node*> s_nodes;
 
+    // REQ: bootstrapped node instances without a client, handed out by
+    // Node::Create and topped up while the loop has nothing else to do
+    std::vector<Node*> s_pool;
+    unsigned int s_poolSize;
+    PoolRefill s_poolRefill;
+    PoolStats s_poolStats;
+    uv_idle_t s_poolRefiller;
+
+    Node* Create(NodeClient *client);
+    void SetPoolSize(unsigned int size, PoolRefill refill);
+
+    // bootstraps instances till the pool is full or end (Now() based, 0 for
+    // none) has passed, at least one if the pool is not full
+    bool RefillPool(double end);
+    void StartPoolRefill();
+    void StopPoolRefill();
+    static void PoolRefiller(uv_idle_t* watcher, int status);
+
+    // REQ: installed modules, by resolved path, see Node::InvalidateModuleCache
+    std::map<std::string, ModuleSource*> s_moduleCache;
+    ModuleCacheStats s_moduleCacheStats;
+    ModuleSource* LookupModule(const char *filename);
+    void InvalidateModuleCache(const std::string& path);
+
+    // guards s_nodes against the libev thread looking up the clients to notify
+    pthread_mutex_t s_nodesMutex;
+
+    // InstanceStats of the watchers that belong to no node instance
+    InstanceStats s_sharedStats;
+
+    // owner index the next drain starts with, after one stopped at its deadline
+    size_t s_dispatchNext;
+
     bool s_lockState;
     int s_updateCheck; // notStarted = 0 ,  inProgress = 1 , Completed = 2 .
     std::vector< v8::Persistent<v8::Function> > s_lockList;
@@ -128,12 +255,46 @@ class NodeStatic {
     // is done processing
     static void EvThreadPendingCallback(struct ev_loop *loop);
 
+    // queue mode, called on the libev thread with s_mutex held
+    void HandOff(struct ev_loop *loop);
+    void PostBatch(struct ev_loop *loop, bool wakeup);
+
+    // sends NODE_EVENT_LIBEV_INVOKE_PENDING to the clients with pending work
+    void NotifyClients(struct ev_loop *loop);
+
+    // main thread, runs the pending callbacks round-robin per node instance
+    // till end (Now() based, 0 for none), true if it stopped with work left
+    bool DispatchPending(double end);
+
+    // time the main thread spent in a drain, for the histogram
+    void RecordDrain(double elapsed);
+
+    // NULL if the node instance is gone (e.g. deleted from a callback)
+    InstanceStats* InstanceStatsFor(Node *owner);
+
+    // LOOP_EMBEDDED, ev_invoke_pending replacement
+    static void EmbeddedInvokePending(struct ev_loop *loop);
+
+    // queue mode, unlock s_mutex while the libev thread is blocked in epoll
+    static void EvThreadRelease(struct ev_loop *loop);
+    static void EvThreadAcquire(struct ev_loop *loop);
+    static void LoopWakeup(uv_async_t* watcher, int status);
+
+    // blocks the libev thread till the first watcher gets started
+    void IdleWait();
+
+    // activecnt went from 0 to 1, can be called on any thread
+    static void LoopActivated(struct ev_loop *loop);
+
     // libev thread entry point
     // The ev_run should run forever if keepRunning is set (as in browser)
     // In test mode, it returns if there are no pending work (e.g. no watchers), and
     // sends out a NODE_EVENT_DONE to the embedder
     static void* EvThreadRun(void *data);
-    bool InvokePending();
+    bool InvokePending(int deadline, bool *more);
+
+    // LOOP_EMBEDDED, one non-blocking ev_run on the embedder's thread
+    bool RunOnce(int *timeout);
 
     // idle watcher callback that triggers eio_poll
     static void DoPoll(uv_idle_t* watcher, int status);
@@ -156,6 +317,15 @@ class NodeStatic {
     static Handle<Value> DLOpen(const Arguments& args);
     static v8::Handle<v8::Value> Compile(const v8::Arguments& args);
 
+    // rss/heap/buffer memory of the process
+    static v8::Handle<v8::Value> MemoryUsage(const v8::Arguments& args);
+
+    // process._compileModule(filename), returns the wrapped module function
+    static v8::Handle<v8::Value> CompileModule(const v8::Arguments& args);
+
+    // process.invalidateModuleCache([path]), used by the module installer
+    static v8::Handle<v8::Value> InvalidateModuleCache(const v8::Arguments& args);
+
     // creates exports object (the object returned when you do a require('..')
     static v8::Handle<v8::Value> CreateExportsObject(const v8::Arguments& args);
 
@@ -163,7 +333,7 @@ class NodeStatic {
     static void PrepareTick(uv_prepare_t* handle, int status);
     static void CheckTick(uv_check_t* handle, int status);
     static void Spin(uv_idle_t* handle, int status);
-    static v8::Handle<v8::Value> NeedTickCallback(const v8::Arguments& args);
+    static v8::Handle<v8::Value> NextTick(const v8::Arguments& args);
 
     // Registers a Permission Feature for use in the Permissions API
     static v8::Handle<v8::Value> RegisterPermissionFeatures(const v8::Arguments& args);
@@ -209,6 +379,15 @@ class NodeStatic {
     // initiliaze logging
     void ReadDebugLevel();
 
+    // NODE_HANDOFF=condvar|queue
+    void ReadHandoffMode();
+
+    // NODE_POOL=<size>, NODE_POOL_REFILL=idle|manual
+    void ReadPoolConfig();
+
+    // monotonic time in ms
+    static double Now();
+
     // Logger, similar to console.log
     static v8::Handle<v8::Value> ProcessLog(const v8::Arguments& args);
 
@@ -223,6 +402,31 @@ class NodeStatic {
     // JS API - test.watcherStats();
     static v8::Handle<v8::Value> TestWatcherStats(const v8::Arguments& args);
 
+    // libev thread handoff counters
+    // JS API - test.loopStats();
+    static v8::Handle<v8::Value> TestLoopStats(const v8::Arguments& args);
+
+    // round-robin counters of the current node instance
+    // JS API - test.instanceStats();
+    static v8::Handle<v8::Value> TestInstanceStats(const v8::Arguments& args);
+
+    // counters of the pool of bootstrapped instances
+    // JS API - test.poolStats();
+    static v8::Handle<v8::Value> TestPoolStats(const v8::Arguments& args);
+
+    // buffer allocator counters
+    // JS API - test.bufferStats();
+    static v8::Handle<v8::Value> TestBufferStats(const v8::Arguments& args);
+
+    // a buffer over malloc'd memory handed to Buffer::Adopt, the way native
+    // modules produce them
+    // JS API - test.adoptBuffer(length, value);
+    static v8::Handle<v8::Value> TestAdoptBuffer(const v8::Arguments& args);
+
+    // counters of the installed module cache
+    // JS API - test.moduleCacheStats();
+    static v8::Handle<v8::Value> TestModuleCacheStats(const v8::Arguments& args);
+
     // retreive the node instance from the process/test object internal field
     static Node* GetNodeFromProcess(v8::Handle<v8::Object> process);
     static Node* GetNodeFromTest(v8::Handle<v8::Object> test);
@@ -245,6 +449,22 @@ class NodeStatic {
 #define si() NodeStatic::instance()
 NodeStatic* NodeStatic::s_instance = 0;
 
+// REQ: watchers started while a node instance runs code outside of a libev
+// callback (loading modules, events from the embedder) belong to it, within a
+// callback libev passes on the owner of the watcher being invoked
+class OwnerScope {
+  public:
+    OwnerScope(Node *n) : m_prev(ev_owner(ev_default_loop())) {
+      ev_set_owner(ev_default_loop(), n);
+    }
+    ~OwnerScope() {
+      ev_set_owner(ev_default_loop(), m_prev);
+    }
+
+  private:
+    void *m_prev;
+};
+
 Node* NodeStatic::GetNodeFromProcess(Handle<Object> process) {
   Node *n = static_cast<Node*>(process->GetPointerFromInternalField(0));
   NODE_ASSERT(n);
@@ -297,35 +517,49 @@ void Node::Tick(void) {
   NODE_LOGM("%s", __PRETTY_FUNCTION__);
 
   // Avoid entering a V8 scope.
-  if (!m_need_tick_cb) return;
+  if (m_tickQueue.empty()) {
+    // REQ: the spinner only stops once a tick finds nothing to do, a
+    // nextTick loop keeps it running instead of restarting it every tick
+    if (uv_is_active((uv_handle_t*) &m_tick_spinner)) {
+      NODE_LOGV("this(%p), m_tick_spinner (%p) stopped", this, &m_tick_spinner);
+      uv_idle_stop(&m_tick_spinner);
+      uv_unref();
+      idle_dec();
+    }
+    return;
+  }
 
   // proteus: FIXME
   // set the context..since FatalException would need it
   Context::Scope cscope(m_context);
+  HandleScope scope;
+  Local<Object> global = m_context->Global();
 
-  m_need_tick_cb = false;
-  if (uv_is_active((uv_handle_t*) &m_tick_spinner)) {
-    NODE_LOGV("this(%p), m_tick_spinner (%p) stopped", this, &m_tick_spinner);
-    uv_idle_stop(&m_tick_spinner);
-    uv_unref();
-    idle_dec();
+  // a callback can delete us (test.deleteNode)
+  bool alive = true;
+  m_tickAlive = &alive;
+
+  // REQ: strict FIFO, callbacks queued while draining run on the next tick
+  size_t count = m_tickQueue.size();
+  for (size_t i = 0; i < count; i++) {
+    Persistent<Function> cb = m_tickQueue.front();
+    m_tickQueue.pop_front();
+
+    TryCatch try_catch;
+    cb->Call(global, 0, NULL);
+    cb.Dispose();
+    if (try_catch.HasCaught()) {
+      // the rest of the batch is left for the next tick
+      si()->FatalException(try_catch);
+      break;
+    }
+    if (!alive) {
+      return;
+    }
   }
 
-  v8::Persistent<v8::String> tick_callback_sym;
-  if (tick_callback_sym.IsEmpty()) {
-    tick_callback_sym =
-      Persistent<String>::New(String::NewSymbol("_tickCallback"));
-  }
-
-  HandleScope scope;
-  Local<Value> cb_v = m_process->Get(tick_callback_sym);
-  if (!cb_v->IsFunction()) return;
-  Local<Function> cb = Local<Function>::Cast(cb_v);
-
-  TryCatch try_catch;
-  cb->Call(m_process, 0, NULL);
-  if (try_catch.HasCaught()) {
-    si()->FatalException(try_catch);
+  if (alive) {
+    m_tickAlive = 0;
   }
 }
 
@@ -337,12 +571,18 @@ void NodeStatic::Spin(uv_idle_t* handle, int status) {
   n->Tick();
 }
 
-Handle<Value> NodeStatic::NeedTickCallback(const Arguments& args) {
-  NODE_LOGF();
+// process.nextTick(callback)
+Handle<Value> NodeStatic::NextTick(const Arguments& args) {
   HandleScope scope;
 
+  if (args.Length() < 1 || !args[0]->IsFunction()) {
+    return ThrowException(Exception::TypeError(
+          String::New("nextTick expects a function")));
+  }
+
   Node *n = GetNodeFromProcess(args.Holder());
-  n->m_need_tick_cb = true;
+  n->m_tickQueue.push_back(Persistent<Function>::New(Local<Function>::Cast(args[0])));
+
   // TODO: this tick_spinner shouldn't be necessary. An ev_prepare should be
   // sufficent, the problem is only in the case of the very last "tick" -
   // there is nothing left to do in the event loop and libev will exit. The
@@ -638,6 +878,11 @@ Local<Value> Node::Encode(const void *buf, size_t len, enum encoding encoding) {
   if (!len) return scope.Close(String::Empty());
 
   if (encoding == BINARY) {
+    // ASCII reads the same as latin1 and makes a one byte string
+    if (AsciiPrefix((const char*)buf, len) == len) {
+      return scope.Close(NewAsciiString((const char*)buf, len));
+    }
+
     const unsigned char *cbuf = static_cast<const unsigned char*>(buf);
     uint16_t * twobytebuf = new uint16_t[len];
     for (size_t i = 0; i < len; i++) {
@@ -650,7 +895,7 @@ Local<Value> Node::Encode(const void *buf, size_t len, enum encoding encoding) {
   }
 
   // utf8 or ascii encoding
-  Local<String> chunk = String::New((const char*)buf, len);
+  Local<String> chunk = NewUtf8String((const char*)buf, len);
   return scope.Close(chunk);
 }
 
@@ -697,23 +942,16 @@ ssize_t Node::DecodeWrite(char *buf, size_t buflen, Handle<Value> val, enum enco
 
   Local<String> str = val->ToString();
   if (encoding == UTF8) {
-    str->WriteUtf8(buf, buflen, NULL, String::HINT_MANY_WRITES_EXPECTED);
+    WriteUtf8String(str, buf, buflen, NULL);
     return buflen;
   }
   if (encoding == ASCII) {
-    str->WriteAscii(buf, 0, buflen, String::HINT_MANY_WRITES_EXPECTED);
+    WriteOneByteString(str, buf, buflen, true);
     return buflen;
   }
 
-  // THIS IS AWFUL!!! FIXME
   NODE_ASSERT(encoding == BINARY);
-  uint16_t * twobytebuf = new uint16_t[buflen];
-  str->Write(twobytebuf, 0, buflen, String::HINT_MANY_WRITES_EXPECTED);
-  for (size_t i = 0; i < buflen; i++) {
-    unsigned char *b = reinterpret_cast<unsigned char*>(&twobytebuf[i]);
-    buf[i] = b[0];
-  }
-  delete [] twobytebuf;
+  WriteOneByteString(str, buf, buflen, false);
   return buflen;
 }
 
@@ -881,6 +1119,29 @@ Handle<Value> NodeStatic::DLOpen(const Arguments& args) {
   return Undefined();
 }
 
+// process.memoryUsage()
+Handle<Value> NodeStatic::MemoryUsage(const Arguments& args) {
+  HandleScope scope;
+
+  size_t rss, vsize;
+  if (Platform::GetMemory(&rss, &vsize) != 0) {
+    return ThrowException(ErrnoException(errno, "GetMemory"));
+  }
+
+  HeapStatistics heap;
+  V8::GetHeapStatistics(&heap);
+
+  Local<Object> info = Object::New();
+  info->Set(String::NewSymbol("rss"), Integer::NewFromUnsigned(rss));
+  info->Set(String::NewSymbol("vsize"), Integer::NewFromUnsigned(vsize));
+  info->Set(String::NewSymbol("heapTotal"), Integer::NewFromUnsigned(heap.total_heap_size()));
+  info->Set(String::NewSymbol("heapUsed"), Integer::NewFromUnsigned(heap.used_heap_size()));
+
+  // buffers, including the ones waiting for Buffer::ReclaimPending
+  info->Set(String::NewSymbol("external"), Integer::NewFromUnsigned(Buffer::ExternalMemory()));
+  return scope.Close(info);
+}
+
 // TODO remove me before 0.4
 Handle<Value> NodeStatic::Compile(const Arguments& args) {
   HandleScope scope;
@@ -919,6 +1180,229 @@ Handle<Value> NodeStatic::Compile(const Arguments& args) {
   return scope.Close(result);
 }
 
+// the strings only hand out the buffers, V8 disposes of them on gc
+class ModuleSourceAscii : public String::ExternalAsciiStringResource {
+  public:
+    ModuleSourceAscii(ModuleSource *m) : m_source(m) { m->refs++; }
+    const char* data() const { return m_source->ascii; }
+    size_t length() const { return m_source->length; }
+    void Dispose() { m_source->Unref(); delete this; }
+
+  private:
+    ModuleSource *m_source;
+};
+
+class ModuleSourceTwoByte : public String::ExternalStringResource {
+  public:
+    ModuleSourceTwoByte(ModuleSource *m) : m_source(m) { m->refs++; }
+    const uint16_t* data() const { return m_source->twoByte; }
+    size_t length() const { return m_source->length; }
+    void Dispose() { m_source->Unref(); delete this; }
+
+  private:
+    ModuleSource *m_source;
+};
+
+Local<String> ModuleSource::NewString() {
+  if (ascii) {
+    return String::NewExternal(new ModuleSourceAscii(this));
+  }
+  return String::NewExternal(new ModuleSourceTwoByte(this));
+}
+
+void ModuleSource::Unref() {
+  if (--refs) {
+    return;
+  }
+  delete[] ascii;
+  delete[] twoByte;
+  delete preparse;
+  delete this;
+}
+
+static bool ReadModuleFile(const char *filename, std::string *content) {
+  int fd = open(filename, O_RDONLY);
+  if (fd < 0) {
+    return false;
+  }
+
+  char buf[8192];
+  ssize_t n;
+  while ((n = read(fd, buf, sizeof(buf))) != 0) {
+    if (n < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      int err = errno;
+      close(fd);
+      errno = err;
+      return false;
+    }
+    content->append(buf, n);
+  }
+  close(fd);
+  return true;
+}
+
+static long MtimeNsec(const struct stat& st) {
+#if defined(ANDROID)
+  return st.st_mtime_nsec;
+#elif defined(__linux__)
+  return st.st_mtim.tv_nsec;
+#else
+  return 0;
+#endif
+}
+
+// cache hit if the file did not change since it was cached, otherwise it is
+// read, wrapped (as Module.wrap does) and preparsed again
+ModuleSource* NodeStatic::LookupModule(const char *filename) {
+  struct stat st;
+  if (stat(filename, &st) < 0) {
+    return 0;
+  }
+
+  map<string, ModuleSource*>::iterator it = s_moduleCache.find(filename);
+  if (it != s_moduleCache.end()) {
+    ModuleSource *m = it->second;
+    if (m->ino == st.st_ino && m->mtime == st.st_mtime &&
+        m->mtimeNsec == MtimeNsec(st) && m->size == st.st_size) {
+      s_moduleCacheStats.hits++;
+      return m;
+    }
+    NODE_LOGD("%s, %s changed on disk", __FUNCTION__, filename);
+    s_moduleCacheStats.bytes -= m->Bytes();
+    s_moduleCacheStats.entries--;
+    s_moduleCache.erase(it);
+    m->Unref();
+  }
+
+  string content;
+  if (!ReadModuleFile(filename, &content)) {
+    return 0;
+  }
+  s_moduleCacheStats.misses++;
+
+  // remove shebang (the newline stays, line numbers do not change)
+  if (content.compare(0, 2, "#!") == 0) {
+    content.erase(0, content.find('\n'));
+  }
+  content.insert(0, NATIVE_WRAPPER_HEAD);
+  content.append(NATIVE_WRAPPER_TAIL);
+
+  ModuleSource *m = new ModuleSource;
+  m->ino = st.st_ino;
+  m->mtime = st.st_mtime;
+  m->mtimeNsec = MtimeNsec(st);
+  m->size = st.st_size;
+  m->ascii = 0;
+  m->twoByte = 0;
+  m->preparse = 0;
+  m->refs = 1;
+
+  bool ascii = true;
+  for (size_t i = 0; i < content.size() && ascii; i++) {
+    ascii = !(content[i] & 0x80);
+  }
+  if (ascii) {
+    m->length = content.size();
+    m->ascii = new char[m->length];
+    memcpy(m->ascii, content.data(), m->length);
+  } else {
+    HandleScope scope;
+    Local<String> utf16 = String::New(content.data(), content.size());
+    m->length = utf16->Length();
+    m->twoByte = new uint16_t[m->length];
+    utf16->Write(m->twoByte, 0, m->length);
+  }
+
+  // let the compile report syntax errors
+  {
+    HandleScope scope;
+    ScriptData *data = ScriptData::PreCompile(m->NewString());
+    if (data->HasError()) {
+      delete data;
+    } else {
+      m->preparse = data;
+    }
+  }
+
+  s_moduleCache[filename] = m;
+  s_moduleCacheStats.entries++;
+  s_moduleCacheStats.bytes += m->Bytes();
+  NODE_LOGD("%s, %s cached (%u bytes, %s)", __FUNCTION__, filename, m->Bytes(),
+      ascii ? "ascii" : "utf16");
+  return m;
+}
+
+Handle<Value> NodeStatic::CompileModule(const Arguments& args) {
+  HandleScope scope;
+
+  String::Utf8Value filename(args[0]);
+  if (!*filename) {
+    return ThrowException(Exception::TypeError(String::New("filename must be a string")));
+  }
+
+  ModuleSource *m = si()->LookupModule(*filename);
+  if (!m) {
+    return ThrowException(ErrnoException(errno, "open", "", *filename));
+  }
+
+  // as vm.runInThisContext(wrapper, filename, true) would
+  TryCatch try_catch;
+  ScriptOrigin origin(args[0]->ToString());
+  Local<Script> script = Script::Compile(m->NewString(), &origin, m->preparse);
+  if (script.IsEmpty()) {
+    Node::DisplayExceptionLine(try_catch);
+    return try_catch.ReThrow();
+  }
+
+  Local<Value> result = script->Run();
+  if (result.IsEmpty()) {
+    Node::DisplayExceptionLine(try_catch);
+    return try_catch.ReThrow();
+  }
+  return scope.Close(result);
+}
+
+// strings that are still alive keep their source, the entry only leaves the cache
+void NodeStatic::InvalidateModuleCache(const std::string& path) {
+  map<string, ModuleSource*>::iterator it = s_moduleCache.begin();
+  while (it != s_moduleCache.end()) {
+    const string& filename = it->first;
+    if (path.empty() || filename == path || (filename.compare(0, path.size(), path) == 0 &&
+          (path[path.size() - 1] == '/' || filename[path.size()] == '/'))) {
+      NODE_LOGD("%s, %s", __FUNCTION__, filename.c_str());
+      s_moduleCacheStats.entries--;
+      s_moduleCacheStats.bytes -= it->second->Bytes();
+      s_moduleCacheStats.invalidated++;
+      it->second->Unref();
+      s_moduleCache.erase(it++);
+    } else {
+      it++;
+    }
+  }
+}
+
+Handle<Value> NodeStatic::InvalidateModuleCache(const Arguments& args) {
+  HandleScope scope;
+  string path;
+  if (args.Length() > 0 && args[0]->IsString()) {
+    String::Utf8Value p(args[0]);
+    path = *p;
+  }
+  si()->InvalidateModuleCache(path);
+  return Undefined();
+}
+
+void Node::InvalidateModuleCache(const std::string& path) {
+  si()->InvalidateModuleCache(path);
+}
+
+void Node::GetModuleCacheStats(ModuleCacheStats *stats) {
+  *stats = si()->s_moduleCacheStats;
+}
+
 void Node::SetTestState(TestState state) {
   // check that we dont report results twice for the same test..
   if (m_testState == DONE) {
@@ -1220,6 +1704,7 @@ Handle<Value> NodeStatic::Binding(const Arguments& args) {
     NODE_LOGD("loaded core native module (io_watcher) in node (%p)", n);
     exports = Object::New();
     IOWatcher::Initialize(exports);
+    SocketReader::Initialize(exports);
     n->m_bindingCache->Set(module, exports);
   } else if (!strcmp(*module_v, "timer")) {
     exports = Object::New();
@@ -1362,78 +1847,123 @@ Handle<Value> NodeStatic::TestRunScript(const Arguments& args) {
   return Node::RunScriptInServiceNode(args[0]->ToString());
 }
 
-void Node::SetupProcessObject() {
-  NODE_LOGF();
-
+// REQ: the process and test objects of all the node instances come from
+// templates built once per process, a new instance only instantiates them
+void NodeStatic::CreateTemplates() {
   HandleScope scope;
-  NODE_ASSERT(Context::InContext());
 
   Local<FunctionTemplate> process_template = FunctionTemplate::New();
-  process_template->InstanceTemplate()->SetInternalFieldCount(1);
-  m_process = Persistent<Object>::New(process_template->GetFunction()->NewInstance());
-  m_process->SetPointerInInternalField(0, this);
-
-  Local<FunctionTemplate> test_template = FunctionTemplate::New();
-  test_template->InstanceTemplate()->SetInternalFieldCount(1);
-  m_test = Persistent<Object>::New(process_template->GetFunction()->NewInstance());
-  m_test->SetPointerInInternalField(0, this);
+  Local<ObjectTemplate> p = process_template->InstanceTemplate();
+  p->SetInternalFieldCount(1);
 
   // define various internal methods
-  NODE_SET_METHOD(m_process, "compile", NodeStatic::Compile);
-  NODE_SET_METHOD(m_process, "_needTickCallback", NodeStatic::NeedTickCallback);
-  NODE_SET_METHOD(m_process, "reallyExit", NodeStatic::ReallyExit);
-  NODE_SET_METHOD(m_process, "dlopen", NodeStatic::DLOpen);
-  NODE_SET_METHOD(m_process, "binding", NodeStatic::Binding);
-  NODE_SET_METHOD(m_process, "hasBinding", NodeStatic::HasBinding);
-  NODE_SET_METHOD(m_process, "log", NodeStatic::ProcessLog);
+  SetTemplateMethod(p, "compile", Compile);
+  SetTemplateMethod(p, "_compileNative", CompileNative);
+  SetTemplateMethod(p, "_compileModule", CompileModule);
+  SetTemplateMethod(p, "invalidateModuleCache", InvalidateModuleCache);
+  SetTemplateMethod(p, "nextTick", NextTick);
+  SetTemplateMethod(p, "reallyExit", ReallyExit);
+  SetTemplateMethod(p, "dlopen", DLOpen);
+  SetTemplateMethod(p, "binding", Binding);
+  SetTemplateMethod(p, "hasBinding", HasBinding);
+  SetTemplateMethod(p, "log", ProcessLog);
+  SetTemplateMethod(p, "memoryUsage", MemoryUsage);
 
   // proteus: used to create a new js object that can hold internal fields
-  NODE_SET_METHOD(m_process, "createExportsObject", NodeStatic::CreateExportsObject);
+  SetTemplateMethod(p, "createExportsObject", CreateExportsObject);
 
   // proteus: used to register a feature for Permissions API use
-  NODE_SET_METHOD(m_process, "registerPermissionFeatures", NodeStatic::RegisterPermissionFeatures);
-  NODE_SET_METHOD(m_process, "requestPermission", NodeStatic::RequestPermission);
+  SetTemplateMethod(p, "registerPermissionFeatures", RegisterPermissionFeatures);
+  SetTemplateMethod(p, "requestPermission", RequestPermission);
 
   // proteus: used to lock when loadmodule or checkUpdate is called
-  NODE_SET_METHOD(m_process, "acquireLock", NodeStatic::AcquireLock);
+  SetTemplateMethod(p, "acquireLock", AcquireLock);
 
   // proteus: used to unlock when loadmodule or checkUpdate is done
-  NODE_SET_METHOD(m_process, "releaseLock", NodeStatic::ReleaseLock);
-  NODE_SET_METHOD(m_process, "getModuleUpdates", NodeStatic::GetModuleUpdates);
-  NODE_SET_METHOD(m_process, "setModuleUpdates", NodeStatic::SetModuleUpdates);
+  SetTemplateMethod(p, "releaseLock", ReleaseLock);
+  SetTemplateMethod(p, "getModuleUpdates", GetModuleUpdates);
+  SetTemplateMethod(p, "setModuleUpdates", SetModuleUpdates);
 
   // module root
-  NODE_ASSERT(!si()->s_appPath.empty());
-  NODE_ASSERT(!si()->s_moduleDownloadPath.empty());
-  m_process->Set(String::NewSymbol("appPath"), String::New(si()->s_appPath.c_str()));
-  m_process->Set(String::NewSymbol("downloadPath"), String::New(si()->s_moduleDownloadPath.c_str()));
-  m_process->Set(String::NewSymbol("url"), String::New(m_client->url().c_str()));
-  m_process->Set(String::NewSymbol("window"), m_browserContext->Global());
-
-  // set the browser pages global object (window) as process.window
-  m_process->Set(String::NewSymbol("window"), m_browserContext->Global());
+  NODE_ASSERT(!s_appPath.empty());
+  NODE_ASSERT(!s_moduleDownloadPath.empty());
+  p->Set(String::NewSymbol("appPath"), String::New(s_appPath.c_str()));
+  p->Set(String::NewSymbol("downloadPath"), String::New(s_moduleDownloadPath.c_str()));
+  s_processTemplate = Persistent<FunctionTemplate>::New(process_template);
 
-  // create test object
-  NODE_SET_METHOD(m_test, "stack", NodeStatic::TestStack);
-  NODE_SET_METHOD(m_test, "ref", NodeStatic::TestRef);
-  NODE_SET_METHOD(m_test, "unref", NodeStatic::TestUnref);
-  NODE_SET_METHOD(m_test, "watcherStats", NodeStatic::TestWatcherStats);
-  NODE_SET_METHOD(m_test, "printJSObject", NodeStatic::TestPrintJSObject);
-  NODE_SET_METHOD(m_test, "getAddress", NodeStatic::TestGetAddress);
-  NODE_SET_METHOD(m_test, "start", NodeStatic::TestStart);
-  NODE_SET_METHOD(m_test, "check", NodeStatic::TestCheck);
-  NODE_SET_METHOD(m_test, "fail", NodeStatic::TestFail);
-  NODE_SET_METHOD(m_test, "break", NodeStatic::TestBreak);
-  NODE_SET_METHOD(m_test, "runScript", NodeStatic::TestRunScript);
+  // test object
+  Local<FunctionTemplate> test_template = FunctionTemplate::New();
+  Local<ObjectTemplate> t = test_template->InstanceTemplate();
+  t->SetInternalFieldCount(1);
+  SetTemplateMethod(t, "stack", TestStack);
+  SetTemplateMethod(t, "ref", TestRef);
+  SetTemplateMethod(t, "unref", TestUnref);
+  SetTemplateMethod(t, "watcherStats", TestWatcherStats);
+  SetTemplateMethod(t, "loopStats", TestLoopStats);
+  SetTemplateMethod(t, "instanceStats", TestInstanceStats);
+  SetTemplateMethod(t, "poolStats", TestPoolStats);
+  SetTemplateMethod(t, "moduleCacheStats", TestModuleCacheStats);
+  SetTemplateMethod(t, "bufferStats", TestBufferStats);
+  SetTemplateMethod(t, "adoptBuffer", TestAdoptBuffer);
+  SetTemplateMethod(t, "printJSObject", TestPrintJSObject);
+  SetTemplateMethod(t, "getAddress", TestGetAddress);
+  SetTemplateMethod(t, "start", TestStart);
+  SetTemplateMethod(t, "check", TestCheck);
+  SetTemplateMethod(t, "fail", TestFail);
+  SetTemplateMethod(t, "break", TestBreak);
+  SetTemplateMethod(t, "runScript", TestRunScript);
 
   // proteus: destroys the current node, useful for simulating destroying a page and testing
   // activity cancellation in different modules (e.g. fs should stop all watchers)
-  NODE_SET_METHOD(m_test, "deleteNode", NodeStatic::TestDeleteNode);
+  SetTemplateMethod(t, "deleteNode", TestDeleteNode);
+  s_testTemplate = Persistent<FunctionTemplate>::New(test_template);
+}
+
+void NodeStatic::SetTemplateMethod(Handle<ObjectTemplate> t, const char *name,
+    InvocationCallback callback) {
+  t->Set(String::NewSymbol(name), FunctionTemplate::New(callback));
+}
+
+void Node::SetupProcessObject() {
+  NODE_LOGF();
+
+  HandleScope scope;
+  NODE_ASSERT(Context::InContext());
+
+  if (si()->s_processTemplate.IsEmpty()) {
+    si()->CreateTemplates();
+  }
+
+  m_process = Persistent<Object>::New(si()->s_processTemplate->GetFunction()->NewInstance());
+  m_process->SetPointerInInternalField(0, this);
+
+  m_test = Persistent<Object>::New(si()->s_testTemplate->GetFunction()->NewInstance());
+  m_test->SetPointerInInternalField(0, this);
+
+  // pooled instances get theirs in Attach
+  if (!m_browserContext.IsEmpty()) {
+    SetupClient();
+  }
 
   Local<Object> global = Context::GetCurrent()->Global();
   global->Set(String::New("test"), m_test);
 }
 
+void Node::SetupClient() {
+  HandleScope scope;
+  NODE_ASSERT(Context::InContext());
+
+  // REQ: the node context can access the page that loaded it (and vice versa)
+  m_context->SetSecurityToken(m_browserContext->GetSecurityToken());
+
+  if (m_client) {
+    m_process->Set(String::NewSymbol("url"), String::New(m_client->url().c_str()));
+  }
+
+  // set the browser pages global object (window) as process.window
+  m_process->Set(String::NewSymbol("window"), m_browserContext->Global());
+}
+
 void Node::Load() {
   NODE_LOGF();
 
@@ -1442,10 +1972,14 @@ void Node::Load() {
   // source code.)
   // The node.js file returns a function 'f'
   TryCatch try_catch;
-  Local<Value> f_value = ExecuteString(MainSource(), IMMUTABLE_STRING("node.js"));
+  Local<Script> script = CompileMain();
+  Local<Value> f_value;
+  if (!script.IsEmpty()) {
+    f_value = script->Run();
+  }
   if (try_catch.HasCaught())  {
     si()->ReportException(try_catch, true);
-    NODE_LOGE("Test **FAILED: %s", si()->s_nodes[0]->m_moduleName.c_str());
+    NODE_LOGE("Test **FAILED: %s", m_moduleName.c_str());
     return;
   }
 
@@ -1507,6 +2041,7 @@ Handle<Value> Node::LoadModule(const Arguments& args) {
   // enter the node context
   HandleScope scope;
   Context::Scope cscope(m_context);
+  OwnerScope oscope(this);
 
   TryCatch try_catch;
   Handle<Object> holder = args.Holder()->ToObject();
@@ -1527,6 +2062,7 @@ Handle<Value> Node::LoadModuleSync(const Arguments& args) {
   // enter the node context
   HandleScope scope;
   Context::Scope cscope(m_context);
+  OwnerScope oscope(this);
 
   TryCatch try_catch;
   Handle<Object> holder = args.Holder()->ToObject();
@@ -1557,6 +2093,8 @@ void NodeStatic::Initialize() {
   RegisterSignalHandler(SIGPIPE, SIG_IGN);
   RegisterSignalHandler(SIGTRAP, SIG_IGN);
   ReadDebugLevel();
+  ReadHandoffMode();
+  ReadPoolConfig();
   uv_init();
 
   // FIXME: do we need to initialize v8 in the case of browser,
@@ -1582,6 +2120,14 @@ void NodeStatic::Initialize() {
   eio_set_max_poll_reqs(10);
   memset(&s_watchers_active, 0, sizeof(s_watchers_active));
 
+  if (s_handoffMode == HANDOFF_QUEUE) {
+    uv_async_init(&s_loop_wakeup, LoopWakeup);
+    uv_unref();
+  }
+
+  // started with the first client, see StartPoolRefill
+  uv_idle_init(&s_poolRefiller);
+
   // start the event loop
   RunEventLoop();
 }
@@ -1615,6 +2161,7 @@ void Node::EmitEvent(const char* event) {
   // caller may not have a handle scope
   // ./node test/simple/test-fs-read.js test/simple/test-fs-write.js
   HandleScope scope;
+  OwnerScope oscope(this);
   NODE_LOGV("%s, event(%s)", __FUNCTION__, event);
   Local<Value> emit_v = m_process->Get(String::New("emit"));
   NODE_ASSERT(emit_v->IsFunction());
@@ -1628,11 +2175,11 @@ void Node::EmitEvent(const char* event) {
   }
 }
 
-void Node::Initialize(bool isBrowser, std::string moduleRootPath) {
+void Node::Initialize(bool isBrowser, std::string moduleRootPath, LoopMode loopMode) {
   static bool initialized = false;
   NODE_ASSERT(!initialized);
   if (!initialized) {
-    NodeStatic::create(isBrowser, moduleRootPath);
+    NodeStatic::create(isBrowser, moduleRootPath, loopMode);
   }
   initialized = true;
 }
@@ -1642,16 +2189,20 @@ Node::Node(NodeClient *client)
   : m_testStatus(PASSED)
   , m_testState(INIT)
   , m_moduleName("(unknown)")
+  , m_tickAlive(0)
   , m_client(client)
 {
   NODE_ASSERT(si());
+  memset(&m_instanceStats, 0, sizeof(m_instanceStats));
 
   // This is required before we do the first initialize, since the thread needs it to send
   // back events and it uses s_nodes[0] - check the issue in debugger
   // run test/simple/test-fs-read.js test/simple/test-fs-write.js
   // do not add the service node to the list..
   if (client) {
+    pthread_mutex_lock(&si()->s_nodesMutex);
     si()->s_nodes.push_back(this);
+    pthread_mutex_unlock(&si()->s_nodesMutex);
   }
 
   NODE_LOGI("** %s, this(%p) client(%p)", __PRETTY_FUNCTION__, this, client);
@@ -1659,10 +2210,39 @@ Node::Node(NodeClient *client)
   // hold a reference to the browser context..
   m_browserContext = Persistent<Context>::New(Context::GetCurrent());
 
+  Bootstrap();
+
+  // reset the stopwatch
+  m_stopWatch.start();
+}
+
+Node::Node()
+  : m_testStatus(PASSED)
+  , m_testState(INIT)
+  , m_moduleName("(unknown)")
+  , m_tickAlive(0)
+  , m_client(0)
+{
+  NODE_ASSERT(si());
+  memset(&m_instanceStats, 0, sizeof(m_instanceStats));
+
+  NODE_LOGI("** %s, this(%p) pooled", __PRETTY_FUNCTION__, this);
+  Bootstrap();
+}
+
+void Node::Bootstrap() {
+  // the tick watchers and whatever the builtin modules start are ours
+  OwnerScope oscope(this);
+
+  // context creation is what a (v8) snapshot build speeds up, measure from here
+  double start = NodeStatic::Now();
+  HeapStatistics heap;
+  V8::GetHeapStatistics(&heap);
+  size_t heapBefore = heap.used_heap_size();
+
   // REQ: node modules run in a separate v8 context called the node context
   m_context = Context::New();
   si()->s_contexts.push_back(&m_context);
-  m_context->SetSecurityToken(m_browserContext->GetSecurityToken());
 
   // enter the node context
   Context::Scope cscope(m_context);
@@ -1674,12 +2254,55 @@ Node::Node(NodeClient *client)
   NODE_LOGD("%s, node::Init() complete", __FUNCTION__);
 
   Load();
-  NODE_LOGD("%s, node::Load() complete", __FUNCTION__);
+  m_instanceStats.startup = NodeStatic::Now() - start;
+  V8::GetHeapStatistics(&heap);
+  // a gc during Init/Load can leave less in use than before
+  ssize_t heapGrowth = (ssize_t)heap.used_heap_size() - (ssize_t)heapBefore;
+  m_instanceStats.heap = heapGrowth > 0 ? heapGrowth : 0;
+  NODE_LOGD("%s, node::Load() complete (%.3fms, %u bytes)", __FUNCTION__,
+      m_instanceStats.startup, m_instanceStats.heap);
+}
+
+// REQ: a pooled instance takes on the page that loads it, the same as if it
+// had been created from it
+void Node::Attach(NodeClient *client) {
+  NODE_ASSERT(client && !m_client);
+  double start = NodeStatic::Now();
+  NODE_LOGI("** %s, this(%p) client(%p)", __PRETTY_FUNCTION__, this, client);
 
-  // reset the stopwatch
+  m_client = client;
+  m_browserContext = Persistent<Context>::New(Context::GetCurrent());
+  {
+    HandleScope scope;
+    Context::Scope cscope(m_context);
+    SetupClient();
+  }
+
+  pthread_mutex_lock(&si()->s_nodesMutex);
+  si()->s_nodes.push_back(this);
+  pthread_mutex_unlock(&si()->s_nodesMutex);
+
+  m_instanceStats.attach = NodeStatic::Now() - start;
   m_stopWatch.start();
 }
 
+Node* Node::Create(NodeClient *client) {
+  return si()->Create(client);
+}
+
+void Node::SetPoolSize(unsigned int size, PoolRefill refill) {
+  si()->SetPoolSize(size, refill);
+}
+
+bool Node::RefillPool(int deadline) {
+  return si()->RefillPool(deadline > 0 ? NodeStatic::Now() + deadline : 0);
+}
+
+void Node::GetPoolStats(PoolStats *stats) {
+  *stats = si()->s_poolStats;
+  stats->ready = si()->s_pool.size();
+}
+
 Node::~Node(){
   NODE_LOGF();
 
@@ -1727,8 +2350,24 @@ Node::~Node(){
   NODE_LOGV("%s, stopping watcher (%p)",__FUNCTION__, &m_check_tick_watcher.check_watcher);
   uv_check_stop(&m_check_tick_watcher);
 
+  if (uv_is_active((uv_handle_t*) &m_tick_spinner)) {
+    uv_idle_stop(&m_tick_spinner);
+    uv_unref();
+    idle_dec();
+  }
+
+  // ticks that never got to run
+  if (m_tickAlive) {
+    *m_tickAlive = false;
+  }
+  for (deque<Persistent<Function> >::iterator it = m_tickQueue.begin();
+      it != m_tickQueue.end(); it++) {
+    it->Dispose();
+  }
+
   //remove this from vector
   bool found = false;
+  pthread_mutex_lock(&si()->s_nodesMutex);
   for (vector<Node* >::iterator it = si()->s_nodes.begin();
       it != si()->s_nodes.end(); it++) {
     if (*it == this) {
@@ -1737,8 +2376,24 @@ Node::~Node(){
       break;
     }
   }
+  pthread_mutex_unlock(&si()->s_nodesMutex);
+
+  // or from the pool, if it never got a client
+  for (vector<Node* >::iterator it = si()->s_pool.begin();
+      !found && it != si()->s_pool.end(); it++) {
+    if (*it == this) {
+      si()->s_pool.erase(it);
+      found = true;
+      break;
+    }
+  }
   NODE_ASSERT(found);
 
+  // nobody left to run the pool refill on the main thread (see StartPoolRefill)
+  if (si()->s_loopMode == LOOP_THREAD && si()->s_nodes.empty()) {
+    si()->StopPoolRefill();
+  }
+
   // let the client know we are gone
   if (m_client)
     m_client->OnDelete();
@@ -1759,6 +2414,7 @@ void Node::HandleGenericWebKitEvent(WebKitEvent* e) {
 
 void Node::HandleWebKitEvent(WebKitEvent* e) {
   NODE_LOGF();
+  OwnerScope oscope(this);
   vector<NodeModule*>::iterator it;
   for (it = m_modules.begin(); it != m_modules.end(); it++) {
     NODE_LOGV("%s, sending event to module (%d:%p)", __FUNCTION__, (*it)->Module(), *it);
@@ -1774,29 +2430,477 @@ void NodeStatic::RunEventLoop() {
   NODE_ASSERT(!called);
   called = true;
 
+  // REQ: in embedded mode the client drives the loop through BackendFd/RunOnce,
+  // no libev thread, ev_invoke_pending stays the default
+  if (s_loopMode == LOOP_EMBEDDED && ev_backend_fd(ev_default_loop()) < 0) {
+    NODE_LOGW("%s, libev backend has no fd, falling back to the libev thread", __FUNCTION__);
+    s_loopMode = LOOP_THREAD;
+  }
+  if (s_loopMode == LOOP_EMBEDDED) {
+    NODE_LOGD("%s,** event loop driven by the embedder (fd %d)", __FUNCTION__,
+        ev_backend_fd(ev_default_loop()));
+    ev_set_invoke_pending_cb(ev_default_loop(), EmbeddedInvokePending);
+    return;
+  }
+
   // set the ev_invoke_pending method and start the ev_run in separate thread
   NODE_LOGD("%s,** invoking ev loop thread", __FUNCTION__);
   ev_set_invoke_pending_cb(ev_default_loop(), EvThreadPendingCallback);
+  if (s_handoffMode == HANDOFF_QUEUE) {
+    ev_set_loop_release_cb(ev_default_loop(), EvThreadRelease, EvThreadAcquire);
+  }
+
+#ifdef __linux__
+  s_idle_fd[0] = s_idle_fd[1] = eventfd(0, 0);
+#else
+  s_idle_fd[0] = s_idle_fd[1] = -1;
+#endif
+  if (s_idle_fd[0] == -1) {
+    int ret = pipe(s_idle_fd);
+    NODE_ASSERT(ret == 0);
+    fcntl(s_idle_fd[1], F_SETFL, O_NONBLOCK);
+  }
+  // IdleWait blocks in poll and then drains every wakeup written so far
+  fcntl(s_idle_fd[0], F_SETFL, O_NONBLOCK);
+  fcntl(s_idle_fd[0], F_SETFD, FD_CLOEXEC);
+  fcntl(s_idle_fd[1], F_SETFD, FD_CLOEXEC);
+  ev_set_activate_cb(ev_default_loop(), LoopActivated);
+
   pthread_create(&s_thread, 0, EvThreadRun, 0);
 }
 
-bool NodeStatic::InvokePending() {
+void NodeStatic::IdleWait() {
+  s_evThreadIdle = true;
+  __sync_synchronize();
+
+  // a watcher could have been started between our activecnt check and
+  // setting s_evThreadIdle, LoopActivated would not have signaled it
+  if (!ev_activecnt(ev_default_loop())) {
+    pthread_mutex_unlock(&s_mutex);
+    struct pollfd pfd;
+    pfd.fd = s_idle_fd[0];
+    pfd.events = POLLIN;
+    while (poll(&pfd, 1, -1) == -1 && errno == EINTR);
+
+    // with the pipe every LoopActivated since the last wait left 8 bytes
+    // behind, leftovers would make the next wait return right away
+    uint64_t counter[8];
+    for (;;) {
+      ssize_t n = read(s_idle_fd[0], counter, sizeof(counter));
+      if (n > 0 || (n == -1 && errno == EINTR)) continue;
+      break;
+    }
+    pthread_mutex_lock(&s_mutex);
+    s_loopStats.idleWakeups++;
+  }
+
+  s_evThreadIdle = false;
+}
+
+void NodeStatic::LoopActivated(struct ev_loop *loop) {
+  __sync_synchronize();
+  if (si()->s_evThreadIdle) {
+    uint64_t one = 1;
+    // a full pipe already holds a wakeup, nothing to check
+    (void) write(si()->s_idle_fd[1], &one, sizeof(one));
+    NODE_LOGM("%s, wakeup libev thread", __FUNCTION__);
+  }
+}
+
+bool NodeStatic::InvokePending(int deadline, bool *more) {
+  NODE_ASSERT(s_loopMode == LOOP_THREAD);
   s_testDone = false;
+  if (more) {
+    *more = false;
+  }
+
+  // another client already drained this batch, in condvar mode the libev
+  // thread holds s_mutex while polling so we must not block on it
+  __sync_synchronize();
+  if (!s_invokePosted) {
+    NODE_LOGM("%s, nothing posted", __FUNCTION__);
+    return s_testDone;
+  }
 
+  double start = Now();
   pthread_mutex_lock(&s_mutex);
 
-  NODE_LOGM("ev_invoke_pending()");
-  ev_invoke_pending(ev_default_loop());
+  // the batches queued so far are exactly what the dispatch below is going
+  // to run (or keep pending)
+  double now = Now();
+  for (vector<PendingBatch>::iterator b = s_batches.begin(); b != s_batches.end(); b++) {
+    double latency = now - b->postedAt;
+    s_loopStats.latencyTotal += latency;
+    if (latency > s_loopStats.latencyMax) {
+      s_loopStats.latencyMax = latency;
+    }
+  }
+  s_batches.clear();
+  s_loopStats.drains++;
+  unsigned int modcount = ev_modcount(ev_default_loop());
+
+  bool left = DispatchPending(deadline > 0 ? start + deadline : 0);
+
+  // REQ: with work left, the client comes back without another wakeup. In
+  // condvar mode the libev thread posts the rest again as soon as we signal,
+  // in queue mode it keeps treating it as handed over (and does not spin on it)
+  s_invokePosted = left;
+  if (left) {
+    s_loopStats.yields++;
+    if (more) {
+      *more = true;
+    }
+  }
+
+  if (s_handoffMode == HANDOFF_QUEUE) {
+    s_handoffOutstanding = left;
+    s_handedOff = left ? ev_pending_count(ev_default_loop()) : 0;
+
+    // the libev thread is still polling on the watchers it had before the
+    // callbacks ran, kick it if any of them were started/stopped
+    if (s_evThreadPolling && modcount != ev_modcount(ev_default_loop())) {
+      uv_async_send(&s_loop_wakeup);
+    }
+  }
   pthread_cond_signal(&s_cond);
 
   NODE_LOGM("%s, pthread_cond_signal from main thread", __FUNCTION__);
   pthread_mutex_unlock(&s_mutex);
 
+  RecordDrain(Now() - start);
   return s_testDone;
 }
 
 bool Node::InvokePending() {
-  return si()->InvokePending();
+  return si()->InvokePending(0, 0);
+}
+
+bool Node::InvokePending(int deadline, bool *more) {
+  return si()->InvokePending(deadline, more);
+}
+
+void NodeStatic::RecordDrain(double elapsed) {
+  int bucket = 0;
+  for (double limit = 1; elapsed >= limit && bucket < NODE_DRAIN_BUCKETS - 1; limit *= 2) {
+    bucket++;
+  }
+  s_loopStats.drainHistogram[bucket]++;
+  if (elapsed > s_loopStats.drainMax) {
+    s_loopStats.drainMax = elapsed;
+  }
+}
+
+// REQ: pending callbacks are drained round-robin per node instance, at most
+// NODE_DISPATCH_BUDGET at a time, so that a busy page can not hold back the
+// callbacks of the others till all of its own have run. The pending queue is
+// sorted by owner in one pass, and again only when callbacks queued more
+bool NodeStatic::DispatchPending(double end) {
+  struct ev_loop *loop = ev_default_loop();
+
+  // buffers collected since the last drain, by the callbacks or the pages
+  Buffer::ReclaimPending();
+
+  // the shared watchers (e.g. eio) get the first turn of every round but the
+  // one resuming after a deadline, the callbacks of the instances usually
+  // depend on them
+  vector<Node*> owners;
+  map<void*, size_t> ownerIndex;
+  vector< vector<PendingSlot> > slots;
+  vector<size_t> next;
+  for (int split = 0; ; split++) {
+    // callbacks can create and delete node instances, rebuilt every split
+    owners.assign(1, (Node*)0);
+    owners.insert(owners.end(), s_nodes.begin(), s_nodes.end());
+    owners.insert(owners.end(), s_pool.begin(), s_pool.end());
+    if (s_serviceNode) {
+      owners.push_back(s_serviceNode);
+    }
+    ownerIndex.clear();
+    for (size_t i = 0; i < owners.size(); i++) {
+      ownerIndex[owners[i]] = i;
+    }
+
+    // highest priority and oldest first, watchers of deleted instances are
+    // left for the ev_invoke_pending at the end
+    slots.assign(owners.size(), vector<PendingSlot>());
+    size_t total = 0;
+    for (int pri = EV_MAXPRI - EV_MINPRI; pri >= 0; pri--) {
+      int count = ev_pending_slots(loop, pri);
+      for (int slot = 0; slot < count; slot++) {
+        void *owner;
+        if (!ev_pending_slot_owner(loop, pri, slot, &owner)) {
+          continue;
+        }
+        map<void*, size_t>::iterator it = ownerIndex.find(owner);
+        if (it != ownerIndex.end()) {
+          PendingSlot ps = { pri, slot };
+          slots[it->second].push_back(ps);
+          total++;
+        }
+      }
+    }
+    if (!total) {
+      break;
+    }
+
+    if (split == 0) {
+      for (size_t i = 0; i < owners.size(); i++) {
+        InstanceStats *stats = InstanceStatsFor(owners[i]);
+        stats->depth = slots[i].size();
+        if (stats->depth > stats->depthMax) {
+          stats->depthMax = stats->depth;
+        }
+      }
+    }
+
+    next.assign(owners.size(), 0);
+    bool progress = true;
+    for (int round = 0; progress; round++) {
+      progress = false;
+
+      size_t first = split == 0 && round == 0 ? s_dispatchNext : 0;
+      for (size_t k = 0; k < owners.size(); k++) {
+        size_t i = (first + k) % owners.size();
+        if (next[i] == slots[i].size()) {
+          continue;
+        }
+        progress = true;
+
+        // a callback can delete any node instance (test.deleteNode)
+        if (!InstanceStatsFor(owners[i])) {
+          next[i] = slots[i].size();
+          continue;
+        }
+
+        double start = Now();
+        NODE_LOGM("%s, turn of %p", __FUNCTION__, owners[i]);
+        int invoked = 0;
+        while (next[i] < slots[i].size() && invoked < NODE_DISPATCH_BUDGET) {
+          PendingSlot ps = slots[i][next[i]++];
+          // skipped if an earlier callback stopped the watcher
+          invoked += ev_invoke_pending_slot(loop, ps.pri, ps.slot);
+        }
+        if (!invoked) {
+          continue;
+        }
+
+        double now = Now();
+        InstanceStats *stats = InstanceStatsFor(owners[i]);
+        if (stats) {
+          double elapsed = now - start;
+          stats->invoked += invoked;
+          stats->turns++;
+          stats->serviceTime += elapsed;
+          if (elapsed > stats->serviceMax) {
+            stats->serviceMax = elapsed;
+          }
+        }
+
+        // REQ: yield back to the client once the deadline has passed, the next
+        // drain picks up with the instances that come after this one
+        if (end && now >= end) {
+          ev_pending_compact(loop);
+          if (ev_pending_count(loop)) {
+            NODE_LOGM("%s, deadline passed with %u pending", __FUNCTION__, ev_pending_count(loop));
+            s_dispatchNext = i + 1;
+            return true;
+          }
+          s_dispatchNext = 0;
+          return false;
+        }
+      }
+    }
+
+    // everything sorted out above has run, the slot numbers are stale now
+    ev_pending_compact(loop);
+  }
+
+  // whatever is left belongs to deleted instances
+  NODE_LOGM("ev_invoke_pending()");
+  ev_invoke_pending(loop);
+  s_dispatchNext = 0;
+  return false;
+}
+
+InstanceStats* NodeStatic::InstanceStatsFor(Node *owner) {
+  if (!owner) {
+    return &s_sharedStats;
+  }
+  if (owner == s_serviceNode) {
+    return &owner->m_instanceStats;
+  }
+  for (vector<Node*>::iterator it = s_nodes.begin(); it != s_nodes.end(); it++) {
+    if (*it == owner) {
+      return &owner->m_instanceStats;
+    }
+  }
+  for (vector<Node*>::iterator it = s_pool.begin(); it != s_pool.end(); it++) {
+    if (*it == owner) {
+      return &owner->m_instanceStats;
+    }
+  }
+  return 0;
+}
+
+Node* NodeStatic::Create(NodeClient *client) {
+  NODE_ASSERT(client);
+  Node *n;
+  bool pooled = !s_pool.empty();
+  if (!pooled) {
+    if (s_poolSize) {
+      s_poolStats.misses++;
+    }
+    n = new Node(client);
+  } else {
+    // oldest first, its callbacks (if any) have had the most time to run
+    n = s_pool.front();
+    s_pool.erase(s_pool.begin());
+    n->Attach(client);
+    s_poolStats.hits++;
+    if (n->m_instanceStats.attach > s_poolStats.attachMax) {
+      s_poolStats.attachMax = n->m_instanceStats.attach;
+    }
+  }
+  NODE_LOGD("%s, node(%p) %s, %u pooled", __FUNCTION__, n,
+      pooled ? "from the pool" : "bootstrapped", s_pool.size());
+
+  StartPoolRefill();
+  return n;
+}
+
+void NodeStatic::SetPoolSize(unsigned int size, PoolRefill refill) {
+  NODE_LOGI("%s, size(%u) refill(%s)", __FUNCTION__, size,
+      refill == POOL_REFILL_IDLE ? "idle" : "manual");
+  s_poolSize = size;
+  s_poolRefill = refill;
+  s_poolStats.size = size;
+
+  // the destructor takes it out of the pool
+  while (s_pool.size() > s_poolSize) {
+    delete s_pool.back();
+  }
+
+  if (s_poolRefill == POOL_REFILL_IDLE) {
+    StartPoolRefill();
+  } else {
+    StopPoolRefill();
+  }
+}
+
+bool NodeStatic::RefillPool(double end) {
+  while (s_pool.size() < s_poolSize) {
+    HandleScope scope;
+    double start = Now();
+    s_pool.push_back(new Node());
+    double now = Now();
+    s_poolStats.refills++;
+    s_poolStats.refillTime += now - start;
+    if (end && now >= end) {
+      break;
+    }
+  }
+  return s_pool.size() >= s_poolSize;
+}
+
+void NodeStatic::StartPoolRefill() {
+  if (s_poolRefill != POOL_REFILL_IDLE || s_pool.size() >= s_poolSize ||
+      uv_is_active((uv_handle_t*) &s_poolRefiller)) {
+    return;
+  }
+
+  // without a client there is nobody to run the idle turns on the main
+  // thread (see EvThreadPendingCallback), the first Create starts it
+  if (s_loopMode == LOOP_THREAD && s_nodes.empty()) {
+    return;
+  }
+
+  // the refill belongs to none of the instances, and does not keep the
+  // loop alive (uv_idle_start unrefs)
+  OwnerScope oscope(0);
+  uv_idle_start(&s_poolRefiller, PoolRefiller);
+  idle_inc();
+  NODE_LOGV("%s, s_poolRefiller(%p) started", __FUNCTION__, &s_poolRefiller);
+}
+
+void NodeStatic::StopPoolRefill() {
+  if (uv_is_active((uv_handle_t*) &s_poolRefiller)) {
+    uv_idle_stop(&s_poolRefiller);
+    idle_dec();
+    NODE_LOGV("%s, s_poolRefiller(%p) stopped", __FUNCTION__, &s_poolRefiller);
+  }
+}
+
+// REQ: libev only runs idle watchers when nothing else is pending, one
+// instance per idle turn so that the pages never wait for more than one
+void NodeStatic::PoolRefiller(uv_idle_t* watcher, int status) {
+  NODE_ASSERT(watcher == &si()->s_poolRefiller);
+  if (si()->RefillPool(Now())) {
+    si()->StopPoolRefill();
+  }
+}
+
+void NodeStatic::EmbeddedInvokePending(struct ev_loop *loop) {
+  NODE_ASSERT(loop == ev_default_loop());
+  si()->DispatchPending(0);
+}
+
+bool NodeStatic::RunOnce(int *timeout) {
+  NODE_ASSERT(s_loopMode == LOOP_EMBEDDED);
+  s_testDone = false;
+  s_loopStats.drains++;
+
+  double start = Now();
+  NODE_LOGM("ev_run(EVRUN_NOWAIT)");
+  ev_run(ev_default_loop(), EVRUN_NOWAIT);
+  RecordDrain(Now() - start);
+
+  if (timeout) {
+    ev_tstamp next = ev_next_timeout(ev_default_loop());
+    *timeout = next < 0. ? -1 : static_cast<int>(next * 1000 + 0.999);
+  }
+  return s_testDone;
+}
+
+int Node::BackendFd() {
+  if (si()->s_loopMode != LOOP_EMBEDDED) {
+    return -1;
+  }
+  return ev_backend_fd(ev_default_loop());
+}
+
+bool Node::RunOnce(int *timeout) {
+  return si()->RunOnce(timeout);
+}
+
+bool Node::LoopAlive() {
+  return ev_activecnt(ev_default_loop()) > 0;
+}
+
+void Node::GetLoopStats(LoopStats *stats) {
+  *stats = si()->s_loopStats;
+}
+
+Node* Node::Current() {
+  return static_cast<Node*>(ev_owner(ev_default_loop()));
+}
+
+void Node::AdjustBufferMemory(Node *node, ssize_t change) {
+  // gone, with whatever it allocated
+  InstanceStats *stats = si()->InstanceStatsFor(node);
+  if (!stats) {
+    return;
+  }
+  if (change < 0 && static_cast<size_t>(-change) > stats->buffers) {
+    change = -static_cast<ssize_t>(stats->buffers);
+  }
+  stats->buffers += change;
+  if (stats->buffers > stats->buffersMax) {
+    stats->buffersMax = stats->buffers;
+  }
+}
+
+void Node::GetInstanceStats(Node *node, InstanceStats *stats) {
+  *stats = node ? node->m_instanceStats : si()->s_sharedStats;
 }
 
 // REQ: There's one libev thread to handle requests from all the node instances in the browser process
@@ -1809,12 +2913,11 @@ void* NodeStatic::EvThreadRun(void *unused) {
   pthread_mutex_lock(&si()->s_mutex);
 
   while (true) {
-    // FIXME: review the current value (10ms)
-    // REQ: when there are no active watchers, the libev thread should sleep
-    //   >: and poll back every 10ms for new requests
+    // REQ: when there are no active watchers, the libev thread should block
+    //   >: till a watcher is started (no polling while idle)
     if (!ev_activecnt(ev_default_loop())) {
-      NODE_LOGM("%s, no active watchers sleeping..", __FUNCTION__);
-      ev_sleep(.01);
+      NODE_LOGM("%s, no active watchers waiting..", __FUNCTION__);
+      si()->IdleWait();
       continue;
     }
 
@@ -1846,16 +2949,108 @@ void NodeStatic::EvThreadPendingCallback(struct ev_loop *loop){
 
   NODE_LOGM("%s", __FUNCTION__);
   NODE_ASSERT(loop == ev_default_loop()); // we have only one loop, default loop
+  if (si()->s_handoffMode == HANDOFF_QUEUE) {
+    si()->HandOff(loop);
+    return;
+  }
+
   while (ev_pending_count(loop)){
     NODE_LOGM("%s, handling pending callbacks", __FUNCTION__);
-    NodeEvent ev;
-    ev.type = NODE_EVENT_LIBEV_INVOKE_PENDING;
-    si()->s_nodes[0]->client()->HandleNodeEvent(&ev);
+    si()->PostBatch(loop, true);
+    si()->s_loopStats.stalls++;
     NODE_LOGM("%s, pthread_cond_wait from ev thread", __FUNCTION__);
     pthread_cond_wait(&si()->s_cond, &si()->s_mutex);
   }
 }
 
+void NodeStatic::HandOff(struct ev_loop *loop) {
+  unsigned int pending = ev_pending_count(loop);
+  if (!pending) {
+    return;
+  }
+
+  // first batch since the last drain, wake up the main thread and go
+  // back to polling
+  if (!s_handoffOutstanding) {
+    s_handoffOutstanding = true;
+    PostBatch(loop, true);
+    return;
+  }
+
+  // more work showed up while the main thread is busy, it gets picked up
+  // by the wakeup that is already on its way
+  if (pending != s_handedOff) {
+    PostBatch(loop, false);
+    return;
+  }
+
+  // nothing new since the last batch, polling again would only spin on the
+  // (level triggered) fds that are already pending, wait for the drain
+  s_loopStats.stalls++;
+  while (s_handoffOutstanding) {
+    NODE_LOGM("%s, pthread_cond_wait from ev thread", __FUNCTION__);
+    pthread_cond_wait(&s_cond, &s_mutex);
+  }
+}
+
+void NodeStatic::PostBatch(struct ev_loop *loop, bool wakeup) {
+  PendingBatch b;
+  b.postedAt = Now();
+  b.pending = ev_pending_count(loop);
+  s_handedOff = b.pending;
+  s_batches.push_back(b);
+  s_loopStats.batches++;
+
+  if (!wakeup) {
+    s_loopStats.coalesced++;
+    return;
+  }
+
+  s_invokePosted = true;
+  __sync_synchronize();
+  NotifyClients(loop);
+}
+
+// REQ: a client only hears about the pending work of its own node instance,
+// work that belongs to none of them (e.g. eio) goes to the first client.
+// The InvokePending of whichever client runs first drains all the instances
+void NodeStatic::NotifyClients(struct ev_loop *loop) {
+  NodeEvent ev;
+  ev.type = NODE_EVENT_LIBEV_INVOKE_PENDING;
+  bool notified = false;
+
+  pthread_mutex_lock(&s_nodesMutex);
+  for (vector<Node*>::iterator it = s_nodes.begin(); it != s_nodes.end(); it++) {
+    if (ev_pending_count_owner(loop, *it)) {
+      s_loopStats.wakeups++;
+      (*it)->client()->HandleNodeEvent(&ev);
+      notified = true;
+    }
+  }
+  if (!notified && s_nodes.size() > 0) {
+    s_loopStats.wakeups++;
+    s_nodes[0]->client()->HandleNodeEvent(&ev);
+  }
+  pthread_mutex_unlock(&s_nodesMutex);
+}
+
+void NodeStatic::EvThreadRelease(struct ev_loop *loop) {
+  si()->s_evThreadPolling = true;
+  pthread_mutex_unlock(&si()->s_mutex);
+}
+
+void NodeStatic::EvThreadAcquire(struct ev_loop *loop) {
+  pthread_mutex_lock(&si()->s_mutex);
+  si()->s_evThreadPolling = false;
+}
+
+// Called from the main thread (through InvokePending), the wakeup itself
+// already made the libev thread reify its watchers
+void NodeStatic::LoopWakeup(uv_async_t* watcher, int status) {
+  NODE_LOGM("%s", __FUNCTION__);
+  NODE_ASSERT(watcher == &si()->s_loop_wakeup);
+}
+
 /////////////////////////////////////////////Test functions///////////////////////////////
 void NodeStatic::HandleSIGSEGV(int signal) {
   NODE_LOGE("Test **CRASHED: %s", si()->s_nodes[0]->m_moduleName.c_str());
@@ -1948,6 +3143,116 @@ Handle<Value> NodeStatic::TestWatcherStats(const Arguments& args) {
   return Undefined();
 }
 
+Handle<Value> NodeStatic::TestLoopStats(const Arguments& args) {
+  HandleScope scope;
+  LoopStats stats;
+  Node::GetLoopStats(&stats);
+
+  Local<Object> o = Object::New();
+  o->Set(String::NewSymbol("mode"), String::New(
+        si()->s_handoffMode == HANDOFF_QUEUE ? "queue" : "condvar"));
+  o->Set(String::NewSymbol("wakeups"), Integer::NewFromUnsigned(stats.wakeups));
+  o->Set(String::NewSymbol("batches"), Integer::NewFromUnsigned(stats.batches));
+  o->Set(String::NewSymbol("coalesced"), Integer::NewFromUnsigned(stats.coalesced));
+  o->Set(String::NewSymbol("stalls"), Integer::NewFromUnsigned(stats.stalls));
+  o->Set(String::NewSymbol("drains"), Integer::NewFromUnsigned(stats.drains));
+  o->Set(String::NewSymbol("idleWakeups"), Integer::NewFromUnsigned(stats.idleWakeups));
+  o->Set(String::NewSymbol("latencyTotal"), Number::New(stats.latencyTotal));
+  o->Set(String::NewSymbol("latencyMax"), Number::New(stats.latencyMax));
+  o->Set(String::NewSymbol("yields"), Integer::NewFromUnsigned(stats.yields));
+  Local<Array> histogram = Array::New(NODE_DRAIN_BUCKETS);
+  for (int i = 0; i < NODE_DRAIN_BUCKETS; i++) {
+    histogram->Set(i, Integer::NewFromUnsigned(stats.drainHistogram[i]));
+  }
+  o->Set(String::NewSymbol("drainHistogram"), histogram);
+  o->Set(String::NewSymbol("drainMax"), Number::New(stats.drainMax));
+  return scope.Close(o);
+}
+
+Handle<Value> NodeStatic::TestInstanceStats(const Arguments& args) {
+  HandleScope scope;
+  InstanceStats stats;
+  Node::GetInstanceStats(GetNodeFromTest(args.Holder()), &stats);
+
+  Local<Object> o = Object::New();
+  o->Set(String::NewSymbol("invoked"), Integer::NewFromUnsigned(stats.invoked));
+  o->Set(String::NewSymbol("turns"), Integer::NewFromUnsigned(stats.turns));
+  o->Set(String::NewSymbol("depth"), Integer::NewFromUnsigned(stats.depth));
+  o->Set(String::NewSymbol("depthMax"), Integer::NewFromUnsigned(stats.depthMax));
+  o->Set(String::NewSymbol("serviceTime"), Number::New(stats.serviceTime));
+  o->Set(String::NewSymbol("serviceMax"), Number::New(stats.serviceMax));
+  o->Set(String::NewSymbol("startup"), Number::New(stats.startup));
+  o->Set(String::NewSymbol("heap"), Integer::NewFromUnsigned(stats.heap));
+  o->Set(String::NewSymbol("attach"), Number::New(stats.attach));
+  o->Set(String::NewSymbol("buffers"), Integer::NewFromUnsigned(stats.buffers));
+  o->Set(String::NewSymbol("buffersMax"), Integer::NewFromUnsigned(stats.buffersMax));
+  return scope.Close(o);
+}
+
+Handle<Value> NodeStatic::TestBufferStats(const Arguments& args) {
+  HandleScope scope;
+  BufferAllocatorStats stats;
+  Buffer::GetAllocatorStats(&stats);
+
+  Local<Object> o = Object::New();
+  o->Set(String::NewSymbol("allocs"), Integer::NewFromUnsigned(stats.allocs));
+  o->Set(String::NewSymbol("hits"), Integer::NewFromUnsigned(stats.hits));
+  o->Set(String::NewSymbol("misses"), Integer::NewFromUnsigned(stats.misses));
+  o->Set(String::NewSymbol("unpooled"), Integer::NewFromUnsigned(stats.unpooled));
+  o->Set(String::NewSymbol("recycled"), Integer::NewFromUnsigned(stats.recycled));
+  o->Set(String::NewSymbol("released"), Integer::NewFromUnsigned(stats.released));
+  o->Set(String::NewSymbol("cached"), Integer::NewFromUnsigned(stats.cached));
+  o->Set(String::NewSymbol("adopted"), Integer::NewFromUnsigned(stats.adopted));
+  o->Set(String::NewSymbol("external"), Integer::NewFromUnsigned(Buffer::ExternalMemory()));
+  return scope.Close(o);
+}
+
+Handle<Value> NodeStatic::TestAdoptBuffer(const Arguments& args) {
+  HandleScope scope;
+  size_t length = args[0]->Uint32Value();
+  char *data = static_cast<char*>(malloc(length));
+  if (!data) {
+    return ThrowException(Exception::Error(String::New("out of memory")));
+  }
+  memset(data, args[1]->Int32Value(), length);
+
+  Buffer *buffer = Buffer::Adopt(data, length, Buffer::ReleaseFree, NULL);
+  if (!buffer) return Undefined();
+  return scope.Close(buffer->handle_);
+}
+
+Handle<Value> NodeStatic::TestPoolStats(const Arguments& args) {
+  HandleScope scope;
+  PoolStats stats;
+  Node::GetPoolStats(&stats);
+
+  Local<Object> o = Object::New();
+  o->Set(String::NewSymbol("refill"), String::New(
+        si()->s_poolRefill == POOL_REFILL_IDLE ? "idle" : "manual"));
+  o->Set(String::NewSymbol("size"), Integer::NewFromUnsigned(stats.size));
+  o->Set(String::NewSymbol("ready"), Integer::NewFromUnsigned(stats.ready));
+  o->Set(String::NewSymbol("hits"), Integer::NewFromUnsigned(stats.hits));
+  o->Set(String::NewSymbol("misses"), Integer::NewFromUnsigned(stats.misses));
+  o->Set(String::NewSymbol("refills"), Integer::NewFromUnsigned(stats.refills));
+  o->Set(String::NewSymbol("refillTime"), Number::New(stats.refillTime));
+  o->Set(String::NewSymbol("attachMax"), Number::New(stats.attachMax));
+  return scope.Close(o);
+}
+
+Handle<Value> NodeStatic::TestModuleCacheStats(const Arguments& args) {
+  HandleScope scope;
+  ModuleCacheStats stats;
+  Node::GetModuleCacheStats(&stats);
+
+  Local<Object> o = Object::New();
+  o->Set(String::NewSymbol("entries"), Integer::NewFromUnsigned(stats.entries));
+  o->Set(String::NewSymbol("bytes"), Integer::NewFromUnsigned(stats.bytes));
+  o->Set(String::NewSymbol("hits"), Integer::NewFromUnsigned(stats.hits));
+  o->Set(String::NewSymbol("misses"), Integer::NewFromUnsigned(stats.misses));
+  o->Set(String::NewSymbol("invalidated"), Integer::NewFromUnsigned(stats.invalidated));
+  return scope.Close(o);
+}
+
 Handle<Object> NodeStatic::TestGetCurrentProcess() {
   // use parent handle scope
   NODE_ASSERT(Context::InContext());
@@ -2006,6 +3311,56 @@ void NodeStatic::ReadDebugLevel() {
       LOG_STRING[s_debugLevel], s_debugLevel);
 }
 
+void NodeStatic::ReadHandoffMode() {
+  s_handoffMode = HANDOFF_CONDVAR;
+
+#ifdef ANDROID
+  char mode[PROP_VALUE_MAX];
+  if (__system_property_get("NODE_HANDOFF", mode) && !strcmp(mode, "queue")) {
+    s_handoffMode = HANDOFF_QUEUE;
+  }
+#else
+  const char *mode = getenv("NODE_HANDOFF");
+  if (mode && !strcmp(mode, "queue")) {
+    s_handoffMode = HANDOFF_QUEUE;
+  }
+#endif
+  NODE_LOGI("%s, libev thread handoff (%s)", __FUNCTION__,
+      s_handoffMode == HANDOFF_QUEUE ? "queue" : "condvar");
+}
+
+void NodeStatic::ReadPoolConfig() {
+  s_poolSize = 0;
+  s_poolRefill = POOL_REFILL_IDLE;
+
+#ifdef ANDROID
+  char value[PROP_VALUE_MAX];
+  if (__system_property_get("NODE_POOL", value)) {
+    s_poolSize = atoi(value);
+  }
+  if (__system_property_get("NODE_POOL_REFILL", value) && !strcmp(value, "manual")) {
+    s_poolRefill = POOL_REFILL_MANUAL;
+  }
+#else
+  const char *value;
+  if ((value = getenv("NODE_POOL"))) {
+    s_poolSize = atoi(value);
+  }
+  if ((value = getenv("NODE_POOL_REFILL")) && !strcmp(value, "manual")) {
+    s_poolRefill = POOL_REFILL_MANUAL;
+  }
+#endif
+  s_poolStats.size = s_poolSize;
+  NODE_LOGI("%s, node pool size(%u) refill(%s)", __FUNCTION__, s_poolSize,
+      s_poolRefill == POOL_REFILL_IDLE ? "idle" : "manual");
+}
+
+double NodeStatic::Now() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1000.0 + ts.tv_nsec / 1000000.0;
+}
+
 // REQ: node will follow android logging mechanism and will be controllable at build/runtime
 #define LOG_BUF_SIZE 1024
 extern "C" void __android_log_print_wrap(android_LogPriority prio, const char *tag, const char *fmt, ...) {
@@ -2059,16 +3414,28 @@ Node* NodeStatic::ServiceNode() {
   return s_serviceNode;
 }
 
-NodeStatic::NodeStatic(bool isBrowser, std::string appPath)
-  : s_isBrowser(isBrowser)
+NodeStatic::NodeStatic(bool isBrowser, std::string appPath, LoopMode loopMode)
+  : s_loopMode(loopMode)
+  , s_handoffOutstanding(false)
+  , s_handedOff(0)
+  , s_invokePosted(false)
+  , s_evThreadPolling(false)
+  , s_evThreadIdle(false)
+  , s_isBrowser(isBrowser)
   , s_isAndroid(false)
   , s_serviceNode(0)
 {
   s_instance = this;
+  memset(&s_loopStats, 0, sizeof(s_loopStats));
+  memset(&s_sharedStats, 0, sizeof(s_sharedStats));
+  memset(&s_poolStats, 0, sizeof(s_poolStats));
+  memset(&s_moduleCacheStats, 0, sizeof(s_moduleCacheStats));
+  s_dispatchNext = 0;
 
   // initialize mutex/cond
   pthread_mutex_init(&s_mutex, 0);
   pthread_cond_init(&s_cond, 0);
+  pthread_mutex_init(&s_nodesMutex, 0);
 
   // REQ: node modules will be downloaded to/loaded from <app_path>/.proteus/downloads directory
 #ifdef ANDROID
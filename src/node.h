@@ -29,6 +29,7 @@
 #include <v8.h>
 
 #include <vector>
+#include <deque>
 #include <node_object_wrap.h>
 #include <nodelog.h>
 #include <node_bridge.h>
@@ -109,10 +110,89 @@ class StopWatch {
     double m_startTime;
 };
 
+// drainHistogram[0] counts the drains that took less than 1ms, [i] the ones
+// that took up to 2^i ms, the last bucket counts the rest
+#define NODE_DRAIN_BUCKETS 10
+
+/**
+ * Counters for the handoff between the libev thread and the main thread
+ * (see Node::GetLoopStats), times are in ms
+ */
+struct LoopStats {
+  unsigned int wakeups;     // NODE_EVENT_LIBEV_INVOKE_PENDING sent to the client
+  unsigned int batches;     // pending batches handed over by the libev thread
+  unsigned int coalesced;   // batches that did not need a wakeup of their own
+  unsigned int stalls;      // times the libev thread waited for the main thread
+  unsigned int drains;      // InvokePending calls from the client
+  unsigned int idleWakeups; // libev thread woken up while it had no watchers
+  double latencyTotal;      // batch handed over -> main thread starts draining
+  double latencyMax;
+  unsigned int yields;      // drains that ran out of their deadline with work left
+  unsigned int drainHistogram[NODE_DRAIN_BUCKETS]; // main thread blocked per drain
+  double drainMax;
+};
+
+/**
+ * One node instance's share of the main thread (see Node::GetInstanceStats),
+ * times are in ms
+ */
+struct InstanceStats {
+  unsigned int invoked;     // callbacks run for the instance
+  unsigned int turns;       // round-robin turns that ran at least one callback
+  unsigned int depth;       // pending callbacks when the last drain started
+  unsigned int depthMax;
+  double serviceTime;       // time spent in the instance's callbacks
+  double serviceMax;        // longest single turn
+  double startup;           // context creation and bootstrap (Init/Load)
+  unsigned int heap;        // v8 heap used by the above, in bytes (a gc in
+                            // between makes it an underestimate, 0 when the
+                            // gc freed more than the instance allocated)
+  double attach;            // taken from the pool: handing it to the client
+  unsigned int buffers;     // buffer memory allocated by it and not freed yet, in bytes
+  unsigned int buffersMax;
+};
+
+/**
+ * Pool of bootstrapped node instances without a client (see Node::Create),
+ * times are in ms
+ */
+struct PoolStats {
+  unsigned int size;        // instances the pool is kept at
+  unsigned int ready;       // instances in the pool right now
+  unsigned int hits;        // Create served from the pool
+  unsigned int misses;      // Create had to bootstrap the instance itself
+  unsigned int refills;     // instances bootstrapped for the pool
+  double refillTime;        // spent bootstrapping them
+  double attachMax;         // longest hit
+};
+
+/**
+ * Installed modules cached across the node instances (see Node::GetModuleCacheStats)
+ */
+struct ModuleCacheStats {
+  unsigned int entries;     // modules cached right now
+  unsigned int bytes;       // their wrapped source
+  unsigned int hits;        // compiled from the cache
+  unsigned int misses;      // read (again) from disk, first load or file changed
+  unsigned int invalidated; // entries dropped by the installer
+};
+
+// POOL_REFILL_IDLE: the pool is topped up with one instance per event loop
+//   iteration that has nothing else pending
+// POOL_REFILL_MANUAL: only when the client calls RefillPool, e.g. from the
+//   idle handler of its own looper
+enum PoolRefill {POOL_REFILL_IDLE, POOL_REFILL_MANUAL};
+
 enum TestStatus {FAILED, PASSED, CRASHED, TIMEOUT};
 enum TestState {INIT, STARTED, DONE, REPORTED};
 enum encoding {ASCII, UTF8, BASE64, UCS2, BINARY, HEX};
 
+// LOOP_THREAD: node runs the event loop on its own thread and asks the client
+//   to call InvokePending through NODE_EVENT_LIBEV_INVOKE_PENDING
+// LOOP_EMBEDDED: the client waits on BackendFd() in its own looper and calls
+//   RunOnce, callbacks are invoked in place on the calling thread
+enum LoopMode {LOOP_THREAD, LOOP_EMBEDDED};
+
 /**
  * Represents a node instance, there is one for each browser context
  * Gets created when the webpage loads a module through navigator.loadModule
@@ -128,6 +208,52 @@ class Node {
      */
     Node(NodeClient *client);
 
+    /**
+     * Same as new Node(client), but hands out a bootstrapped instance from
+     * the pool if there is one, attaching the client (and the security token
+     * of the current context) is all that is left to do then
+     * @param client Handle to browser, used for sending events
+     * @return the node instance, to be deleted by the client
+     */
+    static Node* Create(NodeClient *client);
+
+    /**
+     * Configures the pool of instances used by Create, NODE_POOL and
+     * NODE_POOL_REFILL (idle or manual) set the initial configuration
+     * @param size instances to keep ready, 0 disables the pool, extra
+     * instances are destroyed
+     * @param refill when the pool gets topped up
+     */
+    static void SetPoolSize(unsigned int size, PoolRefill refill = POOL_REFILL_IDLE);
+
+    /**
+     * Bootstraps instances for the pool, to be called on the main thread
+     * while the client has nothing else to do (needed with POOL_REFILL_MANUAL,
+     * and to warm up the pool before the event loop runs)
+     * @param deadline time budget in ms, checked after every instance, 0 for none
+     * @return true once the pool is full
+     */
+    static bool RefillPool(int deadline);
+
+    /**
+     * @param stats filled with the pool counters since Initialize
+     */
+    static void GetPoolStats(PoolStats *stats);
+
+    /**
+     * Installed (.js) modules are read and preparsed once per process, the
+     * node instances requiring them compile from the cached source as long
+     * as the file (inode, mtime, size) stays the same
+     * @param path file or directory (e.g. a module being reinstalled) whose
+     * modules are dropped from the cache, empty for all of them
+     */
+    static void InvalidateModuleCache(const std::string& path);
+
+    /**
+     * @param stats filled with the module cache counters since Initialize
+     */
+    static void GetModuleCacheStats(ModuleCacheStats *stats);
+
     /**
      * Destroys the node instance, triggered by embedder when page is navigated out
      * destroys all persistent handles it holds in current instance, stops all libev watchers
@@ -139,8 +265,34 @@ class Node {
      * Bootup node, create ev thread ..
      * @param isBrowser specifies if client is a browser or a shell
      * @param moduleRootPath Root directory specified by client for installing downloaded modules
+     * @param loopMode who drives the event loop, falls back to LOOP_THREAD if
+     * the libev backend has no fd to wait on
      */
-    static void Initialize(bool isBrowser, std::string moduleRootPath);
+    static void Initialize(bool isBrowser, std::string moduleRootPath,
+        LoopMode loopMode = LOOP_THREAD);
+
+    /**
+     * LOOP_EMBEDDED: fd that becomes readable when the event loop has work,
+     * to be added to the client's looper
+     * @return the libev backend (epoll) fd, -1 in LOOP_THREAD mode
+     */
+    static int BackendFd();
+
+    /**
+     * LOOP_EMBEDDED: runs one non-blocking iteration of the event loop on the
+     * calling thread, to be called whenever BackendFd() is readable or the
+     * timeout from the previous call expired
+     * @param timeout set to the ms after which RunOnce has to be called again
+     * even if BackendFd() did not become readable, -1 for no timeout
+     * @return same as InvokePending
+     */
+    static bool RunOnce(int *timeout);
+
+    /**
+     * @return false once the event loop has no active watchers left
+     * (what NODE_EVENT_LIBEV_DONE reports in LOOP_THREAD mode)
+     */
+    static bool LoopAlive();
 
     /**
      * Node client
@@ -150,12 +302,54 @@ class Node {
 
     /**
      * Invoked by the client on the main thread to process pending libev events
-     * (internally calls ev_invoke_pending)
+     * (of all the instances, round-robin, see GetInstanceStats)
      * @return return true if we are done processing (including any exceptions thrown),
      * false if we are not done yet
      */
     static bool InvokePending();
 
+    /**
+     * Same as InvokePending, but stops dispatching once the deadline has
+     * passed (checked between the round-robin turns, see GetInstanceStats),
+     * the callbacks that did not run stay queued
+     * @param deadline main thread time budget in ms
+     * @param more set to true if work is left, the client should call
+     * InvokePending again soon (e.g. from its next task) rather than wait for
+     * another NODE_EVENT_LIBEV_INVOKE_PENDING
+     * @return same as InvokePending()
+     */
+    static bool InvokePending(int deadline, bool *more);
+
+    /**
+     * Snapshot of the libev thread <-> main thread handoff counters, the
+     * handoff mode is selected with NODE_HANDOFF (condvar (default) or queue)
+     * @param stats filled with the counters since Initialize
+     */
+    static void GetLoopStats(LoopStats *stats);
+
+    /**
+     * Pending callbacks are tagged with the node instance that started their
+     * watcher and drained round-robin, these are the per instance counters
+     * @param node instance, NULL for the watchers shared by all the instances
+     * (e.g. eio)
+     * @param stats filled with the counters since the instance was created
+     */
+    static void GetInstanceStats(Node *node, InstanceStats *stats);
+
+    /**
+     * @return the node instance running code right now (a callback of one of
+     * its watchers, loadModule, an event), NULL for none
+     */
+    static Node* Current();
+
+    /**
+     * Accounts buffer memory to a node instance (InstanceStats.buffers)
+     * @param node instance from Current() at allocation time, NULL for the
+     * memory shared by all the instances, ignored once it is deleted
+     * @param change in bytes
+     */
+    static void AdjustBufferMemory(Node *node, ssize_t change);
+
     /**
      * Used by client to send events to specific node instance
      */
@@ -284,8 +478,14 @@ class Node {
       get_builtin_module(const char *name);
 
   private:
+    // pooled instance, bootstrapped without a client (see Create)
+    Node();
+    void Bootstrap();
+    void Attach(NodeClient *client);
+
     void Init();
     void SetupProcessObject();
+    void SetupClient(); // the parts of the process object that need a client
     void Load(); // load all builtin modules in current context
     void Tick();
 
@@ -328,11 +528,18 @@ class Node {
     uv_prepare_t m_prepare_tick_watcher;
     uv_check_t m_check_tick_watcher;
     uv_idle_t m_tick_spinner;
-    bool m_need_tick_cb;
+
+    // process.nextTick callbacks, drained by Tick
+    std::deque<v8::Persistent<v8::Function> > m_tickQueue;
+
+    // set while Tick runs callbacks, cleared by the destructor
+    bool *m_tickAlive;
 
     // NodeClient (e.g. webkit node proxy)
     NodeClient *m_client;
 
+    InstanceStats m_instanceStats;
+
     friend class NodeStatic;
 };
 
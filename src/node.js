@@ -44,7 +44,6 @@
     startup.globalTimeouts();
 
     startup.processAssert();
-    startup.processNextTick();
     startup.processKillAndExit();
     startup.processSignalHandlers();
 
@@ -175,35 +174,6 @@
     };
   };
 
-  startup.processNextTick = function() {
-    var nextTickQueue = [];
-
-    process._tickCallback = function() {
-      var l = nextTickQueue.length;
-      if (l === 0) return;
-
-      try {
-        for (var i = 0; i < l; i++) {
-          nextTickQueue[i]();
-        }
-      }
-      catch (e) {
-        nextTickQueue.splice(0, i + 1);
-        if (i + 1 < l) {
-          process._needTickCallback();
-        }
-        throw e; // process.nextTick error, or 'error' event on first tick
-      }
-
-      nextTickQueue.splice(0, l);
-    };
-
-    process.nextTick = function(callback) {
-      nextTickQueue.push(callback);
-      process._needTickCallback();
-    };
-  };
-
   startup.processKillAndExit = function() {
     process.exit = function(code) {
       process.emit('exit', code || 0);
@@ -267,9 +237,6 @@
   // core modules found in lib/*.js. All core modules are compiled into the
   // node binary, so they can be loaded faster.
 
-  var Script = process.binding('evals').NodeScript;
-  var runInThisContext = Script.runInThisContext;
-
   function translateId(id) {
     switch (id) {
       case 'net':
@@ -352,10 +319,9 @@
   ];
 
   NativeModule.prototype.compile = function() {
-    var source = NativeModule.getSource(this.id);
-    source = NativeModule.wrap(source);
-
-    var fn = runInThisContext(source, this.filename, true);
+    // wrapped and compiled natively, reusing the preparse data of the other
+    // node instances
+    var fn = process._compileNative(this.id, this.filename);
     // proteus, pass process as a parameter in closure so that trusted modules can access it,
     // but the global/user space dont have access
     fn(process, this.exports, NativeModule.require, this, this.filename, undefined, process.Buffer);
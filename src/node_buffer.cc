@@ -22,12 +22,18 @@
 
 #include <node.h>
 #include <node_buffer.h>
+#include <node_buffer_codec.h>
+#include <node_buffer_list.h>
+#include <node_string_decoder.h>
+#include <node_string.h>
 
 #include <v8.h>
 
 #include <assert.h>
 #include <stdlib.h> // malloc, free
-#include <string.h> // memcpy
+#include <string.h> // memcpy, memcmp
+
+#include <vector>
 
 #ifdef __MINGW32__
 # include <platform.h>
@@ -40,6 +46,7 @@
 
 
 #define MIN(a,b) ((a) < (b) ? (a) : (b))
+#define MAX(a,b) ((a) > (b) ? (a) : (b))
 
 namespace node {
 
@@ -71,6 +78,100 @@ static Persistent<String> chars_written_sym;
 static Persistent<String> write_sym;
 Persistent<FunctionTemplate> Buffer::constructor_template;
 
+// memory of destroyed buffers, see ReclaimPending
+struct PendingFree {
+  char *data;
+  size_t length;
+  Buffer::free_callback callback;
+  Buffer::release_callback release;
+  void *hint;
+  Node *owner;
+};
+static std::vector<PendingFree> pending_free;
+static size_t external_memory;
+
+// REQ: buffer memory comes from power of two size classes (1K-64K, for
+// lengths from 512 bytes up), a freed
+// chunk is kept for the next buffer of its class (up to BUFFER_CLASS_CACHE
+// bytes per class) instead of going back to malloc. Buffers are only ever
+// created and freed on the main thread, so the free lists need no locking
+#define BUFFER_MIN_SHIFT 10
+#define BUFFER_MAX_SHIFT 16
+#define BUFFER_CLASSES (BUFFER_MAX_SHIFT - BUFFER_MIN_SHIFT + 1)
+#define BUFFER_CLASS_CACHE (1024 * 1024)
+
+static std::vector<char*> free_chunks[BUFFER_CLASSES];
+static BufferAllocatorStats allocator_stats;
+
+// -1 for the lengths that are not pooled
+static inline int SizeClass(size_t length) {
+  if (length < (1u << (BUFFER_MIN_SHIFT - 1)) || length > (1u << BUFFER_MAX_SHIFT)) {
+    return -1;
+  }
+  int c = 0;
+  while ((1u << (BUFFER_MIN_SHIFT + c)) < length) c++;
+  return c;
+}
+
+static char* AllocData(size_t length) {
+  allocator_stats.allocs++;
+  int c = SizeClass(length);
+  if (c < 0) {
+    allocator_stats.unpooled++;
+    return new char[length];
+  }
+
+  if (free_chunks[c].empty()) {
+    allocator_stats.misses++;
+    return new char[1u << (BUFFER_MIN_SHIFT + c)];
+  }
+
+  char *data = free_chunks[c].back();
+  free_chunks[c].pop_back();
+  allocator_stats.hits++;
+  allocator_stats.cached -= 1u << (BUFFER_MIN_SHIFT + c);
+  return data;
+}
+
+static void FreeData(char *data, size_t length) {
+  int c = SizeClass(length);
+  if (c < 0) {
+    delete [] data;
+    return;
+  }
+
+  size_t size = 1u << (BUFFER_MIN_SHIFT + c);
+  if ((free_chunks[c].size() + 1) * size > BUFFER_CLASS_CACHE) {
+    allocator_stats.released++;
+    delete [] data;
+    return;
+  }
+  free_chunks[c].push_back(data);
+  allocator_stats.recycled++;
+  allocator_stats.cached += size;
+}
+
+
+// hands the memory of a buffer back to wherever it came from
+// @return the bytes to take off the external memory
+static size_t Release(const PendingFree &f) {
+  if (f.callback) {
+    f.callback(f.data, f.hint);
+    return 0;
+  }
+
+  if (f.release) {
+    f.release(f.data, f.length, f.hint);
+    allocator_stats.adopted -= f.length;
+  } else if (f.length) {
+    FreeData(f.data, f.length);
+  } else {
+    return 0;
+  }
+  Node::AdjustBufferMemory(f.owner, -static_cast<ssize_t>(f.length));
+  return sizeof(Buffer) + f.length;
+}
+
 
 static inline size_t base64_decoded_size(const char *src, size_t size) {
   const char *const end = src + size;
@@ -169,6 +270,41 @@ Buffer* Buffer::New(char *data, size_t length,
 }
 
 
+Buffer* Buffer::Adopt(char *data, size_t length,
+                      release_callback release, void *hint) {
+  HandleScope scope;
+
+  Local<Value> arg = Integer::NewFromUnsigned(0);
+  Local<Object> obj = constructor_template->GetFunction()->NewInstance(1, &arg);
+  if (obj.IsEmpty()) {
+    // the caller let go of the memory already
+    release(data, length, hint);
+    return NULL;
+  }
+
+  Buffer *buffer = ObjectWrap::Unwrap<Buffer>(obj);
+  buffer->ReleaseMemory();
+
+  buffer->data_ = data;
+  buffer->length_ = length;
+  buffer->release_ = release;
+  buffer->callback_hint_ = hint;
+  buffer->owner_ = Node::Current();
+  allocator_stats.adopted += length;
+  Node::AdjustBufferMemory(buffer->owner_, length);
+  external_memory += sizeof(Buffer) + length;
+  V8::AdjustAmountOfExternalAllocatedMemory(sizeof(Buffer) + length);
+
+  buffer->Expose();
+  return buffer;
+}
+
+
+void Buffer::ReleaseFree(char *data, size_t length, void *hint) {
+  free(data);
+}
+
+
 Handle<Value> Buffer::New(const Arguments &args) {
   if (!args.IsConstructCall()) {
     return Node::FromConstructorTemplate(constructor_template, args);
@@ -193,14 +329,75 @@ Buffer::Buffer(Handle<Object> wrapper, size_t length) : ObjectWrap() {
 
   length_ = 0;
   callback_ = NULL;
+  release_ = NULL;
+  owner_ = NULL;
 
   Replace(NULL, length, NULL, NULL);
 }
 
 
 Buffer::~Buffer() {
-  // FIXME (proteus): This crashes since we are not in the right context
-  // Replace(NULL, 0, NULL, NULL);
+  // proteus: Replace(NULL, 0, NULL, NULL) would crash, the handle can not be
+  // touched outside of a context, the memory goes to ReclaimPending instead
+  if (callback_ || release_ || length_) {
+    PendingFree f = { data_, length_, callback_, release_, callback_hint_, owner_ };
+    pending_free.push_back(f);
+  }
+}
+
+
+void Buffer::ReclaimPending() {
+  if (pending_free.empty()) {
+    return;
+  }
+
+  // the free callbacks can create buffers (and have them collected)
+  std::vector<PendingFree> batch;
+  batch.swap(pending_free);
+
+  size_t external = 0;
+  for (std::vector<PendingFree>::iterator it = batch.begin(); it != batch.end(); it++) {
+    external += Release(*it);
+  }
+
+  if (external) {
+    external_memory -= external;
+    V8::AdjustAmountOfExternalAllocatedMemory(-static_cast<int>(external));
+  }
+  NODE_LOGV("%s, %d buffers, %u bytes reclaimed", __FUNCTION__, batch.size(), external);
+}
+
+
+size_t Buffer::ExternalMemory() {
+  return external_memory;
+}
+
+
+void Buffer::GetAllocatorStats(BufferAllocatorStats *stats) {
+  *stats = allocator_stats;
+}
+
+
+void Buffer::ReleaseMemory() {
+  PendingFree f = { data_, length_, callback_, release_, callback_hint_, owner_ };
+  size_t external = Release(f);
+  if (external) {
+    external_memory -= external;
+    V8::AdjustAmountOfExternalAllocatedMemory(-static_cast<int>(external));
+  }
+
+  data_ = NULL;
+  length_ = 0;
+  callback_ = NULL;
+  release_ = NULL;
+}
+
+
+void Buffer::Expose() {
+  handle_->SetIndexedPropertiesToExternalArrayData(data_,
+                                                   kExternalUnsignedByteArray,
+                                                   length_);
+  handle_->Set(length_symbol, Integer::NewFromUnsigned(length_));
 }
 
 
@@ -208,12 +405,7 @@ void Buffer::Replace(char *data, size_t length,
                      free_callback callback, void *hint) {
   HandleScope scope;
 
-  if (callback_) {
-    callback_(data_, callback_hint_);
-  } else if (length_) {
-    delete [] data_;
-    V8::AdjustAmountOfExternalAllocatedMemory(-(sizeof(Buffer) + length_));
-  }
+  ReleaseMemory();
 
   length_ = length;
   callback_ = callback;
@@ -222,18 +414,18 @@ void Buffer::Replace(char *data, size_t length,
   if (callback_) {
     data_ = data;
   } else if (length_) {
-    data_ = new char[length_];
+    // allocations pay for the buffers collected since the last drain
+    ReclaimPending();
+    data_ = AllocData(length_);
     if (data)
       memcpy(data_, data, length_);
+    owner_ = Node::Current();
+    Node::AdjustBufferMemory(owner_, length_);
+    external_memory += sizeof(Buffer) + length_;
     V8::AdjustAmountOfExternalAllocatedMemory(sizeof(Buffer) + length_);
-  } else {
-    data_ = NULL;
   }
 
-  handle_->SetIndexedPropertiesToExternalArrayData(data_,
-                                                   kExternalUnsignedByteArray,
-                                                   length_);
-  handle_->Set(length_symbol, Integer::NewFromUnsigned(length_));
+  Expose();
 }
 
 
@@ -257,7 +449,7 @@ Handle<Value> Buffer::AsciiSlice(const Arguments &args) {
   SLICE_ARGS(args[0], args[1])
 
   char* data = parent->data_ + start;
-  Local<String> string = String::New(data, end - start);
+  Local<String> string = NewUtf8String(data, end - start);
 
   return scope.Close(string);
 }
@@ -268,7 +460,7 @@ Handle<Value> Buffer::Utf8Slice(const Arguments &args) {
   Buffer *parent = ObjectWrap::Unwrap<Buffer>(args.This());
   SLICE_ARGS(args[0], args[1])
   char *data = parent->data_ + start;
-  Local<String> string = String::New(data, end - start);
+  Local<String> string = NewUtf8String(data, end - start);
   return scope.Close(string);
 }
 
@@ -281,27 +473,6 @@ Handle<Value> Buffer::Ucs2Slice(const Arguments &args) {
   return scope.Close(string);
 }
 
-static const char *base64_table = "ABCDEFGHIJKLMNOPQRSTUVWXYZ"
-                                  "abcdefghijklmnopqrstuvwxyz"
-                                  "0123456789+/";
-static const int unbase64_table[] =
-  {-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-2,-1,-1,-2,-1,-1
-  ,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1
-  ,-2,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,62,-1,-1,-1,63
-  ,52,53,54,55,56,57,58,59,60,61,-1,-1,-1,-1,-1,-1
-  ,-1, 0, 1, 2, 3, 4, 5, 6, 7, 8, 9,10,11,12,13,14
-  ,15,16,17,18,19,20,21,22,23,24,25,-1,-1,-1,-1,-1
-  ,-1,26,27,28,29,30,31,32,33,34,35,36,37,38,39,40
-  ,41,42,43,44,45,46,47,48,49,50,51,-1,-1,-1,-1,-1
-  ,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1
-  ,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1
-  ,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1
-  ,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1
-  ,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1
-  ,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1
-  ,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1
-  ,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1
-  };
 #define unbase64(x) unbase64_table[(uint8_t)(x)]
 
 
@@ -311,67 +482,35 @@ Handle<Value> Buffer::Base64Slice(const Arguments &args) {
   SLICE_ARGS(args[0], args[1])
 
   int n = end - start;
-  int out_len = (n + 2 - ((n + 2) % 3)) / 3 * 4;
+  int out_len = Base64EncodedSize(n);
   char *out = new char[out_len];
+  Base64Encode(parent->data_ + start, n, out);
 
-  uint8_t bitbuf[3];
-  int i = start; // data() index
-  int j = 0; // out index
-  char c;
-  bool b1_oob, b2_oob;
-
-  while (i < end) {
-    bitbuf[0] = parent->data_[i++];
-
-    if (i < end) {
-      bitbuf[1] = parent->data_[i];
-      b1_oob = false;
-    }  else {
-      bitbuf[1] = 0;
-      b1_oob = true;
-    }
-    i++;
-
-    if (i < end) {
-      bitbuf[2] = parent->data_[i];
-      b2_oob = false;
-    }  else {
-      bitbuf[2] = 0;
-      b2_oob = true;
-    }
-    i++;
-
+  Local<String> string = String::New(out, out_len);
+  delete [] out;
+  return scope.Close(string);
+}
 
-    c = bitbuf[0] >> 2;
-    assert(c < 64);
-    out[j++] = base64_table[(int)c];
-    assert(j < out_len);
 
-    c = ((bitbuf[0] & 0x03) << 4) | (bitbuf[1] >> 4);
-    assert(c < 64);
-    out[j++] = base64_table[(int)c];
-    assert(j < out_len);
+// var string = buffer.hexSlice(start, end);
+// REQ: was done in lib/buffer.js, keeps its argument handling: a missing,
+// zero or negative start is 0, a missing, zero, negative or too big end is
+// the length
+Handle<Value> Buffer::HexSlice(const Arguments &args) {
+  HandleScope scope;
+  Buffer *parent = ObjectWrap::Unwrap<Buffer>(args.This());
 
-    if (b1_oob) {
-      out[j++] = '=';
-    } else {
-      c = ((bitbuf[1] & 0x0F) << 2) | (bitbuf[2] >> 6);
-      assert(c < 64);
-      out[j++] = base64_table[(int)c];
-    }
-    assert(j < out_len);
+  double start = args[0]->NumberValue();
+  double end = args[1]->NumberValue();
+  if (!(start > 0)) start = 0;
+  if (!(end > 0) || end > parent->length_) end = parent->length_;
+  if (start >= end) return scope.Close(String::Empty());
 
-    if (b2_oob) {
-      out[j++] = '=';
-    } else {
-      c = bitbuf[2] & 0x3F;
-      assert(c < 64);
-      out[j++]  = base64_table[(int)c];
-    }
-    assert(j <= out_len);
-  }
+  size_t n = (size_t)end - (size_t)start;
+  char *out = new char[2 * n];
+  HexEncode(parent->data_ + (size_t)start, n, out);
 
-  Local<String> string = String::New(out, out_len);
+  Local<String> string = String::New(out, 2 * n);
   delete [] out;
   return scope.Close(string);
 }
@@ -457,6 +596,132 @@ Handle<Value> Buffer::Copy(const Arguments &args) {
 }
 
 
+// REQ: var index = buffer.indexOf(needle, start, end);
+// needle is a Buffer or a byte value, searched for in [start, end) of this
+// buffer. Returns the index into this buffer or -1.
+Handle<Value> Buffer::IndexOf(const Arguments &args) {
+  HandleScope scope;
+  Buffer *parent = ObjectWrap::Unwrap<Buffer>(args.This());
+  SLICE_ARGS(args[1], args[2])
+
+  const char *haystack = parent->data_ + start;
+  const char *match;
+
+  if (args[0]->IsNumber()) {
+    char byte = (char)args[0]->Int32Value();
+    match = FindBytes(haystack, end - start, &byte, 1);
+  } else if (Buffer::HasInstance(args[0])) {
+    Local<Object> needle = args[0]->ToObject();
+    match = FindBytes(haystack, end - start,
+                      Buffer::Data(needle), Buffer::Length(needle));
+  } else {
+    return ThrowException(Exception::TypeError(String::New(
+            "First argument must be a Buffer or a number")));
+  }
+
+  return scope.Close(Integer::New(match ? match - parent->data_ : -1));
+}
+
+
+// REQ: var order = buffer.compare(target, [start], [end]);
+// Compares [start, end) of this buffer (all of it by default) with all of
+// target, byte by byte and then by length. Returns -1, 0 or 1.
+Handle<Value> Buffer::Compare(const Arguments &args) {
+  HandleScope scope;
+  Buffer *parent = ObjectWrap::Unwrap<Buffer>(args.This());
+
+  if (!Buffer::HasInstance(args[0])) {
+    return ThrowException(Exception::TypeError(String::New(
+            "First argument must be a Buffer")));
+  }
+
+  Local<Value> start_arg = args[1];
+  Local<Value> end_arg = args[2];
+  if (start_arg->IsUndefined()) start_arg = Integer::New(0);
+  if (end_arg->IsUndefined()) end_arg = Integer::New(parent->length_);
+  SLICE_ARGS(start_arg, end_arg)
+
+  Local<Object> target = args[0]->ToObject();
+  size_t length = end - start;
+  size_t target_length = Buffer::Length(target);
+
+  int order = 0;
+  size_t common = MIN(length, target_length);
+  if (common > 0) {
+    order = memcmp(parent->data_ + start, Buffer::Data(target), common);
+  }
+  if (order == 0 && length != target_length) {
+    order = length < target_length ? -1 : 1;
+  }
+
+  return scope.Close(Integer::New(order < 0 ? -1 : order > 0 ? 1 : 0));
+}
+
+
+static inline bool IsHostBigEndian() {
+  return htonl(1) == 1;
+}
+
+static inline uint32_t ByteSwap(uint32_t x) {
+  return (x >> 24) | ((x >> 8) & 0xff00) | ((x << 8) & 0xff0000) | (x << 24);
+}
+
+static inline uint64_t ByteSwap(uint64_t x) {
+  return (static_cast<uint64_t>(ByteSwap(static_cast<uint32_t>(x))) << 32) |
+         ByteSwap(static_cast<uint32_t>(x >> 32));
+}
+
+// REQ: floats and doubles straight from/to the buffer memory instead of
+// assembling them bit by bit in buffer_ieee754.js. The results are the same
+// except for a double exactly half way between two floats: the cast rounds
+// it to the even one (IEEE 754, as a Float32Array would), writeIEEE754
+// rounded it away from zero.
+// var value = buffer.readFloatLE(offset);
+template <typename T, typename Bits, bool big_endian>
+static Handle<Value> ReadIEEE754(const Arguments &args) {
+  HandleScope scope;
+  Local<Object> self = args.This();
+  size_t length = Buffer::Length(self);
+
+  if (!args[0]->IsUint32() || args[0]->Uint32Value() > length ||
+      length - args[0]->Uint32Value() < sizeof(T)) {
+    return ThrowException(Exception::RangeError(String::New(
+            "Trying to read beyond buffer length")));
+  }
+
+  Bits bits;
+  memcpy(&bits, Buffer::Data(self) + args[0]->Uint32Value(), sizeof(bits));
+  if (big_endian != IsHostBigEndian()) bits = ByteSwap(bits);
+
+  T value;
+  memcpy(&value, &bits, sizeof(value));
+  return scope.Close(Number::New(value));
+}
+
+
+// buffer.writeFloatLE(value, offset);
+template <typename T, typename Bits, bool big_endian>
+static Handle<Value> WriteIEEE754(const Arguments &args) {
+  HandleScope scope;
+  Local<Object> self = args.This();
+  size_t length = Buffer::Length(self);
+
+  if (!args[1]->IsUint32() || args[1]->Uint32Value() > length ||
+      length - args[1]->Uint32Value() < sizeof(T)) {
+    return ThrowException(Exception::RangeError(String::New(
+            "Trying to write beyond buffer length")));
+  }
+
+  T value = static_cast<T>(args[0]->NumberValue());
+  Bits bits;
+  memcpy(&bits, &value, sizeof(bits));
+  if (big_endian != IsHostBigEndian()) bits = ByteSwap(bits);
+
+  memcpy(Buffer::Data(self) + args[1]->Uint32Value(), &bits, sizeof(bits));
+  return Undefined();
+}
+
+
 // var charsWritten = buffer.utf8Write(string, offset, [maxLength]);
 Handle<Value> Buffer::Utf8Write(const Arguments &args) {
   HandleScope scope;
@@ -484,10 +749,7 @@ Handle<Value> Buffer::Utf8Write(const Arguments &args) {
 
   int char_written;
 
-  int written = s->WriteUtf8(p,
-                             max_length,
-                             &char_written,
-                             String::HINT_MANY_WRITES_EXPECTED);
+  int written = WriteUtf8String(s, p, max_length, &char_written);
 
   constructor_template->GetFunction()->Set(chars_written_sym,
                                            Integer::New(char_written));
@@ -562,10 +824,7 @@ Handle<Value> Buffer::AsciiWrite(const Arguments &args) {
 
   char *p = buffer->data_ + offset;
 
-  int written = s->WriteAscii(p,
-                              0,
-                              max_length,
-                              String::HINT_MANY_WRITES_EXPECTED);
+  int written = WriteOneByteString(s, p, max_length, true);
   return scope.Close(Integer::New(written));
 }
 
@@ -618,6 +877,12 @@ Handle<Value> Buffer::Base64Write(const Arguments &args) {
   const char *src = *s;
   const char *const srcEnd = src + s.length();
 
+  // runs of whole groups go through the codec kernels, the loop below picks up
+  // at the first whitespace, padding or bad char
+  size_t decoded = Base64DecodeGroups(src, s.length(), dst);
+  src += decoded;
+  dst += decoded / 4 * 3;
+
   while (src < srcEnd) {
     int remaining = srcEnd - src;
 
@@ -657,6 +922,55 @@ Handle<Value> Buffer::Base64Write(const Arguments &args) {
 }
 
 
+// var bytesWritten = buffer.hexWrite(string, offset);
+// REQ: same results as the old parseInt loop in lib/buffer.js, including its
+// leniency (pairs like " f" or "1g" are parsed the way parseInt parses them)
+// and that it skips bytes outside the buffer instead of failing
+Handle<Value> Buffer::HexWrite(const Arguments &args) {
+  HandleScope scope;
+
+  Buffer *buffer = ObjectWrap::Unwrap<Buffer>(args.This());
+
+  if (!args[0]->IsString()) {
+    return ThrowException(Exception::TypeError(String::New(
+            "Argument must be a string")));
+  }
+
+  String::Value s(args[0]->ToString());
+  int32_t offset = args[1]->Int32Value();
+
+  // must be an even number of digits
+  if (s.length() % 2) {
+    return ThrowException(Exception::Error(String::New(
+            "Invalid hex string")));
+  }
+
+  const uint16_t *src = *s;
+  const int64_t pairs = s.length() / 2;
+  // pairs [lo, hi) land inside the buffer
+  const int64_t lo = MIN(pairs, MAX(0, -(int64_t)offset));
+  const int64_t hi = MAX(lo, MIN(pairs, (int64_t)buffer->length_ - offset));
+
+  int64_t i = 0;
+  while (i < pairs) {
+    if (i >= lo && i < hi) {
+      i += HexDecodePairs(src + 2 * i, hi - i, buffer->data_ + offset + i);
+      if (i == hi) continue;
+    }
+
+    uint8_t byte;
+    if (!HexParsePair(src[2 * i], src[2 * i + 1], &byte)) {
+      return ThrowException(Exception::Error(String::New(
+              "Invalid hex string")));
+    }
+    if (i >= lo && i < hi) buffer->data_[offset + i] = byte;
+    i++;
+  }
+
+  return scope.Close(Integer::New(pairs));
+}
+
+
 Handle<Value> Buffer::BinaryWrite(const Arguments &args) {
   HandleScope scope;
 
@@ -758,6 +1072,7 @@ void Buffer::Initialize(Handle<Object> target) {
   NODE_SET_PROTOTYPE_METHOD(constructor_template, "binarySlice", Buffer::BinarySlice);
   NODE_SET_PROTOTYPE_METHOD(constructor_template, "asciiSlice", Buffer::AsciiSlice);
   NODE_SET_PROTOTYPE_METHOD(constructor_template, "base64Slice", Buffer::Base64Slice);
+  NODE_SET_PROTOTYPE_METHOD(constructor_template, "hexSlice", Buffer::HexSlice);
   NODE_SET_PROTOTYPE_METHOD(constructor_template, "ucs2Slice", Buffer::Ucs2Slice);
   // TODO NODE_SET_PROTOTYPE_METHOD(t, "utf16Slice", Utf16Slice);
   // copy
@@ -767,9 +1082,28 @@ void Buffer::Initialize(Handle<Object> target) {
   NODE_SET_PROTOTYPE_METHOD(constructor_template, "asciiWrite", Buffer::AsciiWrite);
   NODE_SET_PROTOTYPE_METHOD(constructor_template, "binaryWrite", Buffer::BinaryWrite);
   NODE_SET_PROTOTYPE_METHOD(constructor_template, "base64Write", Buffer::Base64Write);
+  NODE_SET_PROTOTYPE_METHOD(constructor_template, "hexWrite", Buffer::HexWrite);
   NODE_SET_PROTOTYPE_METHOD(constructor_template, "ucs2Write", Buffer::Ucs2Write);
   NODE_SET_PROTOTYPE_METHOD(constructor_template, "fill", Buffer::Fill);
   NODE_SET_PROTOTYPE_METHOD(constructor_template, "copy", Buffer::Copy);
+  NODE_SET_PROTOTYPE_METHOD(constructor_template, "indexOf", Buffer::IndexOf);
+  NODE_SET_PROTOTYPE_METHOD(constructor_template, "compare", Buffer::Compare);
+  NODE_SET_PROTOTYPE_METHOD(constructor_template, "readFloatLE",
+                            (ReadIEEE754<float, uint32_t, false>));
+  NODE_SET_PROTOTYPE_METHOD(constructor_template, "readFloatBE",
+                            (ReadIEEE754<float, uint32_t, true>));
+  NODE_SET_PROTOTYPE_METHOD(constructor_template, "readDoubleLE",
+                            (ReadIEEE754<double, uint64_t, false>));
+  NODE_SET_PROTOTYPE_METHOD(constructor_template, "readDoubleBE",
+                            (ReadIEEE754<double, uint64_t, true>));
+  NODE_SET_PROTOTYPE_METHOD(constructor_template, "writeFloatLE",
+                            (WriteIEEE754<float, uint32_t, false>));
+  NODE_SET_PROTOTYPE_METHOD(constructor_template, "writeFloatBE",
+                            (WriteIEEE754<float, uint32_t, true>));
+  NODE_SET_PROTOTYPE_METHOD(constructor_template, "writeDoubleLE",
+                            (WriteIEEE754<double, uint64_t, false>));
+  NODE_SET_PROTOTYPE_METHOD(constructor_template, "writeDoubleBE",
+                            (WriteIEEE754<double, uint64_t, true>));
 
   NODE_SET_METHOD(constructor_template->GetFunction(),
                   "byteLength",
@@ -779,6 +1113,10 @@ void Buffer::Initialize(Handle<Object> target) {
                   Buffer::MakeFastBuffer);
 
   target->Set(String::NewSymbol("SlowBuffer"), constructor_template->GetFunction());
+  target->Set(String::NewSymbol("codecKernels"), String::New(CodecKernels()));
+
+  BufferList::Initialize(target);
+  StringDecoder::Initialize(target);
 }
 
 
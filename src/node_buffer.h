@@ -63,6 +63,22 @@ namespace node {
  */
 
 
+/**
+ * Counters of the size class free lists buffer memory comes from
+ * (see Buffer::GetAllocatorStats)
+ */
+struct BufferAllocatorStats {
+  unsigned int allocs;      // buffers that got memory
+  unsigned int hits;        // served from a free list
+  unsigned int misses;      // size class free list was empty, new[]
+  unsigned int unpooled;    // too small or too big for a size class, new[]
+  unsigned int recycled;    // freed chunks kept for the next buffer
+  unsigned int released;    // freed chunks deleted, their free list was full
+  unsigned int cached;      // bytes kept in the free lists right now
+  unsigned int adopted;     // bytes of Buffer::Adopt memory not released yet
+};
+
+
 class Buffer : public ObjectWrap {
  public:
 
@@ -88,6 +104,7 @@ class Buffer : public ObjectWrap {
   ~Buffer();
 
   typedef void (*free_callback)(char *data, void *hint);
+  typedef void (*release_callback)(char *data, size_t length, void *hint);
 
   // C++ API for constructing fast buffer
   static v8::Handle<v8::Object> New(v8::Handle<v8::String> string);
@@ -98,6 +115,46 @@ class Buffer : public ObjectWrap {
   static Buffer* New(char *data, size_t length,
                      free_callback callback, void *hint); // public constructor
 
+  /**
+   * REQ: Wraps memory a native producer already has (a decompressed file, a
+   * camera frame, an mmap'd region) without copying it. The buffer owns the
+   * memory from here on: release(data, length, hint) is called once when
+   * the buffer is gone, always on the main thread, and may run later than
+   * the gc that collected it. Unlike New() with a free_callback, length is
+   * reported to v8 as external memory (so big adopted regions make the gc
+   * collect sooner) and counted against the current node instance.
+   *
+   *   char *data = (char*)malloc(size);
+   *   ... fill data ...
+   *   Buffer *b = Buffer::Adopt(data, size, Buffer::ReleaseFree, NULL);
+   *
+   *   void *map = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+   *   Buffer *b = Buffer::Adopt((char*)map, size, Unmap, NULL);
+   *   // with: static void Unmap(char *d, size_t l, void*) { munmap(d, l); }
+   *
+   * Must be called on the main thread with a context entered. Returns NULL
+   * when the buffer object could not be created, the memory is released
+   * right away in that case.
+   */
+  static Buffer* Adopt(char *data, size_t length,
+                       release_callback release, void *hint);
+
+  // release_callback for memory from malloc()
+  static void ReleaseFree(char *data, size_t length, void *hint);
+
+  // REQ: a buffer can be destroyed in a gc or with its node instance, where
+  // there is no context to touch its handle in and calling the free
+  // callback is not safe, its memory is queued and handed back here, on the
+  // main thread (called after every drain of the event loop)
+  static void ReclaimPending();
+
+  // memory of the buffers (with their queued memory) reported to v8 through
+  // AdjustAmountOfExternalAllocatedMemory, in bytes
+  static size_t ExternalMemory();
+
+  // @param stats filled with the allocator counters since startup
+  static void GetAllocatorStats(BufferAllocatorStats *stats);
+
   private:
   static v8::Persistent<v8::FunctionTemplate> constructor_template;
 
@@ -105,10 +162,12 @@ class Buffer : public ObjectWrap {
   static v8::Handle<v8::Value> BinarySlice(const v8::Arguments &args);
   static v8::Handle<v8::Value> AsciiSlice(const v8::Arguments &args);
   static v8::Handle<v8::Value> Base64Slice(const v8::Arguments &args);
+  static v8::Handle<v8::Value> HexSlice(const v8::Arguments &args);
   static v8::Handle<v8::Value> Utf8Slice(const v8::Arguments &args);
   static v8::Handle<v8::Value> Ucs2Slice(const v8::Arguments &args);
   static v8::Handle<v8::Value> BinaryWrite(const v8::Arguments &args);
   static v8::Handle<v8::Value> Base64Write(const v8::Arguments &args);
+  static v8::Handle<v8::Value> HexWrite(const v8::Arguments &args);
   static v8::Handle<v8::Value> AsciiWrite(const v8::Arguments &args);
   static v8::Handle<v8::Value> Utf8Write(const v8::Arguments &args);
   static v8::Handle<v8::Value> Ucs2Write(const v8::Arguments &args);
@@ -116,14 +175,20 @@ class Buffer : public ObjectWrap {
   static v8::Handle<v8::Value> MakeFastBuffer(const v8::Arguments &args);
   static v8::Handle<v8::Value> Fill(const v8::Arguments &args);
   static v8::Handle<v8::Value> Copy(const v8::Arguments &args);
+  static v8::Handle<v8::Value> IndexOf(const v8::Arguments &args);
+  static v8::Handle<v8::Value> Compare(const v8::Arguments &args);
 
   Buffer(v8::Handle<v8::Object> wrapper, size_t length);
   void Replace(char *data, size_t length, free_callback callback, void *hint);
+  void ReleaseMemory();
+  void Expose();
 
   size_t length_;
   char* data_;
   free_callback callback_;
+  release_callback release_; // set for adopted memory, see Adopt
   void* callback_hint_;
+  Node* owner_; // instance the memory is accounted to (see Node::AdjustBufferMemory)
 };
 
 
@@ -0,0 +1,741 @@
+// Copyright (c) 2011, Code Aurora Forum. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to permit
+// persons to whom the Software is furnished to do so, subject to the
+// following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN
+// NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+// OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE
+// USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+#include <node_buffer_codec.h>
+
+#include <stdlib.h> // getenv
+#include <string.h> // memcpy, strcmp, memchr, memcmp
+
+#if defined(__SSSE3__)
+# define NODE_CODEC_SSSE3 1
+# define SSSE3_TARGET
+#elif (defined(__i386__) || defined(__x86_64__)) && \
+      (defined(__clang__) || __GNUC__ > 4 || \
+       (__GNUC__ == 4 && __GNUC_MINOR__ >= 9))
+// built for plain x86, the SSSE3 kernels are only used when cpuid has it
+# define NODE_CODEC_SSSE3 1
+# define NODE_CODEC_CPUID 1
+# define SSSE3_TARGET __attribute__((target("ssse3")))
+#endif
+
+#if defined(__ARM_NEON__) || defined(__ARM_NEON) || defined(__aarch64__)
+// a binary built with NEON needs it anyway, nothing to check at runtime
+# define NODE_CODEC_NEON 1
+#endif
+
+#ifdef NODE_CODEC_SSSE3
+# include <tmmintrin.h>
+#endif
+#ifdef NODE_CODEC_CPUID
+# include <cpuid.h>
+#endif
+#ifdef NODE_CODEC_NEON
+# include <arm_neon.h>
+#endif
+
+namespace node {
+
+const char base64_table[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZ"
+                            "abcdefghijklmnopqrstuvwxyz"
+                            "0123456789+/";
+const int unbase64_table[256] =
+  {-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-2,-1,-1,-2,-1,-1
+  ,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1
+  ,-2,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,62,-1,-1,-1,63
+  ,52,53,54,55,56,57,58,59,60,61,-1,-1,-1,-1,-1,-1
+  ,-1, 0, 1, 2, 3, 4, 5, 6, 7, 8, 9,10,11,12,13,14
+  ,15,16,17,18,19,20,21,22,23,24,25,-1,-1,-1,-1,-1
+  ,-1,26,27,28,29,30,31,32,33,34,35,36,37,38,39,40
+  ,41,42,43,44,45,46,47,48,49,50,51,-1,-1,-1,-1,-1
+  ,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1
+  ,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1
+  ,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1
+  ,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1
+  ,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1
+  ,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1
+  ,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1
+  ,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1
+  };
+
+static const char hex_table[] = "0123456789abcdef";
+
+
+static inline int HexValue(uint16_t c) {
+  if (c >= '0' && c <= '9') return c - '0';
+  c |= 0x20;
+  if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+  return -1;
+}
+
+
+// Scalar kernels, also finish whatever the vector ones leave over
+
+static void Base64EncodeScalar(const char *src, size_t len, char *dst) {
+  const uint8_t *in = (const uint8_t*)src;
+  size_t i = 0;
+
+  for (; len - i >= 3; i += 3) {
+    *dst++ = base64_table[in[i] >> 2];
+    *dst++ = base64_table[((in[i] & 0x03) << 4) | (in[i + 1] >> 4)];
+    *dst++ = base64_table[((in[i + 1] & 0x0F) << 2) | (in[i + 2] >> 6)];
+    *dst++ = base64_table[in[i + 2] & 0x3F];
+  }
+
+  if (len - i == 1) {
+    *dst++ = base64_table[in[i] >> 2];
+    *dst++ = base64_table[(in[i] & 0x03) << 4];
+    *dst++ = '=';
+    *dst++ = '=';
+  } else if (len - i == 2) {
+    *dst++ = base64_table[in[i] >> 2];
+    *dst++ = base64_table[((in[i] & 0x03) << 4) | (in[i + 1] >> 4)];
+    *dst++ = base64_table[(in[i + 1] & 0x0F) << 2];
+    *dst++ = '=';
+  }
+}
+
+
+static size_t Base64DecodeGroupsScalar(const char *src, size_t len,
+                                       char *dst) {
+  const uint8_t *in = (const uint8_t*)src;
+  size_t i = 0;
+
+  for (; len - i >= 4; i += 4) {
+    int a = unbase64_table[in[i]];
+    int b = unbase64_table[in[i + 1]];
+    int c = unbase64_table[in[i + 2]];
+    int d = unbase64_table[in[i + 3]];
+    // -1 and -2 both have the sign bit
+    if ((a | b | c | d) < 0) break;
+    *dst++ = (a << 2) | (b >> 4);
+    *dst++ = (b << 4) | (c >> 2);
+    *dst++ = (c << 6) | d;
+  }
+  return i;
+}
+
+
+static void HexEncodeScalar(const char *src, size_t len, char *dst) {
+  const uint8_t *in = (const uint8_t*)src;
+  for (size_t i = 0; i < len; i++) {
+    *dst++ = hex_table[in[i] >> 4];
+    *dst++ = hex_table[in[i] & 0x0F];
+  }
+}
+
+
+static size_t HexDecodePairsScalar(const uint16_t *src, size_t pairs,
+                                   char *dst) {
+  size_t i = 0;
+  for (; i < pairs; i++) {
+    int hi = HexValue(src[2 * i]);
+    int lo = HexValue(src[2 * i + 1]);
+    if ((hi | lo) < 0) break;
+    dst[i] = (hi << 4) | lo;
+  }
+  return i;
+}
+
+
+static size_t AsciiPrefixScalar(const char *src, size_t len) {
+  size_t i = 0;
+  while (i < len && !(src[i] & 0x80)) i++;
+  return i;
+}
+
+
+static size_t NarrowAsciiScalar(const uint16_t *src, size_t len, char *dst) {
+  size_t i = 0;
+  for (; i < len && src[i] < 0x80; i++) dst[i] = src[i];
+  return i;
+}
+
+
+static void NarrowLatin1Scalar(const uint16_t *src, size_t len, char *dst) {
+  for (size_t i = 0; i < len; i++) dst[i] = (char)src[i];
+}
+
+
+#ifdef NODE_CODEC_SSSE3
+
+// x <= k, unsigned per byte
+static inline SSSE3_TARGET __m128i LessEqU8(__m128i x, __m128i k) {
+  return _mm_cmpeq_epi8(_mm_min_epu8(x, k), x);
+}
+
+
+// 6 bit values to alphabet chars, by adding the offset of the range they
+// fall in: A-Z +65, a-z +71, 0-9 -4, '+' -19, '/' -16
+static inline SSSE3_TARGET __m128i Base64Chars(__m128i idx) {
+  __m128i off = _mm_set1_epi8(65);
+  off = _mm_add_epi8(off, _mm_and_si128(
+        _mm_cmpgt_epi8(idx, _mm_set1_epi8(25)), _mm_set1_epi8(6)));
+  off = _mm_sub_epi8(off, _mm_and_si128(
+        _mm_cmpgt_epi8(idx, _mm_set1_epi8(51)), _mm_set1_epi8(75)));
+  off = _mm_sub_epi8(off, _mm_and_si128(
+        _mm_cmpgt_epi8(idx, _mm_set1_epi8(61)), _mm_set1_epi8(15)));
+  off = _mm_add_epi8(off, _mm_and_si128(
+        _mm_cmpeq_epi8(idx, _mm_set1_epi8(63)), _mm_set1_epi8(3)));
+  return _mm_add_epi8(idx, off);
+}
+
+
+static SSSE3_TARGET void Base64EncodeSSSE3(const char *src, size_t len,
+                                           char *dst) {
+  // spread bytes 3n..3n+2 over lane n as b1 b0 b2 b1, the multiplies then
+  // shift each of the 4 fields into a byte of its own
+  const __m128i spread = _mm_set_epi8(10, 11, 9, 10, 7, 8, 6, 7,
+                                      4, 5, 3, 4, 1, 2, 0, 1);
+  size_t i = 0;
+
+  // loads 16 bytes, uses 12
+  for (; len - i >= 16; i += 12, dst += 16) {
+    __m128i in = _mm_loadu_si128((const __m128i*)(src + i));
+    in = _mm_shuffle_epi8(in, spread);
+    __m128i ac = _mm_mulhi_epu16(_mm_and_si128(in, _mm_set1_epi32(0x0fc0fc00)),
+                                 _mm_set1_epi32(0x04000040));
+    __m128i bd = _mm_mullo_epi16(_mm_and_si128(in, _mm_set1_epi32(0x003f03f0)),
+                                 _mm_set1_epi32(0x01000010));
+    _mm_storeu_si128((__m128i*)dst, Base64Chars(_mm_or_si128(ac, bd)));
+  }
+  Base64EncodeScalar(src + i, len - i, dst);
+}
+
+
+static SSSE3_TARGET size_t Base64DecodeGroupsSSSE3(const char *src,
+                                                   size_t len, char *dst) {
+  // the 3 bytes of each lane, big end first
+  const __m128i pack = _mm_setr_epi8(2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12,
+                                     -1, -1, -1, -1);
+  size_t i = 0;
+
+  for (; len - i >= 16; i += 16, dst += 12) {
+    __m128i c = _mm_loadu_si128((const __m128i*)(src + i));
+
+    __m128i upper = LessEqU8(_mm_sub_epi8(c, _mm_set1_epi8('A')),
+                             _mm_set1_epi8(25));
+    __m128i lower = LessEqU8(_mm_sub_epi8(c, _mm_set1_epi8('a')),
+                             _mm_set1_epi8(25));
+    __m128i digit = LessEqU8(_mm_sub_epi8(c, _mm_set1_epi8('0')),
+                             _mm_set1_epi8(9));
+    __m128i plus = _mm_cmpeq_epi8(c, _mm_set1_epi8('+'));
+    __m128i slash = _mm_cmpeq_epi8(c, _mm_set1_epi8('/'));
+
+    __m128i valid = _mm_or_si128(_mm_or_si128(upper, lower),
+                                 _mm_or_si128(digit, _mm_or_si128(plus, slash)));
+    if (_mm_movemask_epi8(valid) != 0xFFFF) break;
+
+    __m128i shift = _mm_and_si128(upper, _mm_set1_epi8(-65));
+    shift = _mm_or_si128(shift, _mm_and_si128(lower, _mm_set1_epi8(-71)));
+    shift = _mm_or_si128(shift, _mm_and_si128(digit, _mm_set1_epi8(4)));
+    shift = _mm_or_si128(shift, _mm_and_si128(plus, _mm_set1_epi8(19)));
+    shift = _mm_or_si128(shift, _mm_and_si128(slash, _mm_set1_epi8(16)));
+    __m128i v = _mm_add_epi8(c, shift);
+
+    // a b c d -> a << 6 | b, c << 6 | d -> a << 18 | b << 12 | c << 6 | d
+    v = _mm_maddubs_epi16(v, _mm_set1_epi32(0x01400140));
+    v = _mm_madd_epi16(v, _mm_set1_epi32(0x00011000));
+    v = _mm_shuffle_epi8(v, pack);
+
+    // exactly 12 bytes, dst may end right there
+    _mm_storel_epi64((__m128i*)dst, v);
+    int tail = _mm_cvtsi128_si32(_mm_srli_si128(v, 8));
+    memcpy(dst + 8, &tail, 4);
+  }
+  return i + Base64DecodeGroupsScalar(src + i, len - i, dst);
+}
+
+
+static SSSE3_TARGET void HexEncodeSSSE3(const char *src, size_t len,
+                                        char *dst) {
+  const __m128i digits = _mm_loadu_si128((const __m128i*)hex_table);
+  const __m128i nibble = _mm_set1_epi8(0x0F);
+  size_t i = 0;
+
+  for (; len - i >= 16; i += 16, dst += 32) {
+    __m128i in = _mm_loadu_si128((const __m128i*)(src + i));
+    __m128i hi = _mm_shuffle_epi8(digits,
+        _mm_and_si128(_mm_srli_epi16(in, 4), nibble));
+    __m128i lo = _mm_shuffle_epi8(digits, _mm_and_si128(in, nibble));
+    _mm_storeu_si128((__m128i*)dst, _mm_unpacklo_epi8(hi, lo));
+    _mm_storeu_si128((__m128i*)(dst + 16), _mm_unpackhi_epi8(hi, lo));
+  }
+  HexEncodeScalar(src + i, len - i, dst);
+}
+
+
+// hex digit values, any byte that isn't one sets its lane in *bad
+static inline SSSE3_TARGET __m128i HexValues(__m128i c, __m128i *bad) {
+  __m128i num = _mm_sub_epi8(c, _mm_set1_epi8('0'));
+  __m128i digit = LessEqU8(num, _mm_set1_epi8(9));
+  // | 0x20 folds A-F onto a-f
+  __m128i alpha = _mm_sub_epi8(_mm_or_si128(c, _mm_set1_epi8(0x20)),
+                               _mm_set1_epi8('a'));
+  __m128i letter = LessEqU8(alpha, _mm_set1_epi8(5));
+  *bad = _mm_or_si128(*bad, _mm_andnot_si128(_mm_or_si128(digit, letter),
+                                             _mm_set1_epi8(-1)));
+  return _mm_or_si128(_mm_and_si128(digit, num),
+      _mm_andnot_si128(digit, _mm_add_epi8(alpha, _mm_set1_epi8(10))));
+}
+
+
+static SSSE3_TARGET size_t HexDecodePairsSSSE3(const uint16_t *src,
+                                               size_t pairs, char *dst) {
+  size_t i = 0;
+
+  for (; pairs - i >= 16; i += 16) {
+    const __m128i *in = (const __m128i*)(src + 2 * i);
+    // chars above 0xFF saturate to 0xFF (or 0 above 0x7FFF), not hex either
+    __m128i c0 = _mm_packus_epi16(_mm_loadu_si128(in), _mm_loadu_si128(in + 1));
+    __m128i c1 = _mm_packus_epi16(_mm_loadu_si128(in + 2),
+                                  _mm_loadu_si128(in + 3));
+    __m128i bad = _mm_setzero_si128();
+    __m128i v0 = HexValues(c0, &bad);
+    __m128i v1 = HexValues(c1, &bad);
+    if (_mm_movemask_epi8(bad)) break;
+
+    // hi * 16 + lo for every pair
+    const __m128i weights = _mm_set1_epi16(0x0110);
+    __m128i out = _mm_packus_epi16(_mm_maddubs_epi16(v0, weights),
+                                   _mm_maddubs_epi16(v1, weights));
+    _mm_storeu_si128((__m128i*)(dst + i), out);
+  }
+  return i + HexDecodePairsScalar(src + 2 * i, pairs - i, dst + i);
+}
+
+
+
+// the ASCII scans only need SSE2, they go with the rest of the set
+static SSSE3_TARGET size_t AsciiPrefixSSSE3(const char *src, size_t len) {
+  size_t i = 0;
+  for (; len - i >= 16; i += 16) {
+    __m128i in = _mm_loadu_si128((const __m128i*)(src + i));
+    if (_mm_movemask_epi8(in)) break;
+  }
+  return i + AsciiPrefixScalar(src + i, len - i);
+}
+
+
+static SSSE3_TARGET size_t NarrowAsciiSSSE3(const uint16_t *src, size_t len,
+                                            char *dst) {
+  const __m128i high = _mm_set1_epi16((short)0xFF80);
+  size_t i = 0;
+  for (; len - i >= 16; i += 16) {
+    __m128i a = _mm_loadu_si128((const __m128i*)(src + i));
+    __m128i b = _mm_loadu_si128((const __m128i*)(src + i + 8));
+    __m128i wide = _mm_and_si128(_mm_or_si128(a, b), high);
+    if (_mm_movemask_epi8(_mm_cmpeq_epi16(wide, _mm_setzero_si128())) != 0xFFFF) {
+      break;
+    }
+    _mm_storeu_si128((__m128i*)(dst + i), _mm_packus_epi16(a, b));
+  }
+  return i + NarrowAsciiScalar(src + i, len - i, dst + i);
+}
+
+
+static SSSE3_TARGET void NarrowLatin1SSSE3(const uint16_t *src, size_t len,
+                                           char *dst) {
+  const __m128i low = _mm_set1_epi16(0x00FF);
+  size_t i = 0;
+  for (; len - i >= 16; i += 16) {
+    __m128i a = _mm_loadu_si128((const __m128i*)(src + i));
+    __m128i b = _mm_loadu_si128((const __m128i*)(src + i + 8));
+    _mm_storeu_si128((__m128i*)(dst + i),
+        _mm_packus_epi16(_mm_and_si128(a, low), _mm_and_si128(b, low)));
+  }
+  NarrowLatin1Scalar(src + i, len - i, dst + i);
+}
+
+#endif  // NODE_CODEC_SSSE3
+
+
+#ifdef NODE_CODEC_NEON
+
+static inline bool AnySet(uint8x16_t v) {
+  uint64x2_t w = vreinterpretq_u64_u8(v);
+  return (vgetq_lane_u64(w, 0) | vgetq_lane_u64(w, 1)) != 0;
+}
+
+
+// same offsets as the SSSE3 Base64Chars
+static inline uint8x16_t Base64Chars(uint8x16_t idx) {
+  uint8x16_t off = vdupq_n_u8(65);
+  off = vaddq_u8(off, vandq_u8(vcgeq_u8(idx, vdupq_n_u8(26)), vdupq_n_u8(6)));
+  off = vsubq_u8(off, vandq_u8(vcgeq_u8(idx, vdupq_n_u8(52)), vdupq_n_u8(75)));
+  off = vsubq_u8(off, vandq_u8(vcgeq_u8(idx, vdupq_n_u8(62)), vdupq_n_u8(15)));
+  off = vaddq_u8(off, vandq_u8(vceqq_u8(idx, vdupq_n_u8(63)), vdupq_n_u8(3)));
+  return vaddq_u8(idx, off);
+}
+
+
+static void Base64EncodeNEON(const char *src, size_t len, char *dst) {
+  const uint8x16_t six = vdupq_n_u8(0x3F);
+  size_t i = 0;
+
+  // 16 groups of 3 bytes, deinterleaved by the load
+  for (; len - i >= 48; i += 48, dst += 64) {
+    uint8x16x3_t in = vld3q_u8((const uint8_t*)src + i);
+    uint8x16x4_t out;
+    out.val[0] = vshrq_n_u8(in.val[0], 2);
+    out.val[1] = vandq_u8(vorrq_u8(vshlq_n_u8(in.val[0], 4),
+                                   vshrq_n_u8(in.val[1], 4)), six);
+    out.val[2] = vandq_u8(vorrq_u8(vshlq_n_u8(in.val[1], 2),
+                                   vshrq_n_u8(in.val[2], 6)), six);
+    out.val[3] = vandq_u8(in.val[2], six);
+    out.val[0] = Base64Chars(out.val[0]);
+    out.val[1] = Base64Chars(out.val[1]);
+    out.val[2] = Base64Chars(out.val[2]);
+    out.val[3] = Base64Chars(out.val[3]);
+    vst4q_u8((uint8_t*)dst, out);
+  }
+  Base64EncodeScalar(src + i, len - i, dst);
+}
+
+
+static inline uint8x16_t Base64Values(uint8x16_t c, uint8x16_t *bad) {
+  uint8x16_t upper = vcleq_u8(vsubq_u8(c, vdupq_n_u8('A')), vdupq_n_u8(25));
+  uint8x16_t lower = vcleq_u8(vsubq_u8(c, vdupq_n_u8('a')), vdupq_n_u8(25));
+  uint8x16_t digit = vcleq_u8(vsubq_u8(c, vdupq_n_u8('0')), vdupq_n_u8(9));
+  uint8x16_t plus = vceqq_u8(c, vdupq_n_u8('+'));
+  uint8x16_t slash = vceqq_u8(c, vdupq_n_u8('/'));
+
+  uint8x16_t valid = vorrq_u8(vorrq_u8(upper, lower),
+                              vorrq_u8(digit, vorrq_u8(plus, slash)));
+  *bad = vorrq_u8(*bad, vmvnq_u8(valid));
+
+  uint8x16_t shift = vandq_u8(upper, vdupq_n_u8((uint8_t)-65));
+  shift = vorrq_u8(shift, vandq_u8(lower, vdupq_n_u8((uint8_t)-71)));
+  shift = vorrq_u8(shift, vandq_u8(digit, vdupq_n_u8(4)));
+  shift = vorrq_u8(shift, vandq_u8(plus, vdupq_n_u8(19)));
+  shift = vorrq_u8(shift, vandq_u8(slash, vdupq_n_u8(16)));
+  return vaddq_u8(c, shift);
+}
+
+
+static size_t Base64DecodeGroupsNEON(const char *src, size_t len, char *dst) {
+  size_t i = 0;
+
+  for (; len - i >= 64; i += 64, dst += 48) {
+    uint8x16x4_t in = vld4q_u8((const uint8_t*)src + i);
+    uint8x16_t bad = vdupq_n_u8(0);
+    uint8x16_t a = Base64Values(in.val[0], &bad);
+    uint8x16_t b = Base64Values(in.val[1], &bad);
+    uint8x16_t c = Base64Values(in.val[2], &bad);
+    uint8x16_t d = Base64Values(in.val[3], &bad);
+    if (AnySet(bad)) break;
+
+    uint8x16x3_t out;
+    out.val[0] = vorrq_u8(vshlq_n_u8(a, 2), vshrq_n_u8(b, 4));
+    out.val[1] = vorrq_u8(vshlq_n_u8(b, 4), vshrq_n_u8(c, 2));
+    out.val[2] = vorrq_u8(vshlq_n_u8(c, 6), d);
+    vst3q_u8((uint8_t*)dst, out);
+  }
+  return i + Base64DecodeGroupsScalar(src + i, len - i, dst);
+}
+
+
+static inline uint8x16_t HexChars(uint8x16_t v) {
+  // 10-15 need 'a' - '0' - 10 more to land on a-f
+  uint8x16_t gap = vandq_u8(vcgtq_u8(v, vdupq_n_u8(9)), vdupq_n_u8(39));
+  return vaddq_u8(vaddq_u8(v, vdupq_n_u8('0')), gap);
+}
+
+
+static void HexEncodeNEON(const char *src, size_t len, char *dst) {
+  size_t i = 0;
+
+  for (; len - i >= 16; i += 16, dst += 32) {
+    uint8x16_t in = vld1q_u8((const uint8_t*)src + i);
+    uint8x16x2_t out;
+    out.val[0] = HexChars(vshrq_n_u8(in, 4));
+    out.val[1] = HexChars(vandq_u8(in, vdupq_n_u8(0x0F)));
+    vst2q_u8((uint8_t*)dst, out);
+  }
+  HexEncodeScalar(src + i, len - i, dst);
+}
+
+
+static inline uint8x8_t HexValues(uint8x8_t c, uint8x8_t *bad) {
+  uint8x8_t num = vsub_u8(c, vdup_n_u8('0'));
+  uint8x8_t digit = vcle_u8(num, vdup_n_u8(9));
+  uint8x8_t alpha = vsub_u8(vorr_u8(c, vdup_n_u8(0x20)), vdup_n_u8('a'));
+  uint8x8_t letter = vcle_u8(alpha, vdup_n_u8(5));
+  *bad = vorr_u8(*bad, vmvn_u8(vorr_u8(digit, letter)));
+  return vbsl_u8(digit, num, vadd_u8(alpha, vdup_n_u8(10)));
+}
+
+
+static size_t HexDecodePairsNEON(const uint16_t *src, size_t pairs,
+                                 char *dst) {
+  size_t i = 0;
+
+  for (; pairs - i >= 8; i += 8) {
+    // first and second digit of 8 pairs, saturated to bytes
+    uint16x8x2_t in = vld2q_u16(src + 2 * i);
+    uint8x8_t bad = vdup_n_u8(0);
+    uint8x8_t hi = HexValues(vqmovn_u16(in.val[0]), &bad);
+    uint8x8_t lo = HexValues(vqmovn_u16(in.val[1]), &bad);
+    if (vget_lane_u64(vreinterpret_u64_u8(bad), 0)) break;
+    vst1_u8((uint8_t*)dst + i, vorr_u8(vshl_n_u8(hi, 4), lo));
+  }
+  return i + HexDecodePairsScalar(src + 2 * i, pairs - i, dst + i);
+}
+
+
+
+static size_t AsciiPrefixNEON(const char *src, size_t len) {
+  size_t i = 0;
+  for (; len - i >= 16; i += 16) {
+    uint8x16_t in = vld1q_u8((const uint8_t*)src + i);
+    if (AnySet(vandq_u8(in, vdupq_n_u8(0x80)))) break;
+  }
+  return i + AsciiPrefixScalar(src + i, len - i);
+}
+
+
+static size_t NarrowAsciiNEON(const uint16_t *src, size_t len, char *dst) {
+  size_t i = 0;
+  for (; len - i >= 16; i += 16) {
+    uint16x8_t a = vld1q_u16(src + i);
+    uint16x8_t b = vld1q_u16(src + i + 8);
+    uint16x8_t wide = vandq_u16(vorrq_u16(a, b), vdupq_n_u16(0xFF80));
+    if (AnySet(vreinterpretq_u8_u16(wide))) break;
+    vst1q_u8((uint8_t*)dst + i, vcombine_u8(vmovn_u16(a), vmovn_u16(b)));
+  }
+  return i + NarrowAsciiScalar(src + i, len - i, dst + i);
+}
+
+
+static void NarrowLatin1NEON(const uint16_t *src, size_t len, char *dst) {
+  size_t i = 0;
+  for (; len - i >= 16; i += 16) {
+    // vmovn keeps the low byte, like the (char) cast
+    uint8x8_t a = vmovn_u16(vld1q_u16(src + i));
+    uint8x8_t b = vmovn_u16(vld1q_u16(src + i + 8));
+    vst1q_u8((uint8_t*)dst + i, vcombine_u8(a, b));
+  }
+  NarrowLatin1Scalar(src + i, len - i, dst + i);
+}
+
+#endif  // NODE_CODEC_NEON
+
+
+struct Kernels {
+  const char *name;
+  void (*base64Encode)(const char *src, size_t len, char *dst);
+  size_t (*base64DecodeGroups)(const char *src, size_t len, char *dst);
+  void (*hexEncode)(const char *src, size_t len, char *dst);
+  size_t (*hexDecodePairs)(const uint16_t *src, size_t pairs, char *dst);
+  size_t (*asciiPrefix)(const char *src, size_t len);
+  size_t (*narrowAscii)(const uint16_t *src, size_t len, char *dst);
+  void (*narrowLatin1)(const uint16_t *src, size_t len, char *dst);
+};
+
+static const Kernels scalar_kernels = {
+  "scalar",
+  Base64EncodeScalar,
+  Base64DecodeGroupsScalar,
+  HexEncodeScalar,
+  HexDecodePairsScalar,
+  AsciiPrefixScalar,
+  NarrowAsciiScalar,
+  NarrowLatin1Scalar
+};
+
+#ifdef NODE_CODEC_SSSE3
+static const Kernels ssse3_kernels = {
+  "ssse3",
+  Base64EncodeSSSE3,
+  Base64DecodeGroupsSSSE3,
+  HexEncodeSSSE3,
+  HexDecodePairsSSSE3,
+  AsciiPrefixSSSE3,
+  NarrowAsciiSSSE3,
+  NarrowLatin1SSSE3
+};
+#endif
+
+#ifdef NODE_CODEC_NEON
+static const Kernels neon_kernels = {
+  "neon",
+  Base64EncodeNEON,
+  Base64DecodeGroupsNEON,
+  HexEncodeNEON,
+  HexDecodePairsNEON,
+  AsciiPrefixNEON,
+  NarrowAsciiNEON,
+  NarrowLatin1NEON
+};
+#endif
+
+
+static const Kernels* SelectKernels() {
+  const char *forced = getenv("NODE_CODEC");
+  if (forced && !strcmp(forced, "scalar")) return &scalar_kernels;
+
+#ifdef NODE_CODEC_SSSE3
+# ifdef NODE_CODEC_CPUID
+  unsigned int eax, ebx, ecx, edx;
+  if (__get_cpuid(1, &eax, &ebx, &ecx, &edx) && (ecx & bit_SSSE3)) {
+    return &ssse3_kernels;
+  }
+# else
+  return &ssse3_kernels;
+# endif
+#endif
+
+#ifdef NODE_CODEC_NEON
+  return &neon_kernels;
+#endif
+
+  return &scalar_kernels;
+}
+
+
+// Buffers are only touched from the main thread, no need to lock this
+static const Kernels *kernels = NULL;
+
+static inline const Kernels* GetKernels() {
+  if (!kernels) kernels = SelectKernels();
+  return kernels;
+}
+
+
+const char* CodecKernels() {
+  return GetKernels()->name;
+}
+
+
+void Base64Encode(const char *src, size_t len, char *dst) {
+  GetKernels()->base64Encode(src, len, dst);
+}
+
+
+size_t Base64DecodeGroups(const char *src, size_t len, char *dst) {
+  return GetKernels()->base64DecodeGroups(src, len, dst);
+}
+
+
+void HexEncode(const char *src, size_t len, char *dst) {
+  GetKernels()->hexEncode(src, len, dst);
+}
+
+
+size_t HexDecodePairs(const uint16_t *src, size_t pairs, char *dst) {
+  return GetKernels()->hexDecodePairs(src, pairs, dst);
+}
+
+
+size_t AsciiPrefix(const char *src, size_t len) {
+  return GetKernels()->asciiPrefix(src, len);
+}
+
+
+size_t NarrowAscii(const uint16_t *src, size_t len, char *dst) {
+  return GetKernels()->narrowAscii(src, len, dst);
+}
+
+
+void NarrowLatin1(const uint16_t *src, size_t len, char *dst) {
+  GetKernels()->narrowLatin1(src, len, dst);
+}
+
+
+// what v8's parseInt skips in front of a number
+static inline bool IsJsWhiteSpace(uint16_t c) {
+  return c == ' ' || (c >= 0x09 && c <= 0x0D) || c == 0xA0 ||
+         c == 0x1680 || c == 0x180E || (c >= 0x2000 && c <= 0x200A) ||
+         c == 0x2028 || c == 0x2029 || c == 0x202F || c == 0x205F ||
+         c == 0x3000 || c == 0xFEFF;
+}
+
+
+bool HexParsePair(uint16_t c0, uint16_t c1, uint8_t *byte) {
+  uint16_t s[2] = { c0, c1 };
+  int i = 0;
+  bool negative = false;
+
+  if (IsJsWhiteSpace(s[i])) i++;
+  if (i < 2 && (s[i] == '-' || s[i] == '+')) {
+    negative = s[i] == '-';
+    i++;
+  }
+  // radix 16 drops a 0x prefix, which leaves nothing to parse here
+  if (i == 0 && s[0] == '0' && (s[1] | 0x20) == 'x') return false;
+
+  int value = 0;
+  int digits = 0;
+  for (; i < 2 && HexValue(s[i]) >= 0; i++, digits++) {
+    value = value * 16 + HexValue(s[i]);
+  }
+  if (!digits) return false;
+
+  // stored the way an out of range number is stored into a buffer index
+  *byte = (uint8_t)(negative ? -value : value);
+  return true;
+}
+
+
+// below this many bytes the skip table costs more than it saves
+static const size_t kHorspoolMinNeedle = 4;
+static const size_t kHorspoolMinHaystack = 256;
+
+const char* FindBytes(const char *haystack, size_t hlen,
+                      const char *needle, size_t nlen) {
+  if (nlen == 0) return haystack;
+  if (nlen > hlen) return NULL;
+
+  // libc's memchr is vectorized already, on bionic and glibc alike
+  if (nlen == 1) {
+    return static_cast<const char*>(memchr(haystack, needle[0], hlen));
+  }
+
+  const char *last = haystack + hlen - nlen;
+
+  if (nlen < kHorspoolMinNeedle || hlen < kHorspoolMinHaystack) {
+    const char *p = haystack;
+    while (p <= last) {
+      p = static_cast<const char*>(memchr(p, needle[0], last - p + 1));
+      if (!p) return NULL;
+      if (memcmp(p + 1, needle + 1, nlen - 1) == 0) return p;
+      p++;
+    }
+    return NULL;
+  }
+
+  // Boyer-Moore-Horspool, the skip comes from the byte under the needle's
+  // last position
+  size_t skip[256];
+  for (int i = 0; i < 256; i++) skip[i] = nlen;
+  for (size_t i = 0; i < nlen - 1; i++) {
+    skip[static_cast<uint8_t>(needle[i])] = nlen - 1 - i;
+  }
+
+  const uint8_t tail = static_cast<uint8_t>(needle[nlen - 1]);
+  for (const char *p = haystack; p <= last; ) {
+    uint8_t c = static_cast<uint8_t>(p[nlen - 1]);
+    if (c == tail && memcmp(p, needle, nlen - 1) == 0) return p;
+    p += skip[c];
+  }
+  return NULL;
+}
+
+}  // namespace node
@@ -0,0 +1,100 @@
+// Copyright (c) 2011, Code Aurora Forum. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to permit
+// persons to whom the Software is furnished to do so, subject to the
+// following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN
+// NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+// OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE
+// USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+#ifndef NODE_BUFFER_CODEC_H_
+#define NODE_BUFFER_CODEC_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+namespace node {
+
+// REQ: base64 and hex kernels behind Buffer's base64Slice/base64Write and
+// hexSlice/hexWrite, the ASCII scans behind the string conversions in
+// node_string.h and the byte search behind indexOf. The SSSE3 (x86, picked
+// at runtime via cpuid) or NEON (arm, when built for it) versions work on
+// whole blocks and hand the rest to the scalar ones, the output is the same
+// byte for byte either way. NODE_CODEC=scalar in the environment forces the
+// scalar kernels.
+
+extern const char base64_table[];
+extern const int unbase64_table[256];
+
+// "ssse3", "neon" or "scalar"
+const char* CodecKernels();
+
+static inline size_t Base64EncodedSize(size_t len) {
+  return (len + 2) / 3 * 4;
+}
+
+// dst gets Base64EncodedSize(len) chars, '=' padded
+void Base64Encode(const char *src, size_t len, char *dst);
+
+/**
+ * Decodes whole groups of 4 chars from the start of src for as long as they
+ * only hold alphabet chars, i.e. up to the first whitespace, padding, bad char
+ * or short tail.
+ * @return the number of chars consumed (a multiple of 4), dst got 3 bytes for
+ * every 4 of them
+ */
+size_t Base64DecodeGroups(const char *src, size_t len, char *dst);
+
+// dst gets 2 * len lowercase hex digits
+void HexEncode(const char *src, size_t len, char *dst);
+
+/**
+ * Decodes pairs of hex digits from the start of src (2 * pairs chars) up to
+ * the first pair that isn't two hex digits.
+ * @return the number of pairs decoded, i.e. bytes written to dst
+ */
+size_t HexDecodePairs(const uint16_t *src, size_t pairs, char *dst);
+
+/**
+ * What parseInt(c0 + c1, 16) makes of a pair HexDecodePairs stopped at
+ * (" f", "-1", "1g" ...), as stored into a byte.
+ * @return false where parseInt gives NaN
+ */
+bool HexParsePair(uint16_t c0, uint16_t c1, uint8_t *byte);
+
+// number of bytes before the first one that isn't ASCII
+size_t AsciiPrefix(const char *src, size_t len);
+
+/**
+ * Copies UTF-16 code units to dst as bytes up to the first one that isn't
+ * ASCII.
+ * @return the number of units copied
+ */
+size_t NarrowAscii(const uint16_t *src, size_t len, char *dst);
+
+// dst gets the low byte of every code unit (binary encoding)
+void NarrowLatin1(const uint16_t *src, size_t len, char *dst);
+
+/**
+ * Finds the first occurrence of needle in haystack, through memchr for a
+ * single byte and Boyer-Moore-Horspool for longer needles.
+ * @return the start of the match, haystack for an empty needle, NULL when
+ * there is none
+ */
+const char* FindBytes(const char *haystack, size_t hlen,
+                      const char *needle, size_t nlen);
+
+}  // namespace node
+#endif  // NODE_BUFFER_CODEC_H_
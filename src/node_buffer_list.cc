@@ -0,0 +1,282 @@
+// Copyright (c) 2011, Code Aurora Forum. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to permit
+// persons to whom the Software is furnished to do so, subject to the
+// following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN
+// NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+// OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE
+// USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+#include <node_buffer_list.h>
+#include <node_buffer.h>
+
+#include <string.h> // memcpy
+
+#define MIN(a,b) ((a) < (b) ? (a) : (b))
+
+namespace node {
+
+using namespace v8;
+
+static Persistent<String> length_symbol;
+Persistent<FunctionTemplate> BufferList::constructor_template;
+
+
+BufferList::~BufferList() {
+  Clear();
+}
+
+
+void BufferList::Clear() {
+  for (size_t i = 0; i < chunks_.size(); i++) {
+    chunks_[i].buffer.Dispose();
+    chunks_[i].buffer.Clear();
+  }
+  chunks_.clear();
+  length_ = 0;
+}
+
+
+const char* BufferList::Data(const Chunk &chunk) const {
+  return Buffer::Data(chunk.buffer) + chunk.start;
+}
+
+
+void BufferList::Consume(size_t length) {
+  length = MIN(length, length_);
+  length_ -= length;
+
+  while (length > 0) {
+    Chunk &head = chunks_.front();
+    if (length < head.length) {
+      head.start += length;
+      head.length -= length;
+      break;
+    }
+    length -= head.length;
+    head.buffer.Dispose();
+    head.buffer.Clear();
+    chunks_.pop_front();
+  }
+}
+
+
+size_t BufferList::CopyOut(char *dst, size_t start, size_t end) const {
+  end = MIN(end, length_);
+  size_t copied = 0;
+  size_t offset = 0; // of the current chunk in the list
+
+  for (size_t i = 0; i < chunks_.size() && offset < end; i++) {
+    const Chunk &chunk = chunks_[i];
+    size_t chunk_end = offset + chunk.length;
+    if (chunk_end > start) {
+      size_t from = start > offset ? start - offset : 0;
+      size_t to = MIN(end, chunk_end) - offset;
+      memcpy(dst + copied, Data(chunk) + from, to - from);
+      copied += to - from;
+    }
+    offset = chunk_end;
+  }
+  return copied;
+}
+
+
+#ifdef __POSIX__
+int BufferList::Iovecs(struct iovec *iov, int count, size_t skip) const {
+  int n = 0;
+  for (size_t i = 0; i < chunks_.size() && n < count; i++) {
+    const Chunk &chunk = chunks_[i];
+    if (skip >= chunk.length) {
+      skip -= chunk.length;
+      continue;
+    }
+    iov[n].iov_base = const_cast<char*>(Data(chunk)) + skip;
+    iov[n].iov_len = chunk.length - skip;
+    skip = 0;
+    n++;
+  }
+  return n;
+}
+#endif
+
+
+bool BufferList::HasInstance(Handle<Value> val) {
+  return !constructor_template.IsEmpty() &&
+         constructor_template->HasInstance(val);
+}
+
+
+Handle<Value> BufferList::New(const Arguments &args) {
+  if (!args.IsConstructCall()) {
+    return Node::FromConstructorTemplate(constructor_template, args);
+  }
+
+  HandleScope scope;
+  BufferList *list = new BufferList();
+  list->Wrap(args.This());
+
+  return args.This();
+}
+
+
+// var length = list.push(buffer, [start], [end]);
+Handle<Value> BufferList::Push(const Arguments &args) {
+  HandleScope scope;
+  BufferList *list = ObjectWrap::Unwrap<BufferList>(args.This());
+
+  if (!Buffer::HasInstance(args[0])) {
+    return ThrowException(Exception::TypeError(String::New(
+            "First argument must be a Buffer")));
+  }
+
+  Local<Object> buffer = args[0]->ToObject();
+  size_t length = Buffer::Length(buffer);
+  size_t start = args[1]->IsUndefined() ? 0 : args[1]->Uint32Value();
+  size_t end = args[2]->IsUndefined() ? length : args[2]->Uint32Value();
+
+  if (start > end || end > length) {
+    return ThrowException(Exception::RangeError(String::New(
+            "Bad start or end")));
+  }
+
+  if (start < end) {
+    Chunk chunk;
+    chunk.buffer = Persistent<Object>::New(buffer);
+    chunk.start = start;
+    chunk.length = end - start;
+    list->chunks_.push_back(chunk);
+    list->length_ += chunk.length;
+  }
+
+  return scope.Close(Integer::NewFromUnsigned(list->length_));
+}
+
+
+// list.consume(bytes);
+Handle<Value> BufferList::Consume(const Arguments &args) {
+  HandleScope scope;
+  BufferList *list = ObjectWrap::Unwrap<BufferList>(args.This());
+  list->Consume(args[0]->Uint32Value());
+  return Undefined();
+}
+
+
+// var bytesCopied = list.copy(target, targetStart, start, end);
+Handle<Value> BufferList::Copy(const Arguments &args) {
+  HandleScope scope;
+  BufferList *list = ObjectWrap::Unwrap<BufferList>(args.This());
+
+  if (!Buffer::HasInstance(args[0])) {
+    return ThrowException(Exception::TypeError(String::New(
+            "First argument must be a Buffer")));
+  }
+
+  Local<Object> target = args[0]->ToObject();
+  size_t target_length = Buffer::Length(target);
+  size_t target_start = args[1]->Uint32Value();
+  size_t start = args[2]->IsUndefined() ? 0 : args[2]->Uint32Value();
+  size_t end = args[3]->IsUndefined() ? list->length_ : args[3]->Uint32Value();
+
+  if (target_start > target_length) {
+    return ThrowException(Exception::RangeError(String::New(
+            "targetStart out of bounds")));
+  }
+  if (start > end) {
+    return ThrowException(Exception::RangeError(String::New(
+            "start > end")));
+  }
+
+  end = MIN(end, start + (target_length - target_start));
+  size_t copied = list->CopyOut(Buffer::Data(target) + target_start,
+                                start, end);
+
+  return scope.Close(Integer::NewFromUnsigned(copied));
+}
+
+
+// var hit = list.find(start, end);
+// [buffer, offset] when [start, end) of the list is buffer[offset...] of a
+// single chunk, null when it spans chunks or is out of range
+Handle<Value> BufferList::Find(const Arguments &args) {
+  HandleScope scope;
+  BufferList *list = ObjectWrap::Unwrap<BufferList>(args.This());
+
+  size_t start = args[0]->Uint32Value();
+  size_t end = args[1]->Uint32Value();
+  if (start >= end || end > list->length_) return Null();
+
+  size_t offset = 0;
+  for (size_t i = 0; i < list->chunks_.size(); i++) {
+    const Chunk &chunk = list->chunks_[i];
+    if (start < offset + chunk.length) {
+      if (end > offset + chunk.length) break;
+
+      Local<Array> hit = Array::New(2);
+      hit->Set(0, chunk.buffer);
+      hit->Set(1, Integer::NewFromUnsigned(chunk.start + start - offset));
+      return scope.Close(hit);
+    }
+    offset += chunk.length;
+  }
+  return Null();
+}
+
+
+// list.clear();
+Handle<Value> BufferList::Clear(const Arguments &args) {
+  HandleScope scope;
+  BufferList *list = ObjectWrap::Unwrap<BufferList>(args.This());
+  list->Clear();
+  return Undefined();
+}
+
+
+Handle<Value> BufferList::LengthGetter(Local<String> property,
+                                       const AccessorInfo &info) {
+  HandleScope scope;
+  BufferList *list = ObjectWrap::Unwrap<BufferList>(info.This());
+  return scope.Close(Integer::NewFromUnsigned(list->length_));
+}
+
+
+void BufferList::Initialize(Handle<Object> target) {
+  HandleScope scope;
+
+  length_symbol = NODE_PSYMBOL("length");
+
+  // proteus: created once, every context gets its own function from it
+  if (constructor_template.IsEmpty()) {
+    Local<FunctionTemplate> t = FunctionTemplate::New(BufferList::New);
+    constructor_template = Persistent<FunctionTemplate>::New(t);
+  }
+
+  constructor_template->InstanceTemplate()->SetInternalFieldCount(1);
+  constructor_template->SetClassName(String::NewSymbol("BufferList"));
+
+  NODE_SET_PROTOTYPE_METHOD(constructor_template, "push", BufferList::Push);
+  NODE_SET_PROTOTYPE_METHOD(constructor_template, "consume",
+                            BufferList::Consume);
+  NODE_SET_PROTOTYPE_METHOD(constructor_template, "copy", BufferList::Copy);
+  NODE_SET_PROTOTYPE_METHOD(constructor_template, "find", BufferList::Find);
+  NODE_SET_PROTOTYPE_METHOD(constructor_template, "clear", BufferList::Clear);
+
+  constructor_template->InstanceTemplate()->SetAccessor(length_symbol,
+      BufferList::LengthGetter);
+
+  target->Set(String::NewSymbol("BufferList"),
+              constructor_template->GetFunction());
+}
+
+}  // namespace node
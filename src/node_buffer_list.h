@@ -0,0 +1,107 @@
+// Copyright (c) 2011, Code Aurora Forum. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to permit
+// persons to whom the Software is furnished to do so, subject to the
+// following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN
+// NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+// OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE
+// USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+#ifndef NODE_BUFFER_LIST_H_
+#define NODE_BUFFER_LIST_H_
+
+#include <node.h>
+#include <node_object_wrap.h>
+#include <v8.h>
+
+#include <deque>
+
+#ifdef __POSIX__
+# include <sys/uio.h> // struct iovec
+#endif
+
+namespace node {
+
+/**
+ * REQ: A byte sequence made of references to other buffers (or ranges of
+ * them), for stream consumers that collect chunks and for vectored writes.
+ * Pushing a buffer doesn't copy it, bytes are only copied once, when they
+ * are gathered into a single buffer (copy, concat in lib/buffer.js) and not
+ * at all when the list goes to writev(2) through Iovecs.
+ *
+ * var list = new BufferList();
+ * list.push(buffer, [start], [end]);  // returns list.length
+ * list.consume(bytes);                // drops bytes off the front
+ * list.copy(target, targetStart, start, end);
+ * list.find(start, end);    // [buffer, offset] when one chunk holds it all
+ * list.clear();
+ */
+class BufferList : public ObjectWrap {
+ public:
+  static void Initialize(v8::Handle<v8::Object> target);
+  static bool HasInstance(v8::Handle<v8::Value> val);
+
+  // number of bytes in the list
+  size_t Length() const { return length_; }
+
+  // drops length bytes (at most Length()) off the front
+  void Consume(size_t length);
+
+  // copies the bytes in [start, end) to dst, returns how many that were
+  size_t CopyOut(char *dst, size_t start, size_t end) const;
+
+#ifdef __POSIX__
+  // iovecs handed to one writev(2), well below IOV_MAX (1024 on linux)
+  static const int kMaxIovecs = 128;
+
+  /**
+   * Points iov at the chunks, at most count of them, starting skip bytes
+   * into the list. The memory stays valid until the list is changed.
+   * @return the number of iovecs filled
+   */
+  int Iovecs(struct iovec *iov, int count, size_t skip) const;
+#endif
+
+ protected:
+  static v8::Persistent<v8::FunctionTemplate> constructor_template;
+
+  BufferList() : ObjectWrap(), length_(0) {}
+  ~BufferList();
+
+  static v8::Handle<v8::Value> New(const v8::Arguments &args);
+  static v8::Handle<v8::Value> Push(const v8::Arguments &args);
+  static v8::Handle<v8::Value> Consume(const v8::Arguments &args);
+  static v8::Handle<v8::Value> Copy(const v8::Arguments &args);
+  static v8::Handle<v8::Value> Find(const v8::Arguments &args);
+  static v8::Handle<v8::Value> Clear(const v8::Arguments &args);
+  static v8::Handle<v8::Value> LengthGetter(v8::Local<v8::String> property,
+                                            const v8::AccessorInfo &info);
+
+ private:
+  struct Chunk {
+    v8::Persistent<v8::Object> buffer; // keeps the memory alive
+    size_t start;                      // into the buffer's data
+    size_t length;
+  };
+
+  const char* Data(const Chunk &chunk) const;
+  void Clear();
+
+  std::deque<Chunk> chunks_;
+  size_t length_;
+};
+
+}  // namespace node
+#endif  // NODE_BUFFER_LIST_H_
@@ -23,6 +23,7 @@
 #include <node.h>
 #include <node_file.h>
 #include <node_buffer.h>
+#include <node_buffer_list.h>
 #ifdef __POSIX__
 # include <node_stat_watcher.h>
 #endif
@@ -38,6 +39,10 @@
 #include <string.h>
 #include <errno.h>
 #include <limits.h>
+#ifdef __POSIX__
+# include <sys/mman.h>
+# include <sys/uio.h>
+#endif
 
 #ifdef __MINGW32__
 # include <platform_win32.h>
@@ -920,6 +925,139 @@ static Handle<Value> Read(const Arguments& args) {
 }
 
 
+#ifdef __POSIX__
+// v8's limit on external array data, i.e. the largest buffer there can be
+static const int64_t kMaxMapLength = 0x3fffffff;
+
+// release_callback of the buffers MMap returns, hint is how far data is
+// past the start of the (page aligned) mapping
+static void Unmap(char *data, size_t length, void *hint) {
+  size_t delta = reinterpret_cast<size_t>(hint);
+  if (munmap(data - delta, length + delta) != 0) {
+    NODE_LOGE("%s, munmap(%p, %zu) failed, errno(%d)", __FUNCTION__,
+        data - delta, length + delta, errno);
+  }
+}
+
+/* REQ: buffer = fs.mmap(fd, offset, length, prot, flags, [advice])
+ * Maps length bytes of fd from offset and hands the mapping out as a buffer,
+ * munmap happens when the buffer is collected (Buffer::Adopt). offset does
+ * not have to be page aligned. For regular files length is cut at the end
+ * of the file, touching a page past the end would SIGBUS. advice is an
+ * array of MADV_* values given to madvise(2) one by one. Synchronous, the
+ * page faults happen later, where the buffer is read. Nothing stops JS from
+ * writing to the buffer, a mapping without PROT_WRITE then dies with
+ * SIGSEGV, that's why fs.mmap defaults to PROT_READ|PROT_WRITE and
+ * MAP_PRIVATE (copy-on-write, fine on a read-only fd).
+ */
+static Handle<Value> MMap(const Arguments& args) {
+  HandleScope scope;
+
+  if (args.Length() < 5 || !args[0]->IsInt32() || !args[1]->IsNumber() ||
+      !args[2]->IsNumber() || !args[3]->IsInt32() || !args[4]->IsInt32()) {
+    return THROW_BAD_ARGS;
+  }
+
+  int fd = args[0]->Int32Value();
+  int64_t offset = args[1]->IntegerValue();
+  int64_t length = args[2]->IntegerValue();
+  int prot = args[3]->Int32Value();
+  int flags = args[4]->Int32Value();
+
+  if (offset < 0 || length <= 0 ||
+      length > kMaxMapLength) {
+    return ThrowException(Exception::RangeError(
+          String::New("Offset or length out of range")));
+  }
+
+  struct stat s;
+  if (fstat(fd, &s) != 0) {
+    return ThrowException(ErrnoException(errno, "fstat"));
+  }
+  if (S_ISREG(s.st_mode)) {
+    if (offset >= s.st_size) {
+      return ThrowException(Exception::RangeError(
+            String::New("Offset is past the end of the file")));
+    }
+    length = MIN(length, static_cast<int64_t>(s.st_size) - offset);
+  }
+
+  static const int64_t page = sysconf(_SC_PAGESIZE);
+  size_t delta = static_cast<size_t>(offset % page);
+  size_t maplen = static_cast<size_t>(length) + delta;
+
+  void *map = mmap(NULL, maplen, prot, flags, fd, offset - delta);
+  if (map == MAP_FAILED) {
+    return ThrowException(ErrnoException(errno, "mmap"));
+  }
+
+  if (args[5]->IsArray()) {
+    Local<Array> advice = Local<Array>::Cast(args[5]);
+    for (uint32_t i = 0; i < advice->Length(); i++) {
+      // only a hint, a kernel that doesn't know it leaves the mapping as is
+      if (madvise(map, maplen, advice->Get(i)->Int32Value()) != 0) {
+        NODE_LOGW("%s, madvise(%d) failed, errno(%d)", __FUNCTION__,
+            advice->Get(i)->Int32Value(), errno);
+      }
+    }
+  }
+
+  Buffer *buffer = Buffer::Adopt(static_cast<char*>(map) + delta,
+      static_cast<size_t>(length), Unmap, reinterpret_cast<void*>(delta));
+  if (!buffer) {
+    return ThrowException(Exception::Error(
+          String::New("Could not create the buffer")));
+  }
+  return scope.Close(buffer->handle_);
+}
+#endif // __POSIX__
+
+
+#ifdef __POSIX__
+/* REQ: bytesWritten = fs.writev(fd, bufferList, skip, position)
+ * Writes the chunks of a BufferList (from skip bytes into it) with a single
+ * writev(2), or with one pwrite(2) per chunk at position when that is >= 0,
+ * so nothing gets concatenated first. Synchronous, writes at most
+ * BufferList::kMaxIovecs chunks, fs.writevSync calls it until everything is
+ * written.
+ */
+static Handle<Value> WriteV(const Arguments& args) {
+  HandleScope scope;
+
+  if (args.Length() < 2 || !args[0]->IsInt32() ||
+      !BufferList::HasInstance(args[1])) {
+    return THROW_BAD_ARGS;
+  }
+
+  int fd = args[0]->Int32Value();
+  BufferList *list = ObjectWrap::Unwrap<BufferList>(args[1]->ToObject());
+  size_t skip = args[2]->Uint32Value();
+  off_t pos = GET_OFFSET(args[3]);
+
+  struct iovec iov[BufferList::kMaxIovecs];
+  int count = list->Iovecs(iov, BufferList::kMaxIovecs, skip);
+
+  ssize_t written = 0;
+  if (pos < 0) {
+    written = count ? writev(fd, iov, count) : 0;
+  } else {
+    for (int i = 0; i < count; i++) {
+      ssize_t ret = pwrite(fd, iov[i].iov_base, iov[i].iov_len, pos + written);
+      if (ret < 0) {
+        if (written == 0) written = ret;
+        break;
+      }
+      written += ret;
+      if ((size_t)ret < iov[i].iov_len) break;
+    }
+  }
+
+  if (written < 0) return ThrowException(ErrnoException(errno, "writev"));
+  return scope.Close(Integer::New(written));
+}
+#endif // __POSIX__
+
+
 /* fs.chmod(path, mode);
  * Wrapper for chmod(1) / EIO_CHMOD
  */
@@ -1130,6 +1268,10 @@ void File::Initialize(Handle<Object> target) {
 #endif // __POSIX__
   NODE_SET_METHOD(target, "unlink", Unlink);
   NODE_SET_METHOD(target, "write", Write);
+#ifdef __POSIX__
+  NODE_SET_METHOD(target, "writev", WriteV);
+  NODE_SET_METHOD(target, "mmap", MMap);
+#endif // __POSIX__
 
   NODE_SET_METHOD(target, "chmod", Chmod);
 #ifdef __POSIX__
@@ -23,17 +23,92 @@
 #include "node.h"
 #include "node_natives.h"
 #include "node_string.h"
+#include "node_javascript.h"
 #include <string.h>
 #include <strings.h>
+#include <vector>
 
 using namespace v8;
 
 namespace node {
 
+// REQ: builtins are preparsed once per process, every node instance (page)
+// after the first one compiles them with the cached preparse data, indexed
+// like natives[]
+static std::vector<ScriptData*> preparse_cache;
+
 Handle<String> MainSource() {
   return BUILTIN_ASCII_ARRAY(node_native, sizeof(node_native)-1);
 }
 
+static int FindNative(const char *name) {
+  for (int i = 0; natives[i].name; i++) {
+    if (!strcmp(natives[i].name, name)) {
+      return i;
+    }
+  }
+  return -1;
+}
+
+static ScriptData* Preparse(int index, Handle<String> source) {
+  if (preparse_cache.empty()) {
+    int count = 0;
+    while (natives[count].name) count++;
+    preparse_cache.resize(count, 0);
+  }
+
+  if (!preparse_cache[index]) {
+    ScriptData *data = ScriptData::PreCompile(source);
+    if (data->HasError()) {
+      // let the compile report it
+      delete data;
+      return 0;
+    }
+    preparse_cache[index] = data;
+  }
+  return preparse_cache[index];
+}
+
+static Local<Script> CompileBuiltin(int index, Handle<String> source,
+                                    Handle<String> filename) {
+  ScriptOrigin origin(filename);
+  return Script::Compile(source, &origin, Preparse(index, source));
+}
+
+Local<Script> CompileMain() {
+  HandleScope scope;
+  int index = FindNative("node");
+  NODE_ASSERT(index >= 0 && natives[index].source == node_native);
+  return scope.Close(CompileBuiltin(index, MainSource(), IMMUTABLE_STRING("node.js")));
+}
+
+// process._compileNative(id, filename), returns the wrapped module function
+Handle<Value> CompileNative(const Arguments& args) {
+  HandleScope scope;
+
+  String::Utf8Value id(args[0]);
+  int index = *id ? FindNative(*id) : -1;
+  if (index < 0 || natives[index].source == node_native) {
+    return ThrowException(Exception::Error(String::New("No such native module")));
+  }
+
+  Local<String> source = String::Concat(IMMUTABLE_STRING(NATIVE_WRAPPER_HEAD),
+      String::Concat(BUILTIN_ASCII_ARRAY(natives[index].source, natives[index].source_len),
+        IMMUTABLE_STRING(NATIVE_WRAPPER_TAIL)));
+
+  TryCatch try_catch;
+  Local<Script> script = CompileBuiltin(index, source, args[1]->ToString());
+  if (script.IsEmpty()) {
+    return try_catch.ReThrow();
+  }
+
+  Local<Value> result = script->Run();
+  if (result.IsEmpty()) {
+    return try_catch.ReThrow();
+  }
+  return scope.Close(result);
+}
+
 void DefineJavaScript(v8::Handle<v8::Object> target, Node *n) {
   HandleScope scope;
 
@@ -23,7 +23,18 @@
 
 namespace node {
 class Node;
+
+// keep in sync with NativeModule.wrapper in src/node.js (Module.wrapper too)
+#define NATIVE_WRAPPER_HEAD \
+  "(function (process, exports, require, module, __filename, __dirname, Buffer) { "
+#define NATIVE_WRAPPER_TAIL "\n});"
+
 void DefineJavaScript(v8::Handle<v8::Object> target, Node *n);
 v8::Handle<v8::String> MainSource();
 
+// compile src/node.js / a lib/*.js builtin, with preparse data cached across
+// node instances
+v8::Local<v8::Script> CompileMain();
+v8::Handle<v8::Value> CompileNative(const v8::Arguments& args);
+
 }  // namespace node
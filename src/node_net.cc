@@ -22,6 +22,7 @@
 
 #include <node.h>
 #include <node_buffer.h>
+#include <node_buffer_list.h>
 #include <node_net.h>
 
 #include <v8.h>
@@ -34,6 +35,10 @@
 #include <unistd.h>
 #include <fcntl.h>
 
+#ifdef __linux__
+#include <sys/syscall.h> // __NR_accept4
+#endif
+
 #ifdef __MINGW32__
 # include <platform_win32.h>
 # include <platform_win32_winsock.h>
@@ -42,6 +47,7 @@
 #ifdef __POSIX__
 # include <sys/ioctl.h>
 # include <sys/socket.h>
+# include <sys/uio.h>
 # include <sys/un.h>
 # include <arpa/inet.h> /* inet_pton */
 # include <netdb.h>
@@ -638,6 +644,88 @@ static Handle<Value> Listen(const Arguments& args) {
 }
 
 
+// Accepts one connection from the listen queue of fd and makes it
+// nonblocking and close-on-exec, in a single accept4() on linux. Returns the
+// new fd, or -1 with *err / *syscall_name set.
+static int AcceptPeer(int fd, struct sockaddr_storage *address_storage,
+                      socklen_t *len, int *err, const char **syscall_name) {
+  *syscall_name = "accept";
+
+#ifdef __POSIX__
+#if defined(__linux__) && defined(__NR_accept4) && defined(SOCK_NONBLOCK)
+  static bool no_accept4 = false;
+
+  if (!no_accept4) {
+    int peer_fd = syscall(__NR_accept4, fd,
+                          (struct sockaddr*) address_storage, len,
+                          SOCK_NONBLOCK | SOCK_CLOEXEC);
+    if (peer_fd >= 0) {
+      // SO_REUSEADDR is meaningless on an accepted socket, accept4 did the
+      // rest of SetSockFlags
+      return peer_fd;
+    }
+    if (errno != ENOSYS) {
+      *err = errno;
+      return -1;
+    }
+    no_accept4 = true;
+  }
+#endif
+
+  int peer_fd = accept(fd, (struct sockaddr*) address_storage, len);
+
+  if (peer_fd < 0) {
+    *err = errno;
+    return -1;
+  }
+#else // __MINGW32__
+  SOCKET peer_handle = accept(_get_osfhandle(fd),
+                              (struct sockaddr*) address_storage, len);
+
+  if (peer_handle == INVALID_SOCKET) {
+    *err = WSAGetLastError();
+    return -1;
+  }
+
+  int peer_fd = _open_osfhandle(peer_handle, 0);
+#endif // __MINGW32__
+
+  if (!SetSockFlags(peer_fd)) {
+#ifdef __POSIX__
+    *err = errno;
+#else // __MINGW32__
+    *err = WSAGetLastError();
+#endif // __MINGW32__
+    *syscall_name = "fcntl";
+    close(peer_fd);
+    return -1;
+  }
+
+  return peer_fd;
+}
+
+
+// Nothing to accept right now, or a connection that went away before we
+// got to it. Either way not worth an exception.
+static inline bool IsAcceptRetry(int err) {
+#ifdef __POSIX__
+  return err == EAGAIN || err == EWOULDBLOCK || err == ECONNABORTED ||
+         err == EINTR;
+#else // __MINGW32__
+  return err == WSAEWOULDBLOCK || err == WSAECONNRESET;
+#endif // __MINGW32__
+}
+
+
+static inline bool IsAcceptDrained(int err) {
+#ifdef __POSIX__
+  return err == EAGAIN || err == EWOULDBLOCK;
+#else // __MINGW32__
+  return err == WSAEWOULDBLOCK;
+#endif // __MINGW32__
+}
+
+
 // var peerInfo = t.accept(server_fd);
 //
 //   peerInfo.fd
@@ -647,51 +735,68 @@ static Handle<Value> Listen(const Arguments& args) {
 // Returns a new nonblocking socket fd. If the listen queue is empty the
 // function returns null (wait for server_fd to become readable and try
 // again)
+//
+// var peers = t.accept(server_fd, max);
+//
+// Drains up to max connections in one call and returns an array of
+// peerInfo objects, empty when the listen queue was. Errors are only thrown
+// when nothing was accepted yet, otherwise the call returns what it has and
+// the error comes back on the next one.
 static Handle<Value> Accept(const Arguments& args) {
   HandleScope scope;
 
   FD_ARG(args[0])
 
   struct sockaddr_storage address_storage;
-  socklen_t len = sizeof(struct sockaddr_storage);
+  socklen_t len;
+  int err;
+  const char *syscall_name;
 
-#ifdef __POSIX__
-  int peer_fd = accept(fd, (struct sockaddr*) &address_storage, &len);
+  if (!args[1]->IsNumber()) {
+    len = sizeof(struct sockaddr_storage);
+    int peer_fd = AcceptPeer(fd, &address_storage, &len, &err, &syscall_name);
 
-  if (peer_fd < 0) {
-    if (errno == EAGAIN) return scope.Close(Null());
-    if (errno == ECONNABORTED) return scope.Close(Null());
-    return ThrowException(ErrnoException(errno, "accept"));
-  }
-#else // __MINGW32__
-  SOCKET peer_handle = accept(_get_osfhandle(fd), (struct sockaddr*) &address_storage, &len);
+    if (peer_fd < 0) {
+      if (IsAcceptRetry(err)) return scope.Close(Null());
+      return ThrowException(ErrnoException(err, syscall_name));
+    }
 
-  if (peer_handle == INVALID_SOCKET) {
-    int wsaErrno = WSAGetLastError();
-    if (wsaErrno == WSAEWOULDBLOCK) return scope.Close(Null());
-    return ThrowException(ErrnoException(wsaErrno, "accept"));
-  }
+    Local<Object> peer_info = Object::New();
 
-  int peer_fd = _open_osfhandle(peer_handle, 0);
-#endif // __MINGW32__
+    peer_info->Set(fd_symbol, Integer::New(peer_fd));
 
-  if (!SetSockFlags(peer_fd)) {
-#ifdef __POSIX__
-    int fcntl_errno = errno;
-#else // __MINGW32__
-    int fcntl_errno = WSAGetLastError();
-#endif // __MINGW32__
-    close(peer_fd);
-    return ThrowException(ErrnoException(fcntl_errno, "fcntl"));
+    ADDRESS_TO_JS(peer_info, address_storage, len);
+
+    return scope.Close(peer_info);
   }
 
-  Local<Object> peer_info = Object::New();
+  int max = args[1]->Int32Value();
+  Local<Array> peers = Array::New();
+  int count = 0;
+
+  // a bounded number of tries so that a stream of aborted connections
+  // can't keep us here
+  for (int i = 0; i < max; i++) {
+    len = sizeof(struct sockaddr_storage);
+    int peer_fd = AcceptPeer(fd, &address_storage, &len, &err, &syscall_name);
+
+    if (peer_fd < 0) {
+      if (IsAcceptDrained(err)) break;
+      if (IsAcceptRetry(err)) continue;
+      if (count > 0) break;
+      return ThrowException(ErrnoException(err, syscall_name));
+    }
 
-  peer_info->Set(fd_symbol, Integer::New(peer_fd));
+    Local<Object> peer_info = Object::New();
 
-  ADDRESS_TO_JS(peer_info, address_storage, len);
+    peer_info->Set(fd_symbol, Integer::New(peer_fd));
+
+    ADDRESS_TO_JS(peer_info, address_storage, len);
+
+    peers->Set(count++, peer_info);
+  }
 
-  return scope.Close(peer_info);
+  return scope.Close(peers);
 }
 
 
@@ -1011,6 +1116,45 @@ static Handle<Value> Write(const Arguments& args) {
 }
 
 
+#ifdef __POSIX__
+
+// REQ: var bytes = writev(fd, bufferList);
+//
+// Writes the chunks of a BufferList with one writev(2) and drops what was
+// written off the front of the list. Like write(), returns 0 when the
+// socket would block.
+static Handle<Value> WriteV(const Arguments& args) {
+  HandleScope scope;
+
+  FD_ARG(args[0])
+
+  if (!BufferList::HasInstance(args[1])) {
+    return ThrowException(Exception::TypeError(
+          String::New("Second argument should be a BufferList")));
+  }
+
+  BufferList *list = ObjectWrap::Unwrap<BufferList>(args[1]->ToObject());
+
+  struct iovec iov[BufferList::kMaxIovecs];
+  int count = list->Iovecs(iov, BufferList::kMaxIovecs, 0);
+  if (count == 0) return scope.Close(Integer::New(0));
+
+  ssize_t written = writev(fd, iov, count);
+
+  if (written < 0) {
+    if (errno == EAGAIN || errno == EINTR) {
+      return scope.Close(Integer::New(0));
+    }
+    return ThrowException(ErrnoException(errno, "writev"));
+  }
+
+  list->Consume(written);
+  return scope.Close(Integer::New(written));
+}
+
+#endif // __POSIX__
+
+
 #ifdef __POSIX__
 
 // var bytes = sendmsg(fd, buf, off, len, fd, flags);
@@ -1294,6 +1438,30 @@ static Handle<Value> SetNoDelay(const Arguments& args) {
 }
 
 
+// Lets several listening sockets, possibly in different processes, bind
+// the same address and port. The kernel spreads new connections over them.
+// Has to be set before bind().
+static Handle<Value> SetReusePort(const Arguments& args) {
+  HandleScope scope;
+
+  FD_ARG(args[0])
+
+#ifdef SO_REUSEPORT
+  int flags = args[1]->IsFalse() ? 0 : 1;
+
+  if (0 > setsockopt(fd, SOL_SOCKET, SO_REUSEPORT, (void *)&flags,
+      sizeof(flags))) {
+    return ThrowException(ErrnoException(errno, "setsockopt"));
+  }
+#else
+  return ThrowException(Exception::Error(
+        String::New("SO_REUSEPORT is not supported on this platform")));
+#endif
+
+  return Undefined();
+}
+
+
 static Handle<Value> SetKeepAlive(const Arguments& args) {
   int r;
   HandleScope scope;
@@ -1723,6 +1891,7 @@ void InitNet(Handle<Object> target) {
   NODE_SET_METHOD(target, "recvfrom", RecvFrom);
 
 #ifdef __POSIX__
+  NODE_SET_METHOD(target, "writev", WriteV);
   NODE_SET_METHOD(target, "sendMsg", SendMsg);
 
   recv_msg_template =
@@ -1746,6 +1915,7 @@ void InitNet(Handle<Object> target) {
   NODE_SET_METHOD(target, "socketError", SocketError);
   NODE_SET_METHOD(target, "toRead", ToRead);
   NODE_SET_METHOD(target, "setNoDelay", SetNoDelay);
+  NODE_SET_METHOD(target, "setReusePort", SetReusePort);
   NODE_SET_METHOD(target, "setBroadcast", SetBroadcast);
   NODE_SET_METHOD(target, "setTTL", SetTTL);
   NODE_SET_METHOD(target, "setKeepAlive", SetKeepAlive);
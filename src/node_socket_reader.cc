@@ -0,0 +1,255 @@
+// Copyright (c) 2011, Code Aurora Forum. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to permit
+// persons to whom the Software is furnished to do so, subject to the
+// following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN
+// NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+// OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE
+// USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+
+#include <node_socket_reader.h>
+
+#include <node.h>
+#include <node_buffer.h>
+#include <v8.h>
+
+#include <assert.h>
+#include <errno.h>
+#include <unistd.h>
+
+#ifdef __MINGW32__
+# include <platform_win32.h>
+# include <platform_win32_winsock.h>
+#endif
+
+namespace node {
+
+using namespace v8;
+
+// same sizes as the JS pool in net_legacy.js
+static const size_t kSlabSize = 40 * 1024;
+static const size_t kMinSlabSpace = 128;
+
+// a socket that never runs dry must not keep the loop to itself
+static const int kMaxReadsPerEvent = 16;
+
+Persistent<FunctionTemplate> SocketReader::constructor_template;
+
+static Persistent<String> ondata_symbol;
+static Persistent<String> onend_symbol;
+static Persistent<String> onerror_symbol;
+static Persistent<String> slab_symbol;
+static Persistent<String> slab_used_symbol;
+
+
+void SocketReader::Initialize(Handle<Object> target) {
+  HandleScope scope;
+
+  // proteus: the template is shared by all node instances
+  if (constructor_template.IsEmpty()) {
+    Local<FunctionTemplate> t = FunctionTemplate::New(SocketReader::New);
+    constructor_template = Persistent<FunctionTemplate>::New(t);
+    constructor_template->InstanceTemplate()->SetInternalFieldCount(1);
+    constructor_template->SetClassName(String::NewSymbol("SocketReader"));
+
+    NODE_SET_PROTOTYPE_METHOD(constructor_template, "start", SocketReader::Start);
+    NODE_SET_PROTOTYPE_METHOD(constructor_template, "stop", SocketReader::Stop);
+    NODE_SET_PROTOTYPE_METHOD(constructor_template, "set", SocketReader::Set);
+
+    ondata_symbol = NODE_PSYMBOL("ondata");
+    onend_symbol = NODE_PSYMBOL("onend");
+    onerror_symbol = NODE_PSYMBOL("onerror");
+    slab_symbol = NODE_PSYMBOL("socketReaderSlab");
+    slab_used_symbol = NODE_PSYMBOL("socketReaderSlabUsed");
+  }
+
+  target->Set(String::NewSymbol("SocketReader"),
+              constructor_template->GetFunction());
+}
+
+
+/**
+ * The slab of the current context with at least kMinSlabSpace bytes left,
+ * kept on the global so every node instance reads into its own buffers.
+ */
+static Local<Object> CurrentSlab(Handle<Object> global, size_t *used) {
+  Local<Value> slab_v = global->GetHiddenValue(slab_symbol);
+  if (!slab_v.IsEmpty() && slab_v->IsObject()) {
+    *used = global->GetHiddenValue(slab_used_symbol)->Uint32Value();
+    if (kSlabSize - *used >= kMinSlabSpace) return slab_v->ToObject();
+  }
+
+  // the old slab is left to the gc, ondata handlers may hold slices of it
+  Buffer *b = Buffer::New(kSlabSize);
+  Local<Object> slab = Local<Object>::New(b->handle_);
+  global->SetHiddenValue(slab_symbol, slab);
+  global->SetHiddenValue(slab_used_symbol, Integer::New(0));
+  *used = 0;
+  return slab;
+}
+
+
+void SocketReader::Callback(EV_P_ ev_io *w, int revents) {
+  SocketReader *reader = static_cast<SocketReader*>(w->data);
+  assert(w == &reader->watcher_);
+
+  NODE_LOGM("socket_reader readable (%p)", w);
+  reader->ReadLoop();
+}
+
+
+void SocketReader::ReadLoop() {
+  HandleScope scope;
+
+  // holds the reader while the handlers run, they may stop it and drop it
+  Local<Object> self = Local<Object>::New(handle_);
+  Context::Scope context(self->CreationContext());
+  Local<Object> global = Context::GetCurrent()->Global();
+
+  for (int i = 0; i < kMaxReadsPerEvent; i++) {
+    // not cached, a handler may have freed the reader and set it on
+    // another socket
+    int fd = watcher_.fd;
+    size_t used;
+    Local<Object> slab = CurrentSlab(global, &used);
+    char *data = Buffer::Data(slab) + used;
+    size_t length = kSlabSize - used;
+
+#ifdef __POSIX__
+    ssize_t bytes_read = read(fd, data, length);
+    int err = bytes_read < 0 ? errno : 0;
+    if (err == EINTR) continue;
+    if (err == EAGAIN || err == EWOULDBLOCK) return;
+#else // __MINGW32__
+    ssize_t bytes_read = recv(_get_osfhandle(fd), data, length, 0);
+    int err = bytes_read < 0 ? WSAGetLastError() : 0;
+    if (err == WSAEINTR) continue;
+    if (err == WSAEWOULDBLOCK) return;
+#endif
+
+    if (bytes_read < 0) {
+      Stop();
+      Local<Value> argv[1] = { ErrnoException(err, "read") };
+      Emit(onerror_symbol, 1, argv);
+      return;
+    }
+
+    if (bytes_read == 0) {
+      Stop();
+      Emit(onend_symbol, 0, NULL);
+      return;
+    }
+
+    size_t end = used + bytes_read;
+    global->SetHiddenValue(slab_used_symbol, Integer::NewFromUnsigned(end));
+
+    Local<Value> argv[3] = {
+      slab,
+      Integer::NewFromUnsigned(used),
+      Integer::NewFromUnsigned(end)
+    };
+    if (!Emit(ondata_symbol, 3, argv)) return;
+  }
+}
+
+
+bool SocketReader::Emit(Handle<String> name, int argc, Handle<Value> argv[]) {
+  Local<Value> callback_v = handle_->Get(name);
+  if (!callback_v->IsFunction()) {
+    Stop();
+    return false;
+  }
+
+  TryCatch try_catch;
+
+  Local<Function>::Cast(callback_v)->Call(handle_, argc, argv);
+
+  if (try_catch.HasCaught()) {
+    Node::FatalException(try_catch);
+    return false;
+  }
+
+  return ev_is_active(&watcher_);
+}
+
+
+Handle<Value> SocketReader::New(const Arguments& args) {
+  if (!args.IsConstructCall()) {
+    return Node::FromConstructorTemplate(constructor_template, args);
+  }
+
+  HandleScope scope;
+  SocketReader *reader = new SocketReader();
+  reader->Wrap(args.This());
+
+  return args.This();
+}
+
+
+Handle<Value> SocketReader::Start(const Arguments& args) {
+  HandleScope scope;
+  SocketReader *reader = ObjectWrap::Unwrap<SocketReader>(args.Holder());
+  reader->Start();
+  return Undefined();
+}
+
+
+Handle<Value> SocketReader::Stop(const Arguments& args) {
+  HandleScope scope;
+  SocketReader *reader = ObjectWrap::Unwrap<SocketReader>(args.Holder());
+  reader->Stop();
+  return Undefined();
+}
+
+
+void SocketReader::Start() {
+  if (!ev_is_active(&watcher_)) {
+    NODE_LOGM("socket_reader start (%p)", &watcher_);
+    ev_io_start(EV_DEFAULT_UC_ &watcher_);
+    Ref();
+  }
+}
+
+
+void SocketReader::Stop() {
+  if (ev_is_active(&watcher_)) {
+    NODE_LOGM("socket_reader stop (%p)", &watcher_);
+    ev_io_stop(EV_DEFAULT_UC_ &watcher_);
+    Unref();
+  }
+}
+
+
+// reader.set(fd), takes IOWatcher's set(fd, readable, writable) as well so
+// net_legacy.js can use either for a socket's _readWatcher
+Handle<Value> SocketReader::Set(const Arguments& args) {
+  HandleScope scope;
+
+  SocketReader *reader = ObjectWrap::Unwrap<SocketReader>(args.Holder());
+
+  if (!args[0]->IsInt32()) {
+    return ThrowException(Exception::TypeError(
+          String::New("First arg should be a file descriptor.")));
+  }
+
+  assert(!ev_is_active(&reader->watcher_));
+  ev_io_set(&reader->watcher_, args[0]->Int32Value(), EV_READ);
+
+  return Undefined();
+}
+
+
+}  // namespace node
@@ -0,0 +1,88 @@
+// Copyright (c) 2011, Code Aurora Forum. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to permit
+// persons to whom the Software is furnished to do so, subject to the
+// following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN
+// NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+// OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE
+// USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+
+#ifndef NODE_SOCKET_READER_H_
+#define NODE_SOCKET_READER_H_
+
+#include <node.h>
+#include <node_object_wrap.h>
+#include <ev.h>
+
+namespace node {
+
+/**
+ * REQ: Read side of a lib/net_legacy.js socket. Where an IOWatcher calls
+ * into JS on every readable event and JS then calls binding.read(), this
+ * reads the fd itself until EAGAIN, into a slab shared by all readers of
+ * the context, and hands every chunk to ondata(slab, start, end), the same
+ * arguments Socket.ondata gets. The fd stays owned by the socket (which
+ * closes it), the reader stops itself on EOF and errors.
+ *
+ * var reader = new SocketReader();
+ * reader.ondata = function(buffer, start, end) { ... };
+ * reader.onend = function() { ... };
+ * reader.onerror = function(e) { ... };
+ * reader.set(fd);
+ * reader.start();
+ */
+class SocketReader : public ObjectWrap {
+ public:
+  static void Initialize(v8::Handle<v8::Object> target);
+
+ protected:
+  static v8::Persistent<v8::FunctionTemplate> constructor_template;
+
+  SocketReader() : ObjectWrap() {
+    ev_init(&watcher_, SocketReader::Callback);
+    watcher_.data = this;
+  }
+
+  ~SocketReader() {
+    ev_io_stop(EV_DEFAULT_UC_ &watcher_);
+    assert(!ev_is_active(&watcher_));
+    assert(!ev_is_pending(&watcher_));
+  }
+
+  static v8::Handle<v8::Value> New(const v8::Arguments& args);
+  static v8::Handle<v8::Value> Start(const v8::Arguments& args);
+  static v8::Handle<v8::Value> Stop(const v8::Arguments& args);
+  static v8::Handle<v8::Value> Set(const v8::Arguments& args);
+
+ private:
+  static void Callback(EV_P_ ev_io *watcher, int revents);
+
+  void Start();
+  void Stop();
+  void ReadLoop();
+
+  /**
+   * Calls handle_[name](argv...), a missing handler stops the reader.
+   * @return false when the handler threw or the reader was stopped (paused,
+   * destroyed) from it
+   */
+  bool Emit(v8::Handle<v8::String> name, int argc, v8::Handle<v8::Value> argv[]);
+
+  ev_io watcher_;
+};
+
+}  // namespace node
+#endif  // NODE_SOCKET_READER_H_
@@ -20,6 +20,12 @@
 // USE OR OTHER DEALINGS IN THE SOFTWARE.
 
 #include "node_string.h"
+#include "node_buffer_codec.h"
+
+#include <stdlib.h> // malloc, free
+#include <string.h> // memcpy, memchr
+
+#define MIN(a,b) ((a) < (b) ? (a) : (b))
 
 namespace node {
 
@@ -36,4 +42,99 @@ Handle<String> ImmutableAsciiSource::CreateFromLiteral(
   return scope.Close(ret);
 }
 
+
+// below this String::New is as quick, v8 scans for ASCII itself and copying
+// into new space is cheap
+static const size_t kExternalMin = 1024;
+
+// chars per String::Write, into a buffer on the stack
+static const int kChunk = 1024;
+
+OwnedAsciiSource::OwnedAsciiSource(const char *src, size_t src_len)
+    : buffer_(static_cast<char*>(malloc(src_len))),
+      buf_len_(src_len) {
+  memcpy(buffer_, src, src_len);
+  V8::AdjustAmountOfExternalAllocatedMemory(buf_len_);
+}
+
+OwnedAsciiSource::~OwnedAsciiSource() {
+  free(buffer_);
+  V8::AdjustAmountOfExternalAllocatedMemory(-(int)buf_len_);
+}
+
+Local<String> NewAsciiString(const char *data, size_t length) {
+  if (length >= kExternalMin) {
+    return String::NewExternal(new OwnedAsciiSource(data, length));
+  }
+  return String::New(data, length);
+}
+
+Local<String> NewUtf8String(const char *data, size_t length) {
+  if (length >= kExternalMin && AsciiPrefix(data, length) == length) {
+    return NewAsciiString(data, length);
+  }
+  return String::New(data, length);
+}
+
+int WriteUtf8String(Handle<String> str, char *buffer, int capacity,
+                    int *nchars) {
+  const int len = str->Length();
+  const int end = (capacity == -1) ? len : MIN(len, capacity);
+
+  if (str->IsExternalAscii()) {
+    const char *data = str->GetExternalAsciiStringResource()->data();
+    if (AsciiPrefix(data, end) < (size_t)end) {
+      return str->WriteUtf8(buffer, capacity, nchars,
+                            String::HINT_MANY_WRITES_EXPECTED);
+    }
+    memcpy(buffer, data, end);
+  } else {
+    uint16_t chunk[kChunk];
+    for (int i = 0; i < end; i += kChunk) {
+      int n = MIN(kChunk, end - i);
+      str->Write(chunk, i, n, String::HINT_MANY_WRITES_EXPECTED);
+      if (NarrowAscii(chunk, n, buffer + i) < (size_t)n) {
+        // not ASCII, start over the slow way
+        return str->WriteUtf8(buffer, capacity, nchars,
+                              String::HINT_MANY_WRITES_EXPECTED);
+      }
+    }
+  }
+
+  // one byte per char, and the terminator when it fits like WriteUtf8 does
+  if (nchars) *nchars = end;
+  int written = end;
+  if (end == len && (capacity == -1 || end < capacity)) {
+    buffer[written++] = '\0';
+  }
+  return written;
+}
+
+int WriteOneByteString(Handle<String> str, char *buffer, int length,
+                       bool ascii) {
+  const int len = str->Length();
+  const int end = (length == -1) ? len : MIN(len, length);
+
+  if (str->IsExternalAscii()) {
+    memcpy(buffer, str->GetExternalAsciiStringResource()->data(), end);
+  } else {
+    uint16_t chunk[kChunk];
+    for (int i = 0; i < end; i += kChunk) {
+      int n = MIN(kChunk, end - i);
+      str->Write(chunk, i, n, String::HINT_MANY_WRITES_EXPECTED);
+      NarrowLatin1(chunk, n, buffer + i);
+    }
+  }
+
+  if (ascii) {
+    char *p = buffer;
+    while ((p = static_cast<char*>(memchr(p, '\0', buffer + end - p)))) {
+      *p++ = ' ';
+    }
+  }
+
+  if (length == -1 || end < length) buffer[end] = '\0';
+  return end;
+}
+
 }
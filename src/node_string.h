@@ -58,6 +58,46 @@ class ImmutableAsciiSource : public v8::String::ExternalAsciiStringResource {
   size_t buf_len_;
 };
 
+// REQ: string <-> bytes conversions with an ASCII fast path. Each gives
+// exactly what the V8 call it stands in for gives, ASCII goes through the
+// vector scans in node_buffer_codec.h and anything else through the V8 call.
+
+// ASCII data copied into an external string, for big strings that would
+// otherwise be copied into the V8 heap
+class OwnedAsciiSource : public v8::String::ExternalAsciiStringResource {
+ public:
+  OwnedAsciiSource(const char *src, size_t src_len);
+  ~OwnedAsciiSource();
+
+  const char *data() const {
+      return buffer_;
+  }
+
+  size_t length() const {
+      return buf_len_;
+  }
+
+ private:
+  char *buffer_;
+  size_t buf_len_;
+};
+
+// String::New(data, length) for data known to be ASCII
+v8::Local<v8::String> NewAsciiString(const char *data, size_t length);
+
+// String::New(data, length), i.e. data decoded as UTF-8
+v8::Local<v8::String> NewUtf8String(const char *data, size_t length);
+
+// str->WriteUtf8(buffer, capacity, nchars, HINT_MANY_WRITES_EXPECTED)
+int WriteUtf8String(v8::Handle<v8::String> str, char *buffer, int capacity,
+                    int *nchars);
+
+// str->WriteAscii(buffer, 0, length, HINT_MANY_WRITES_EXPECTED) when ascii,
+// which writes the low byte of each char and NULs as spaces. Otherwise the
+// same without the NUL replacement, i.e. the binary encoding.
+int WriteOneByteString(v8::Handle<v8::String> str, char *buffer, int length,
+                       bool ascii);
+
 }  // namespace node
 
 #endif  // SRC_NODE_STRING_H_
@@ -0,0 +1,171 @@
+// Copyright (c) 2011, Code Aurora Forum. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to permit
+// persons to whom the Software is furnished to do so, subject to the
+// following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN
+// NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+// OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE
+// USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+#include <node_string_decoder.h>
+#include <node_buffer.h>
+#include <node_string.h>
+
+#include <stdint.h>
+#include <string.h> // memcpy
+
+#define MIN(a,b) ((a) < (b) ? (a) : (b))
+
+namespace node {
+
+using namespace v8;
+
+Persistent<FunctionTemplate> StringDecoder::constructor_template;
+
+
+static inline Local<String> Join(Local<String> left, Local<String> right) {
+  if (left.IsEmpty()) return right;
+  if (right->Length() == 0) return left;
+  return String::Concat(left, right);
+}
+
+
+Local<String> StringDecoder::DecodeUtf8(const char *data, size_t length) {
+  Local<String> split;
+
+  if (needed_) {
+    size_t n = MIN(length, needed_ - received_);
+    memcpy(partial_ + received_, data, n);
+    received_ += n;
+    if (received_ < needed_) return String::Empty();
+
+    // decoded as it is, a malformed sequence gives what v8 makes of it
+    split = NewUtf8String(partial_, needed_);
+    received_ = needed_ = 0;
+    data += n;
+    length -= n;
+    if (length == 0) return split;
+  }
+
+  // does one of the last 3 bytes start a character that doesn't fit?
+  // see http://en.wikipedia.org/wiki/UTF-8#Description
+  size_t i = MIN(length, 3);
+  for (; i > 0; i--) {
+    uint8_t c = static_cast<uint8_t>(data[length - i]);
+    if (i == 1 && c >> 5 == 0x06) {        // 110XXXXX
+      needed_ = 2;
+      break;
+    }
+    if (i <= 2 && c >> 4 == 0x0E) {        // 1110XXXX
+      needed_ = 3;
+      break;
+    }
+    if (i <= 3 && c >> 3 == 0x1E) {        // 11110XXX
+      needed_ = 4;
+      break;
+    }
+  }
+
+  if (needed_) {
+    memcpy(partial_, data + length - i, i);
+    received_ = i;
+    length -= i;
+  }
+
+  return Join(split, length ? NewUtf8String(data, length) : String::Empty());
+}
+
+
+Local<String> StringDecoder::DecodeUcs2(const char *data, size_t length) {
+  Local<String> split;
+
+  if (received_) {
+    if (length == 0) return String::Empty();
+    partial_[1] = data[0];
+    uint16_t unit;
+    memcpy(&unit, partial_, sizeof(unit));
+    split = String::New(&unit, 1);
+    received_ = 0;
+    data++;
+    length--;
+  }
+
+  if (length & 1) {
+    partial_[0] = data[length - 1];
+    received_ = 1;
+    length--;
+  }
+
+  // unaligned like Buffer::Ucs2Slice
+  Local<String> rest = length ?
+      String::New(reinterpret_cast<const uint16_t*>(data), length / 2) :
+      String::Empty();
+  return Join(split, rest);
+}
+
+
+Handle<Value> StringDecoder::New(const Arguments &args) {
+  if (!args.IsConstructCall()) {
+    return Node::FromConstructorTemplate(constructor_template, args);
+  }
+
+  HandleScope scope;
+  StringDecoder *decoder = new StringDecoder(args[0]->BooleanValue());
+  decoder->Wrap(args.This());
+
+  return args.This();
+}
+
+
+// var string = decoder.write(buffer);
+Handle<Value> StringDecoder::Write(const Arguments &args) {
+  HandleScope scope;
+  StringDecoder *decoder = ObjectWrap::Unwrap<StringDecoder>(args.This());
+
+  if (!Buffer::HasInstance(args[0])) {
+    return ThrowException(Exception::TypeError(String::New(
+            "Argument must be a Buffer")));
+  }
+
+  Local<Object> buffer = args[0]->ToObject();
+  const char *data = Buffer::Data(buffer);
+  size_t length = Buffer::Length(buffer);
+
+  Local<String> string = decoder->ucs2_ ? decoder->DecodeUcs2(data, length)
+                                        : decoder->DecodeUtf8(data, length);
+  return scope.Close(string);
+}
+
+
+void StringDecoder::Initialize(Handle<Object> target) {
+  HandleScope scope;
+
+  // proteus: created once, every context gets its own function from it
+  if (constructor_template.IsEmpty()) {
+    Local<FunctionTemplate> t = FunctionTemplate::New(StringDecoder::New);
+    constructor_template = Persistent<FunctionTemplate>::New(t);
+  }
+
+  constructor_template->InstanceTemplate()->SetInternalFieldCount(1);
+  constructor_template->SetClassName(String::NewSymbol("StringDecoder"));
+
+  NODE_SET_PROTOTYPE_METHOD(constructor_template, "write",
+                            StringDecoder::Write);
+
+  target->Set(String::NewSymbol("StringDecoder"),
+              constructor_template->GetFunction());
+}
+
+}  // namespace node
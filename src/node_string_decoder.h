@@ -0,0 +1,66 @@
+// Copyright (c) 2011, Code Aurora Forum. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to permit
+// persons to whom the Software is furnished to do so, subject to the
+// following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN
+// NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+// OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE
+// USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+#ifndef NODE_STRING_DECODER_H_
+#define NODE_STRING_DECODER_H_
+
+#include <node.h>
+#include <node_object_wrap.h>
+#include <v8.h>
+
+namespace node {
+
+/**
+ * REQ: Incremental UTF-8 / UCS-2 decoding for lib/string_decoder.js. A
+ * character split across two buffers is kept here (at most 3 bytes of it)
+ * and prepended to the next write, everything else is decoded straight out
+ * of the buffer memory (through NewUtf8String, so ASCII takes the fast
+ * path). The UTF-8 output is what the JS decoder gave for the same input,
+ * UCS-2 carries an odd trailing byte over instead of dropping it.
+ *
+ * var decoder = new StringDecoder(ucs2);
+ * var string = decoder.write(buffer);
+ */
+class StringDecoder : public ObjectWrap {
+ public:
+  static void Initialize(v8::Handle<v8::Object> target);
+
+ protected:
+  static v8::Persistent<v8::FunctionTemplate> constructor_template;
+
+  StringDecoder(bool ucs2)
+      : ObjectWrap(), ucs2_(ucs2), received_(0), needed_(0) {}
+
+  static v8::Handle<v8::Value> New(const v8::Arguments &args);
+  static v8::Handle<v8::Value> Write(const v8::Arguments &args);
+
+ private:
+  v8::Local<v8::String> DecodeUtf8(const char *data, size_t length);
+  v8::Local<v8::String> DecodeUcs2(const char *data, size_t length);
+
+  bool ucs2_;
+  char partial_[4]; // bytes of the split character
+  size_t received_; // of partial_
+  size_t needed_;   // length of the split character, 0 when there is none
+};
+
+}  // namespace node
+#endif  // NODE_STRING_DECODER_H_
@@ -1,8 +1,20 @@
 #include <node.h>
 #include <node_buffer.h>
+#include <node_object_wrap.h>
 
-#define SLAB_SIZE (1024 * 1024)
+#include <vector>
+
+#define SLAB_SIZE (256 * 1024)
 #define MIN(a, b) ((a) < (b) ? (a) : (b))
+#define MAX(a, b) ((a) > (b) ? (a) : (b))
+
+// Read sizes follow what the socket delivers, between these
+#define MIN_READ_SIZE (1024)
+#define INITIAL_READ_SIZE (8 * 1024)
+#define MAX_READ_SIZE (64 * 1024)
+
+// Memory of collected slabs kept for the next one
+#define MAX_FREE_SLABS 4
 
 // Rules:
 //
@@ -40,15 +52,121 @@ namespace node {
 using namespace v8;
 
 static Persistent<Function> constructor;
-static size_t slab_used;
-static uv_tcp_t* handle_that_last_alloced;
 
-static Persistent<String> slab_sym;
+static Persistent<String> slab_allocator_sym;
 static Persistent<String> buffer_sym;
 static Persistent<String> write_queue_size_sym;
 
 class TCPWrap;
 
+// REQ: The read slabs of one context. Reads take consecutive pieces of the
+// current slab and give back what they didn't fill, a new slab is started
+// when a read doesn't fit anymore. Every slice JS makes of a slab keeps it
+// as its parent, so the slab Buffer is collected once the last of them is
+// gone, and its memory then goes to free_slabs for the next slab instead of
+// back to malloc.
+class SlabAllocator : public ObjectWrap {
+ public:
+  // the allocator of the context global belongs to, made on first use
+  static SlabAllocator* ForContext(Handle<Object> global) {
+    Local<Value> allocator_v = global->GetHiddenValue(slab_allocator_sym);
+    if (!allocator_v.IsEmpty() && allocator_v->IsObject()) {
+      return ObjectWrap::Unwrap<SlabAllocator>(allocator_v->ToObject());
+    }
+
+    // proteus: the template is shared by all node instances
+    if (allocator_template.IsEmpty()) {
+      allocator_template = Persistent<ObjectTemplate>::New(ObjectTemplate::New());
+      allocator_template->SetInternalFieldCount(1);
+    }
+
+    Local<Object> allocator_obj = allocator_template->NewInstance();
+    SlabAllocator* allocator = new SlabAllocator();
+    allocator->Wrap(allocator_obj);
+    global->SetHiddenValue(slab_allocator_sym, allocator_obj);
+    return allocator;
+  }
+
+  // owner: the handle object reading, its context gets the new slabs
+  uv_buf_t Alloc(Handle<Object> owner, size_t size) {
+    assert(size <= SLAB_SIZE);
+    if (slab_.IsEmpty() || SLAB_SIZE - used_ < size) {
+      Context::Scope context(owner->CreationContext());
+      NewSlab();
+    }
+
+    uv_buf_t buf;
+    buf.base = data_ + used_;
+    buf.len = size;
+    used_ += size;
+    return buf;
+  }
+
+  /**
+   * Gives back the part of buf the read didn't fill, if nothing was
+   * allocated after it.
+   * @return the slab buf is in
+   */
+  Local<Object> Shrink(uv_buf_t buf, size_t nread) {
+    assert(buf.base >= data_ && buf.base + buf.len <= data_ + SLAB_SIZE);
+    assert(nread <= buf.len);
+    if (buf.base + buf.len == data_ + used_) {
+      used_ -= buf.len - nread;
+    }
+    return Local<Object>::New(slab_);
+  }
+
+  size_t Offset(uv_buf_t buf) {
+    return buf.base - data_;
+  }
+
+ private:
+  SlabAllocator() : ObjectWrap(), data_(NULL), used_(0) {}
+
+  ~SlabAllocator() {
+    slab_.Dispose();
+  }
+
+  void NewSlab() {
+    char* data;
+    if (free_slabs.empty()) {
+      data = new char[SLAB_SIZE];
+    } else {
+      data = free_slabs.back();
+      free_slabs.pop_back();
+    }
+
+    // adopted, so v8 knows about the memory and collects old slabs in time
+    Buffer* b = Buffer::Adopt(data, SLAB_SIZE, RecycleSlab, NULL);
+    assert(b);
+
+    slab_.Dispose();
+    slab_ = Persistent<Object>::New(b->handle_);
+    data_ = data;
+    used_ = 0;
+  }
+
+  static void RecycleSlab(char* data, size_t length, void* hint) {
+    assert(length == SLAB_SIZE);
+    if (free_slabs.size() < MAX_FREE_SLABS) {
+      free_slabs.push_back(data);
+    } else {
+      delete [] data;
+    }
+  }
+
+  static Persistent<ObjectTemplate> allocator_template;
+  // process wide, slab memory isn't tied to a context
+  static std::vector<char*> free_slabs;
+
+  Persistent<Object> slab_;
+  char* data_;
+  size_t used_;
+};
+
+Persistent<ObjectTemplate> SlabAllocator::allocator_template;
+std::vector<char*> SlabAllocator::free_slabs;
+
 class ReqWrap {
  public:
   ReqWrap(uv_handle_t* handle, void* callback) {
@@ -84,15 +202,18 @@ class TCPWrap {
     NODE_SET_PROTOTYPE_METHOD(t, "readStart", ReadStart);
     NODE_SET_PROTOTYPE_METHOD(t, "readStop", ReadStop);
     NODE_SET_PROTOTYPE_METHOD(t, "write", Write);
+    NODE_SET_PROTOTYPE_METHOD(t, "writeBuffers", WriteBuffers);
     NODE_SET_PROTOTYPE_METHOD(t, "connect", Connect);
     NODE_SET_PROTOTYPE_METHOD(t, "shutdown", Shutdown);
     NODE_SET_PROTOTYPE_METHOD(t, "close", Close);
     NODE_SET_PROTOTYPE_METHOD(t, "bind6", Bind6);
+    NODE_SET_PROTOTYPE_METHOD(t, "setReusePort", SetReusePort);
     NODE_SET_PROTOTYPE_METHOD(t, "connect6", Connect6);
 
     constructor = Persistent<Function>::New(t->GetFunction());
 
-    slab_sym = Persistent<String>::New(String::NewSymbol("slab"));
+    slab_allocator_sym =
+      Persistent<String>::New(String::NewSymbol("slabAllocator"));
     buffer_sym = Persistent<String>::New(String::NewSymbol("buffer"));
     write_queue_size_sym =
       Persistent<String>::New(String::NewSymbol("writeQueueSize"));
@@ -114,7 +235,8 @@ class TCPWrap {
     return scope.Close(args.This());
   }
 
-  TCPWrap(Handle<Object> object) {
+  TCPWrap(Handle<Object> object)
+      : slab_allocator_(NULL), read_size_(INITIAL_READ_SIZE) {
     int r = uv_tcp_init(&handle_);
     handle_.data = this;
     assert(r == 0); // How do we proxy this error up to javascript?
@@ -175,6 +297,19 @@ class TCPWrap {
     return scope.Close(Integer::New(r));
   }
 
+  // must come before bind
+  static Handle<Value> SetReusePort(const Arguments& args) {
+    HandleScope scope;
+
+    UNWRAP
+
+    int r = uv_tcp_reuseport(&wrap->handle_, args[0]->IsFalse() ? 0 : 1);
+
+    if (r) SetErrno(uv_last_error().code);
+
+    return scope.Close(Integer::New(r));
+  }
+
   static Handle<Value> Listen(const Arguments& args) {
     HandleScope scope;
 
@@ -256,58 +391,36 @@ class TCPWrap {
     return scope.Close(Integer::New(r));
   }
 
-  static inline char* NewSlab(Handle<Object> global, Handle<Object> wrap_obj) {
-    Buffer* b = Buffer::New(SLAB_SIZE);
-    global->SetHiddenValue(slab_sym, b->handle_);
-    assert(Buffer::Length(b) == SLAB_SIZE);
-    slab_used = 0;
-    wrap_obj->SetHiddenValue(slab_sym, b->handle_);
-    return Buffer::Data(b);
-  }
-
   static uv_buf_t OnAlloc(uv_stream_t* handle, size_t suggested_size) {
     HandleScope scope;
 
     TCPWrap* wrap = static_cast<TCPWrap*>(handle->data);
     assert(&wrap->handle_ == (uv_tcp_t*)handle);
 
-    char* slab = NULL;
-   
-    // proteus: test-tcp-wrap-listen.js
-    Context::Scope context(wrap->object_->CreationContext());
-    NODE_ASSERT(Context::InContext());
-
-    Handle<Object> global = Context::GetCurrent()->Global();
-    Local<Value> slab_v = global->GetHiddenValue(slab_sym);
+    if (!wrap->slab_allocator_) {
+      // proteus: test-tcp-wrap-listen.js
+      Context::Scope context(wrap->object_->CreationContext());
+      NODE_ASSERT(Context::InContext());
 
-    if (slab_v.IsEmpty()) {
-      // No slab currently. Create a new one.
-      slab = NewSlab(global, wrap->object_);
-    } else {
-      // Use existing slab.
-      Local<Object> slab_obj = slab_v->ToObject();
-      slab = Buffer::Data(slab_obj);
-      assert(Buffer::Length(slab_obj) == SLAB_SIZE);
-      assert(SLAB_SIZE >= slab_used);
-
-      // If less than 64kb is remaining on the slab allocate a new one.
-      if (SLAB_SIZE - slab_used < 64 * 1024) {
-        slab = NewSlab(global, wrap->object_);
-      } else {
-        wrap->object_->SetHiddenValue(slab_sym, slab_obj);
-      }
+      // the handle keeps the allocator of its context alive
+      wrap->slab_allocator_ =
+          SlabAllocator::ForContext(Context::GetCurrent()->Global());
+      wrap->object_->SetHiddenValue(slab_allocator_sym,
+                                    wrap->slab_allocator_->handle_);
     }
 
-    uv_buf_t buf;
-    buf.base = slab + slab_used;
-    buf.len = MIN(SLAB_SIZE - slab_used, suggested_size);
-
-    wrap->slab_offset_ = slab_used;
-    slab_used += buf.len;
-
-    handle_that_last_alloced = (uv_tcp_t*)handle;
+    return wrap->slab_allocator_->Alloc(wrap->object_,
+                                        MIN(wrap->read_size_, suggested_size));
+  }
 
-    return buf;
+  // Doubles the read size while reads fill it, halves it while they use
+  // less than a quarter.
+  inline void AdaptReadSize(size_t nread, size_t len) {
+    if (nread == len) {
+      read_size_ = MIN(read_size_ * 2, MAX_READ_SIZE);
+    } else if (nread < read_size_ / 4) {
+      read_size_ = MAX(read_size_ / 2, MIN_READ_SIZE);
+    }
   }
 
   static void OnRead(uv_stream_t* handle, ssize_t nread, uv_buf_t buf) {
@@ -324,31 +437,26 @@ class TCPWrap {
     Context::Scope context(wrap->object_->CreationContext());
     NODE_ASSERT(Context::InContext());
 
-    // Remove the reference to the slab to avoid memory leaks;
-    Local<Value> slab_v = wrap->object_->GetHiddenValue(slab_sym);
-    wrap->object_->SetHiddenValue(slab_sym, v8::Null());
-
     if (nread < 0)  {
       // EOF or Error
-      if (handle_that_last_alloced == (uv_tcp_t*)handle) {
-        slab_used -= buf.len;
-      }
+      if (buf.base) wrap->slab_allocator_->Shrink(buf, 0);
 
       SetErrno(uv_last_error().code);
       Node::MakeCallback(wrap->object_, "onread", 0, NULL);
       return;
     }
 
-    assert(nread <= buf.len);
+    assert((size_t)nread <= buf.len);
 
-    if (handle_that_last_alloced == (uv_tcp_t*)handle) {
-      slab_used -= (buf.len - nread);
-    }
+    Local<Object> slab = wrap->slab_allocator_->Shrink(buf, nread);
 
     if (nread > 0) {
+      // (0 is EAGAIN, it says nothing about the size of the data)
+      wrap->AdaptReadSize(nread, buf.len);
+
       Local<Value> argv[3] = {
-        slab_v,
-        Integer::New(wrap->slab_offset_),
+        slab,
+        Integer::New(wrap->slab_allocator_->Offset(buf)),
         Integer::New(nread)
       };
       Node::MakeCallback(wrap->object_, "onread", 3, argv);
@@ -449,6 +557,66 @@ class TCPWrap {
     }
   }
 
+  // var req = handle.writeBuffers([buffer, buffer, ...]);
+  // One request (one ReqWrap, one uv_write) for all the buffers, they are
+  // kept alive by the array until AfterWrite, which hands it to oncomplete
+  // where write() passes the buffer.
+  static Handle<Value> WriteBuffers(const Arguments& args) {
+    HandleScope scope;
+
+    UNWRAP
+
+    if (!args[0]->IsArray()) {
+      SetErrno(UV_EINVAL);
+      return scope.Close(v8::Null());
+    }
+
+    Local<Array> buffers = Local<Array>::Cast(args[0]);
+    uint32_t count = buffers->Length();
+
+    if (count == 0) {
+      SetErrno(UV_EINVAL);
+      return scope.Close(v8::Null());
+    }
+
+    // uv_write copies the uv_buf_t array, this one only has to last the call
+    uv_buf_t bufs_small[16];
+    std::vector<uv_buf_t> bufs_large;
+    uv_buf_t* bufs = bufs_small;
+    if (count > sizeof(bufs_small) / sizeof(bufs_small[0])) {
+      bufs_large.resize(count);
+      bufs = &bufs_large[0];
+    }
+
+    for (uint32_t i = 0; i < count; i++) {
+      Local<Value> buffer_v = buffers->Get(i);
+      if (!Buffer::HasInstance(buffer_v)) {
+        SetErrno(UV_EINVAL);
+        return scope.Close(v8::Null());
+      }
+      Local<Object> buffer_obj = buffer_v->ToObject();
+      bufs[i].base = Buffer::Data(buffer_obj);
+      bufs[i].len = Buffer::Length(buffer_obj);
+    }
+
+    ReqWrap* req_wrap = new ReqWrap((uv_handle_t*) &wrap->handle_,
+                                    (void*)AfterWrite);
+
+    req_wrap->object_->SetHiddenValue(buffer_sym, buffers);
+
+    int r = uv_write(&req_wrap->req_, bufs, count);
+
+    wrap->UpdateWriteQueueSize();
+
+    if (r) {
+      SetErrno(uv_last_error().code);
+      delete req_wrap;
+      return scope.Close(v8::Null());
+    } else {
+      return scope.Close(req_wrap->object_);
+    }
+  }
+
   static void AfterConnect(uv_req_t* req, int status) {
     ReqWrap* req_wrap = (ReqWrap*) req->data;
     TCPWrap* wrap = (TCPWrap*) req->handle->data;
@@ -572,7 +740,8 @@ class TCPWrap {
 
   uv_tcp_t handle_;
   Persistent<Object> object_;
-  size_t slab_offset_;
+  SlabAllocator* slab_allocator_;
+  size_t read_size_;
   friend class ReqWrap;
 };
 
@@ -0,0 +1,46 @@
+// Buffers over memory adopted from native code (Buffer::Adopt) read like any
+// other, count as external memory, and hand the memory back once collected
+var assert = require('assert');
+
+var SIZE = 1024 * 1024;
+var ROUNDS = 200; // 200mb adopted in total, far past what the gc lets live
+
+var before = test.bufferStats();
+
+var b = test.adoptBuffer(SIZE, 7);
+assert.equal(b.length, SIZE);
+assert.equal(b[0], 7);
+assert.equal(b[SIZE - 1], 7);
+b[10] = 42;
+assert.equal(b[10], 42);
+
+// the fast Buffer api works on top of it
+var fast = new Buffer(b, SIZE, 0);
+assert.equal(fast.slice(8, 12).toString('hex'), '07072a07');
+
+var during = test.bufferStats();
+assert.ok(during.adopted >= before.adopted + SIZE);
+assert.ok(during.external >= before.external + SIZE);
+b = fast = null;
+
+var round = 0;
+var maxAdopted = 0;
+function churn() {
+  var a = test.adoptBuffer(SIZE, round & 0xff);
+  assert.equal(a[SIZE >> 1], round & 0xff);
+  maxAdopted = Math.max(maxAdopted, test.bufferStats().adopted);
+
+  if (++round < ROUNDS) {
+    setTimeout(churn, 0);
+  }
+}
+churn();
+
+process.on('exit', function() {
+  var after = test.bufferStats();
+  console.log('adopted max: ' + maxAdopted + ' now: ' + after.adopted +
+      ' external: ' + after.external);
+
+  // reported as external memory, so the gc collected them on the way
+  assert.ok(maxAdopted < ROUNDS * SIZE);
+});
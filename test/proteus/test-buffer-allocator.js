@@ -0,0 +1,40 @@
+// Buffer memory is recycled per size class, churning through buffers of the
+// sizes network and fs reads use should hardly ever go back to malloc
+var assert = require('assert');
+
+var SIZES = [8 * 1024, 16 * 1024, 40 * 1024, 64 * 1024];
+var ROUNDS = 1000; // ~128mb, enough for v8 to collect on external memory
+
+var before = test.bufferStats();
+var instance = test.instanceStats();
+
+var round = 0;
+function churn() {
+  SIZES.forEach(function(size) {
+    var b = new Buffer(size);
+    b.fill(round & 0xff);
+    assert.equal(b[size - 1], round & 0xff);
+  });
+
+  if (++round < ROUNDS) {
+    setTimeout(churn, 0);
+  }
+}
+churn();
+
+process.on('exit', function() {
+  var after = test.bufferStats();
+  var allocs = after.allocs - before.allocs;
+  var hits = after.hits - before.hits;
+  console.log('buffer allocs: ' + allocs + ' hits: ' + hits +
+      ' misses: ' + (after.misses - before.misses) +
+      ' cached: ' + after.cached + ' external: ' + after.external);
+  assert.ok(allocs >= ROUNDS * SIZES.length);
+
+  // the chunks of collected buffers come back for the next ones of their class
+  assert.ok(hits > 0);
+  assert.ok(after.cached <= SIZES.length * 1024 * 1024);
+
+  // allocated from this instance's callbacks, accounted to it
+  assert.ok(test.instanceStats().buffersMax > instance.buffersMax);
+});
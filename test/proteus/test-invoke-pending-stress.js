@@ -0,0 +1,47 @@
+// Queues thousands of timer and fs callbacks at once, run it through proteus
+// with DEADLINE=<ms> to have InvokePending drain them in slices
+// e.g. DEADLINE=2 MULTIPLE=1 PARALLEL=1 proteus test-invoke-pending-stress.js ...
+var assert = require('assert');
+var fs = require('fs');
+
+var TIMERS = 5000;
+var STATS = 2000;
+
+var timersFired = 0;
+var statsDone = 0;
+var lastFired = {};
+
+function onTimeout(timeout, seq) {
+  return function() {
+    // timers with the same timeout run in the order they were set, even
+    // when the drain stops half way through them
+    assert.ok(!(timeout in lastFired) || lastFired[timeout] < seq);
+    lastFired[timeout] = seq;
+    timersFired++;
+  };
+}
+
+for (var i = 0; i < TIMERS; i++) {
+  var timeout = i % 50;
+  setTimeout(onTimeout(timeout, i), timeout);
+}
+
+for (var i = 0; i < STATS; i++) {
+  fs.stat(__filename, function(err, stats) {
+    assert.ifError(err);
+    assert.ok(stats.isFile());
+    statsDone++;
+  });
+}
+
+process.on('exit', function() {
+  assert.equal(timersFired, TIMERS);
+  assert.equal(statsDone, STATS);
+
+  if (typeof test !== 'undefined' && test.loopStats) {
+    var loop = test.loopStats();
+    console.log('drains: ' + loop.drains + ' yields: ' + loop.yields +
+        ' max: ' + loop.drainMax.toFixed(3) + 'ms histogram: ' +
+        loop.drainHistogram.join(' '));
+  }
+});
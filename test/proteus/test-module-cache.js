@@ -0,0 +1,56 @@
+// Installed modules are cached (source and preparse data) across the node
+// instances, run with MULTIPLE=1 PARALLEL=1 and this test several times to
+// see the other instances hit the cache
+var assert = require('assert');
+var fs = require('fs');
+var util = require('./proteus-util.js');
+
+var name = 'test-module-cache-' + util.rands();
+var file = process.downloadPath + '/' + name + '.js';
+
+function load() {
+  test.clearDynamicModuleCache();
+  return require(name);
+}
+
+function stats() {
+  return test.moduleCacheStats();
+}
+
+// first load reads the file
+util.createFile(file, 'exports.value = 1;');
+var before = stats();
+assert.equal(load().value, 1);
+assert.equal(stats().misses, before.misses + 1);
+assert.equal(stats().entries, before.entries + 1);
+
+// unchanged, compiled from the cache
+before = stats();
+assert.equal(load().value, 1);
+assert.equal(stats().hits, before.hits + 1);
+assert.equal(stats().misses, before.misses);
+
+// changed on disk, read again
+util.createFile(file, 'exports.value = 22;');
+before = stats();
+assert.equal(load().value, 22);
+assert.equal(stats().misses, before.misses + 1);
+assert.equal(stats().entries, before.entries);
+
+// non ascii source and a shebang
+util.createFile(file, '#!/usr/bin/env node\nexports.value = "héllo ☃";');
+assert.equal(load().value, 'héllo ☃');
+
+// a reinstall drops it from the cache
+before = stats();
+process.invalidateModuleCache(file);
+assert.equal(stats().invalidated, before.invalidated + 1);
+assert.equal(stats().entries, before.entries - 1);
+assert.ok(stats().bytes < before.bytes);
+
+// syntax errors are still reported by the compile
+util.createFile(file, 'exports.value = ;');
+assert.throws(load);
+
+fs.unlinkSync(file);
+process.invalidateModuleCache(file);
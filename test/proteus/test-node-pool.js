@@ -0,0 +1,29 @@
+// Run through proteus with a pool of bootstrapped node instances, e.g.
+// NODE_POOL=2 MULTIPLE=1 PARALLEL=1 proteus test-node-pool.js test-node-pool.js ...
+var assert = require('assert');
+
+if (typeof test !== 'undefined' && test.poolStats) {
+  var pool = test.poolStats();
+  assert.ok(pool.refill === 'idle' || pool.refill === 'manual');
+  assert.ok(pool.ready <= pool.size);
+
+  // this instance was either handed out by the pool or bootstrapped on the spot
+  var instance = test.instanceStats();
+  if (pool.size > 0) {
+    assert.ok(pool.hits + pool.misses >= 1);
+  }
+  assert.ok(instance.startup > 0);
+  assert.ok(instance.attach >= 0);
+
+  // a pooled instance gets the page attached after its bootstrap
+  assert.equal(typeof process.url, 'string');
+  assert.equal(typeof process.window, 'object');
+
+  process.on('exit', function() {
+    var pool = test.poolStats();
+    console.log('pool size: ' + pool.size + ' ready: ' + pool.ready +
+        ' hits: ' + pool.hits + ' misses: ' + pool.misses +
+        ' refills: ' + pool.refills + ' (' + pool.refillTime.toFixed(3) + 'ms)' +
+        ' attach max: ' + pool.attachMax.toFixed(3) + 'ms');
+  });
+}
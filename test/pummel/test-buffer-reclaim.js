@@ -0,0 +1,66 @@
+// Copyright (c) 2011, Code Aurora Forum. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to permit
+// persons to whom the Software is furnished to do so, subject to the
+// following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN
+// NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+// OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE
+// USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+// Allocates and drops buffers for a while, the memory of the collected ones
+// has to be handed back (rss stays flat) rather than leak
+var assert = require('assert');
+var common = require('../common');
+
+var ROUNDS = 2000;
+var PER_ROUND = 16;
+var SIZE = 64 * 1024; // above the pool size, every one gets its own memory
+
+var round = 0;
+var baseline = 0;
+var maxRss = 0;
+
+function churn() {
+  for (var i = 0; i < PER_ROUND; i++) {
+    var b = new Buffer(SIZE);
+    b.fill(i);
+    new Buffer('dropped ' + i); // pooled
+  }
+
+  var rss = process.memoryUsage().rss;
+  if (++round == ROUNDS / 10) {
+    baseline = rss; // warmed up
+  }
+  maxRss = Math.max(maxRss, rss);
+
+  // back to the loop, the collected buffers are reclaimed between drains
+  if (round < ROUNDS) {
+    setTimeout(churn, 0);
+  }
+}
+churn();
+
+process.on('exit', function() {
+  var usage = process.memoryUsage();
+  console.error('allocated: %dmb rss baseline: %dmb max: %dmb external: %dkb',
+      Math.round(ROUNDS * PER_ROUND * SIZE / (1024 * 1024)),
+      Math.round(baseline / (1024 * 1024)), Math.round(maxRss / (1024 * 1024)),
+      Math.round(usage.external / 1024));
+  assert.equal(round, ROUNDS);
+
+  // 2gb went through, what is left is gc slack
+  assert.ok(maxRss < baseline + 32 * 1024 * 1024);
+  assert.ok(usage.external < 64 * 1024 * 1024);
+});
@@ -0,0 +1,127 @@
+// Copyright (c) 2011, Code Aurora Forum. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to permit
+// persons to whom the Software is furnished to do so, subject to the
+// following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN
+// NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+// OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE
+// USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+// utf8/ascii/binary conversions take a vector scan and a plain copy when the
+// data is ASCII (big strings come out external), everything else goes the
+// old way. Check both give what they gave before, around the sizes where the
+// fast path changes (chunks of 1024 chars, external strings from 1024 bytes).
+var common = require('../common');
+var assert = require('assert');
+
+var SlowBuffer = require('buffer').SlowBuffer;
+
+var SIZES = [0, 1, 15, 16, 17, 100, 1023, 1024, 1025, 2047, 2048, 2049, 5000];
+
+function makeString(n, high) {
+  var chars = [];
+  for (var i = 0; i < n; i++) chars.push(String.fromCharCode(32 + i % 95));
+  // one char above ASCII somewhere, latin1 or beyond
+  if (high && n) chars[Math.floor(n * 0.7)] = String.fromCharCode(high);
+  return chars.join('');
+}
+
+function utf8Bytes(s) {
+  var bytes = [];
+  for (var i = 0; i < s.length; i++) {
+    var c = s.charCodeAt(i);
+    if (c < 0x80) {
+      bytes.push(c);
+    } else if (c < 0x800) {
+      bytes.push(0xC0 | c >> 6, 0x80 | c & 0x3F);
+    } else {
+      bytes.push(0xE0 | c >> 12, 0x80 | c >> 6 & 0x3F, 0x80 | c & 0x3F);
+    }
+  }
+  return bytes;
+}
+
+function slowFrom(bytes, extra) {
+  var b = new SlowBuffer(bytes.length + extra);
+  b.fill(0xAA, 0, b.length);
+  for (var i = 0; i < bytes.length; i++) b[i] = bytes[i];
+  return b;
+}
+
+SIZES.forEach(function(n) {
+  [0, 0xE9, 0x20AC].forEach(function(high) {
+    var s = makeString(n, high);
+    var bytes = utf8Bytes(s);
+
+    // bytes -> string
+    var b = slowFrom(bytes, 0);
+    assert.equal(b.utf8Slice(0, bytes.length), s);
+    if (!high) {
+      assert.equal(b.asciiSlice(0, n), s);
+      assert.equal(b.binarySlice(0, n), s);
+    }
+    if (high == 0xE9) {
+      var latin1 = slowFrom(s.split('').map(function(c) {
+        return c.charCodeAt(0);
+      }), 0);
+      assert.equal(latin1.binarySlice(0, n), s);
+    }
+
+    // string -> bytes, with room to spare: the terminator utf8Write has
+    // always put after the string
+    var target = new SlowBuffer(bytes.length + 2);
+    target.fill(0xAA, 0, target.length);
+    assert.equal(target.utf8Write(s, 0), bytes.length);
+    assert.equal(SlowBuffer._charsWritten, n);
+    for (var i = 0; i < bytes.length; i++) assert.equal(target[i], bytes[i]);
+    assert.equal(target[bytes.length], 0);
+    assert.equal(target[bytes.length + 1], 0xAA);
+
+    // and cut short
+    if (n > 1) {
+      target.fill(0xAA, 0, target.length);
+      var max = Math.floor(bytes.length / 2);
+      var written = target.utf8Write(s, 0, max);
+      assert.ok(written <= max);
+      for (var i = 0; i < written; i++) assert.equal(target[i], bytes[i]);
+      assert.equal(target[max], 0xAA);
+    }
+
+    // strings that came out of a buffer (external when big) back into one
+    if (!high) {
+      var round = b.utf8Slice(0, n);
+      var back = new SlowBuffer(n);
+      assert.equal(back.utf8Write(round, 0), n);
+      assert.equal(back.utf8Slice(0, n), s);
+    }
+
+    // binary keeps the low byte of each char
+    var bin = new SlowBuffer(n + 1);
+    bin.fill(0xAA, 0, bin.length);
+    assert.equal(bin.binaryWrite(s, 0), n);
+    for (var i = 0; i < n; i++) assert.equal(bin[i], s.charCodeAt(i) & 0xFF);
+  });
+});
+
+// asciiWrite turns NULs into spaces
+var nul = new SlowBuffer(4);
+assert.equal(nul.asciiWrite('a\u0000b', 0), 3);
+assert.equal(nul.asciiSlice(0, 3), 'a b');
+
+// the strings behave like any other
+var big = new Buffer(makeString(4096)).toString();
+assert.equal(big.length, 4096);
+assert.equal(big.slice(0, 5), ' !"#$');
+assert.equal(JSON.parse(JSON.stringify({ s: big })).s, big);
@@ -0,0 +1,197 @@
+// Copyright (c) 2011, Code Aurora Forum. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to permit
+// persons to whom the Software is furnished to do so, subject to the
+// following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN
+// NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+// OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE
+// USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+// base64 and hex go through vectorized kernels for whole blocks and the scalar
+// code for the rest, check both against the plain implementations they
+// replaced, across block boundaries and with the odd chars in odd places
+var common = require('../common');
+var assert = require('assert');
+
+var SlowBuffer = require('buffer').SlowBuffer;
+
+console.log('codec kernels: ' + process.binding('buffer').codecKernels);
+
+var ALPHABET = 'ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/';
+
+function unbase64(c) {
+  if (c === '\n' || c === '\r' || c === ' ') return -2;
+  var i = ALPHABET.indexOf(c);
+  return c.length && i >= 0 ? i : -1;
+}
+
+function refBase64Encode(bytes) {
+  var out = '';
+  for (var i = 0; i < bytes.length; i += 3) {
+    var b0 = bytes[i], b1 = bytes[i + 1] || 0, b2 = bytes[i + 2] || 0;
+    out += ALPHABET[b0 >> 2] + ALPHABET[((b0 & 3) << 4) | (b1 >> 4)];
+    out += i + 1 < bytes.length ? ALPHABET[((b1 & 15) << 2) | (b2 >> 6)] : '=';
+    out += i + 2 < bytes.length ? ALPHABET[b2 & 63] : '=';
+  }
+  return out;
+}
+
+// the decode loop of Buffer::Base64Write as it was
+function refBase64Decode(s) {
+  var out = [], i = 0, a, b, c, d;
+  function skip() { while (i < s.length && unbase64(s[i]) < 0) i++; }
+  while (i < s.length) {
+    skip(); if (i >= s.length || s[i] === '=') break;
+    a = unbase64(s[i++]);
+    skip(); if (i >= s.length || s[i] === '=') break;
+    b = unbase64(s[i++]);
+    out.push(((a << 2) | ((b & 0x30) >> 4)) & 0xff);
+    skip(); if (i >= s.length || s[i] === '=') break;
+    c = unbase64(s[i++]);
+    out.push(((b & 0x0F) << 4 | (c & 0x3C) >> 2) & 0xff);
+    skip(); if (i >= s.length || s[i] === '=') break;
+    d = unbase64(s[i++]);
+    out.push(((c & 0x03) << 6 | (d & 0x3F)) & 0xff);
+  }
+  return out;
+}
+
+// hexSlice/hexWrite as they were in lib/buffer.js
+function refHexSlice(bytes) {
+  var out = '';
+  for (var i = 0; i < bytes.length; i++) {
+    out += (bytes[i] < 16 ? '0' : '') + bytes[i].toString(16);
+  }
+  return out;
+}
+
+function refHexWrite(target, string, offset) {
+  if (string.length % 2) throw new Error('Invalid hex string');
+  for (var i = 0; i < string.length / 2; i++) {
+    var byte = parseInt(string.substr(i * 2, 2), 16);
+    if (isNaN(byte)) throw new Error('Invalid hex string');
+    if (offset + i >= 0 && offset + i < target.length) {
+      target[offset + i] = byte & 0xff;
+    }
+  }
+  return i;
+}
+
+function randomBytes(n) {
+  var bytes = [];
+  for (var i = 0; i < n; i++) bytes.push(Math.floor(Math.random() * 256));
+  return bytes;
+}
+
+function toSlow(bytes, extra) {
+  var b = new SlowBuffer(bytes.length + (extra || 0));
+  b.fill(0xAA, 0, b.length);
+  for (var i = 0; i < bytes.length; i++) b[i] = bytes[i];
+  return b;
+}
+
+function contents(b) {
+  var out = [];
+  for (var i = 0; i < b.length; i++) out.push(b[i]);
+  return out;
+}
+
+function mangle(s, chars) {
+  var i = Math.floor(Math.random() * (s.length + 1));
+  var c = chars[Math.floor(Math.random() * chars.length)];
+  return s.slice(0, i) + c + s.slice(i + (Math.random() < 0.5 ? 1 : 0));
+}
+
+var LENGTHS = [];
+for (var n = 0; n < 140; n++) LENGTHS.push(n);
+[191, 192, 193, 255, 256, 257, 1000, 4095, 4096, 65537].forEach(function(n) {
+  LENGTHS.push(n);
+});
+
+LENGTHS.forEach(function(n) {
+  var bytes = randomBytes(n);
+  var slow = toSlow(bytes);
+
+  // encode, whole buffer and an unaligned window
+  var b64 = slow.base64Slice(0, n);
+  assert.equal(b64, refBase64Encode(bytes));
+  var hex = slow.hexSlice(0, n);
+  assert.equal(hex, refHexSlice(bytes));
+  if (n > 2) {
+    assert.equal(slow.base64Slice(1, n - 1),
+                 refBase64Encode(bytes.slice(1, n - 1)));
+    assert.equal(slow.hexSlice(1, n - 1), refHexSlice(bytes.slice(1, n - 1)));
+  }
+
+  // decode, clean and mangled; 8 spare bytes as some inputs decode to more
+  // than byteLength counts
+  var inputs = [b64, b64.replace(/=+$/, ''), b64.toLowerCase()];
+  for (var k = 0; k < 4; k++) {
+    inputs.push(mangle(b64, [' ', '\n', '\r', '=', '*', 'A']));
+  }
+  inputs.forEach(function(s) {
+    var expected = refBase64Decode(s);
+    var target = new SlowBuffer(Math.max(
+        SlowBuffer.byteLength(s, 'base64'), expected.length) + 8);
+    target.fill(0xAA, 0, target.length);
+    var written = target.base64Write(s, 0);
+    assert.equal(written, expected.length);
+    assert.deepEqual(contents(target).slice(0, written), expected);
+    assert.ok(contents(target).slice(written).every(function(v) {
+      return v === 0xAA;
+    }));
+  });
+
+  var hexInputs = [hex, hex.toUpperCase()];
+  for (var k = 0; k < 4; k++) {
+    hexInputs.push(mangle(hex, ['g', ' ', '-', '+', 'x', ' ', 'İ']));
+  }
+  hexInputs.forEach(function(s) {
+    [0, 3, -2, n - 1].forEach(function(offset) {
+      var expected = toSlow([], n + 4);
+      var actual = toSlow([], n + 4);
+      var expectedError = null, actualError = null, expectedRet, actualRet;
+      try {
+        expectedRet = refHexWrite(expected, s, offset);
+      } catch (e) {
+        expectedError = e.message;
+      }
+      try {
+        actualRet = actual.hexWrite(s, offset);
+      } catch (e) {
+        actualError = e.message;
+      }
+      assert.equal(actualError, expectedError);
+      assert.equal(actualRet, expectedRet);
+      assert.deepEqual(contents(actual), contents(expected));
+    });
+  });
+});
+
+// hexSlice keeps the argument handling of the js version
+var small = toSlow([1, 2, 255]);
+assert.equal(small.hexSlice(), '0102ff');
+assert.equal(small.hexSlice(1), '02ff');
+assert.equal(small.hexSlice(1, 0), '02ff');
+assert.equal(small.hexSlice(-1, 2), '0102');
+assert.equal(small.hexSlice(0, 100), '0102ff');
+assert.equal(small.hexSlice(2, 1), '');
+
+// lenient pairs parse the way parseInt parsed them
+var lenient = new SlowBuffer(4);
+assert.equal(lenient.hexWrite(' f1g-1+f', 0), 4);
+assert.deepEqual(contents(lenient), [15, 1, 255, 15]);
+assert.throws(function() { lenient.hexWrite('0x', 0); });
+assert.throws(function() { lenient.hexWrite('abc', 0); });
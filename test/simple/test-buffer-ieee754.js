@@ -0,0 +1,110 @@
+// Copyright (c) 2011, Code Aurora Forum. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to permit
+// persons to whom the Software is furnished to do so, subject to the
+// following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN
+// NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+// OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE
+// USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+// readFloat/readDouble/writeFloat/writeDouble go through native accessors,
+// check them bit for bit against buffer_ieee754.js (what they replaced), in
+// both byte orders and on pooled slices. The one difference is a double half
+// way between two floats, see the ties below
+var common = require('../common');
+var assert = require('assert');
+var IEEE754 = require('buffer_ieee754');
+
+var SlowBuffer = require('buffer').SlowBuffer;
+
+var seed = 1;
+function random() {
+  seed = (seed * 1103515245 + 12345) & 0x7fffffff;
+  return seed / 0x7fffffff;
+}
+
+function randomDouble() {
+  var exponent = Math.floor(random() * 300) - 150;
+  return (random() - 0.5) * Math.pow(2, exponent);
+}
+
+var specials = [0, -0, 1, -1, 1e-45, 1.4e-45, 3.4028234663852886e+38,
+                -3.4028234663852886e+38, 1.7976931348623157E+308, 5e-324,
+                Math.PI, 0.1];
+
+var buffer = new Buffer(20);
+var ref = [];
+
+function same(a, b) {
+  // -0 and 0 are different bytes
+  return a === b ? a !== 0 || 1 / a === 1 / b : a !== a && b !== b;
+}
+
+['big', 'little'].forEach(function(endian) {
+  for (var n = 0; n < 5000; n++) {
+    var value = n < specials.length ? specials[n] : randomDouble();
+    var offset = n % 13;
+
+    if (Math.abs(value) <= 3.4028234663852886e+38) {
+      buffer.fill(0xaa, 0, buffer.length);
+      buffer.writeFloat(value, offset, endian);
+      IEEE754.writeIEEE754(ref, value, 0, endian, 23, 4);
+      for (var i = 0; i < 4; i++) assert.equal(buffer[offset + i], ref[i]);
+      assert.equal(buffer[offset + 4], 0xaa);
+      if (offset) assert.equal(buffer[offset - 1], 0xaa);
+      assert.ok(same(buffer.readFloat(offset, endian),
+                     IEEE754.readIEEE754(ref, 0, endian, 23, 4)));
+    }
+
+    buffer.writeDouble(value, offset, endian);
+    IEEE754.writeIEEE754(ref, value, 0, endian, 52, 8);
+    for (var i = 0; i < 8; i++) assert.equal(buffer[offset + i], ref[i]);
+    assert.ok(same(buffer.readDouble(offset, endian), value));
+  }
+});
+
+// ties round to the even float, buffer_ieee754.js rounded them away from
+// zero (3f 80 00 01 for the first one)
+buffer.writeFloat(1 + Math.pow(2, -24), 0, 'big');
+assert.deepEqual([0x3f, 0x80, 0x00, 0x00], [buffer[0], buffer[1], buffer[2],
+                                            buffer[3]]);
+buffer.writeFloat(1 + 3 * Math.pow(2, -24), 0, 'big');
+assert.deepEqual([0x3f, 0x80, 0x00, 0x02], [buffer[0], buffer[1], buffer[2],
+                                            buffer[3]]);
+buffer.writeFloat(-(1 + Math.pow(2, -24)), 0, 'little');
+assert.deepEqual([0x00, 0x00, 0x80, 0xbf], [buffer[0], buffer[1], buffer[2],
+                                            buffer[3]]);
+
+// NaN and the infinities read back from raw bytes
+buffer[0] = 0x7f; buffer[1] = 0xc0; buffer[2] = 0; buffer[3] = 0;
+assert.ok(isNaN(buffer.readFloat(0, 'big')));
+buffer[0] = 0; buffer[1] = 0; buffer[2] = 0x80; buffer[3] = 0xff;
+assert.equal(buffer.readFloat(0, 'little'), -Infinity);
+
+// the checks stay in front of the native calls
+assert.throws(function() { buffer.readDouble(13, 'big'); });
+assert.throws(function() { buffer.readFloat(-1, 'big'); });
+assert.throws(function() { buffer.writeFloat(1, -1, 'little'); });
+assert.throws(function() { buffer.writeFloat(1e39, 0, 'little'); });
+assert.throws(function() { buffer.readFloat(0, 'middle'); });
+
+// and the native ones catch direct calls
+var slow = new SlowBuffer(8);
+assert.throws(function() { slow.readDoubleLE(1); }, RangeError);
+assert.throws(function() { slow.readFloatBE(-1); }, RangeError);
+assert.throws(function() { slow.writeFloatBE(1, 5); }, RangeError);
+slow.writeDoubleBE(Math.E, 0);
+assert.equal(slow[0], 0x40);
+assert.equal(slow.readDoubleBE(0), Math.E);
@@ -0,0 +1,122 @@
+// Copyright (c) 2011, Code Aurora Forum. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to permit
+// persons to whom the Software is furnished to do so, subject to the
+// following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN
+// NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+// OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE
+// USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+// indexOf goes through memchr for single bytes, memchr plus memcmp for short
+// needles and Boyer-Moore-Horspool for long ones, check all of them against
+// a plain loop, on pooled slices (offset != 0) and big buffers
+var common = require('../common');
+var assert = require('assert');
+
+var SlowBuffer = require('buffer').SlowBuffer;
+
+function refIndexOf(haystack, needle, from) {
+  outer:
+  for (var i = from; i + needle.length <= haystack.length; i++) {
+    for (var j = 0; j < needle.length; j++) {
+      if (haystack[i + j] !== needle[j]) continue outer;
+    }
+    return i;
+  }
+  return -1;
+}
+
+function refCompare(a, b) {
+  for (var i = 0; i < a.length && i < b.length; i++) {
+    if (a[i] !== b[i]) return a[i] < b[i] ? -1 : 1;
+  }
+  return a.length === b.length ? 0 : a.length < b.length ? -1 : 1;
+}
+
+var seed = 1;
+function random(n) {
+  seed = (seed * 1103515245 + 12345) & 0x7fffffff;
+  return seed % n;
+}
+
+function randomBuffer(length, alphabet) {
+  var b = new Buffer(length);
+  for (var i = 0; i < length; i++) b[i] = 0xf0 + random(alphabet);
+  return b;
+}
+
+[0, 1, 7, 100, 255, 256, 1000, 20000].forEach(function(size) {
+  for (var n = 0; n < 200; n++) {
+    var alphabet = 1 + random(4);
+    var haystack = randomBuffer(size, alphabet);
+    var needle = randomBuffer(random(2) ? random(6) : random(60), alphabet);
+    if (size > needle.length && random(2)) {
+      needle.copy(haystack, random(size - needle.length + 1));
+    }
+    var from = random(size + 2);
+    var expected = needle.length ? refIndexOf(haystack, needle, from) :
+                                   Math.min(from, size);
+    assert.equal(haystack.indexOf(needle, from), expected);
+    if (needle.length == 1) {
+      assert.equal(haystack.indexOf(needle[0], from), expected);
+    }
+  }
+});
+
+// matches that straddle the end of a pooled slice don't count
+var pooled = new Buffer('xxabcabcyy');
+var slice = pooled.slice(2, 7);
+assert.equal(slice.indexOf('abc'), 0);
+assert.equal(slice.indexOf('abc', 1), -1);
+assert.equal(slice.indexOf('a', -2), 3);
+assert.equal(slice.indexOf('y'), -1);
+assert.equal(slice.indexOf(0x61 + 256), 0);
+
+var text = new Buffer('--frontier\r\nbody\r\n--frontier--');
+assert.equal(text.indexOf('--frontier'), 0);
+assert.equal(text.indexOf('--frontier', 1), 18);
+assert.equal(text.indexOf(new Buffer('\r\n')), 10);
+assert.equal(text.indexOf(0x0a), 11);
+assert.equal(text.indexOf('626f6479', 'hex'), 12);
+assert.equal(text.indexOf('Ym9keQ==', 0, 'base64'), 12);
+assert.equal(text.indexOf('', 5), 5);
+assert.equal(text.indexOf('--', -3), 28);
+assert.equal(text.indexOf('missing'), -1);
+assert.throws(function() { text.indexOf({}); }, TypeError);
+
+var big = new SlowBuffer(100);
+big.fill(0x20, 0, 100);
+big[90] = 0x21;
+assert.equal(big.indexOf(0x21, 0, 100), 90);
+assert.equal(new Buffer(big, 100, 0).indexOf('!'), 90);
+
+// compare and equals
+for (var n = 0; n < 500; n++) {
+  var a = randomBuffer(random(10), 2);
+  var b = randomBuffer(random(10), 2);
+  assert.equal(a.compare(b), refCompare(a, b));
+  assert.equal(Buffer.compare(a, b), refCompare(a, b));
+  assert.equal(a.equals(b), refCompare(a, b) === 0);
+}
+
+var abc = new Buffer('abc');
+assert.ok(abc.equals(new Buffer('abc')));
+assert.ok(!abc.equals(new Buffer('abcd')));
+assert.equal(abc.compare(new Buffer('abcd')), -1);
+assert.equal(new Buffer('abd').compare(abc), 1);
+assert.equal(new Buffer(0).compare(new Buffer(0)), 0);
+assert.deepEqual([new Buffer('b'), new Buffer('ab'), new Buffer('a')]
+    .sort(Buffer.compare).map(String), ['a', 'ab', 'b']);
+assert.throws(function() { abc.equals('abc'); }, TypeError);
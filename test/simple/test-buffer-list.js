@@ -0,0 +1,133 @@
+// Copyright (c) 2011, Code Aurora Forum. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to permit
+// persons to whom the Software is furnished to do so, subject to the
+// following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN
+// NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+// OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE
+// USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+var common = require('../common');
+var assert = require('assert');
+var fs = require('fs');
+var path = require('path');
+
+var BufferList = require('buffer').BufferList;
+
+function bytes(list) {
+  var out = [];
+  for (var i = 0; i < list.length; i++) out.push(list[i]);
+  return out;
+}
+
+var list = new BufferList();
+assert.equal(list.length, 0);
+assert.equal(list.concat().length, 0);
+assert.equal(list.slice().length, 0);
+
+var a = new Buffer('hello ');
+var b = new Buffer('big wide ');
+var c = new Buffer('world');
+assert.equal(list.push(a), 6);
+assert.equal(list.push(b, 4), 11);    // 'wide '
+assert.equal(list.push(c, 0, 5), 16);
+assert.equal(list.push(c, 2, 2), 16); // empty ranges are dropped
+assert.equal(list.length, 16);
+assert.equal(list.toString(), 'hello wide world');
+assert.equal(list.toString('ascii', 4, 8), 'o wi');
+
+// every range against the flat copy
+var flat = bytes(list.concat());
+for (var start = 0; start <= list.length; start++) {
+  for (var end = start; end <= list.length + 1; end++) {
+    var expected = flat.slice(start, end);
+    assert.deepEqual(bytes(list.concat(start, end)), expected);
+    assert.deepEqual(bytes(list.slice(start, end)), expected);
+
+    var target = new Buffer(20);
+    target.fill(0, 0, target.length);
+    var copied = list.copy(target, 3, start, end);
+    assert.equal(copied, expected.length);
+    assert.deepEqual(bytes(target.slice(3, 3 + copied)), expected);
+  }
+}
+
+// slices within one chunk share its memory
+var within = list.slice(6, 10);
+assert.equal(within.toString(), 'wide');
+b[4] = 0x57; // 'W'
+assert.equal(within.toString(), 'Wide');
+assert.equal(list.toString(), 'hello Wide world');
+var across = list.slice(4, 8);
+b[5] = 0x49; // 'I'
+assert.equal(across.toString(), 'o Wi');
+
+// copy stops at the end of the target
+var small = new Buffer(4);
+assert.equal(list.copy(small, 1), 3);
+assert.equal(small.toString('ascii', 1), 'hel');
+
+// consume drops whole and partial chunks off the front
+list.consume(3);
+assert.equal(list.length, 13);
+assert.equal(list.toString(), 'lo WIde world');
+list.consume(9);
+assert.equal(list.toString(), 'orld');
+list.consume(100);
+assert.equal(list.length, 0);
+
+list.push(a);
+list.clear();
+assert.equal(list.length, 0);
+
+assert.throws(function() { list.push('string'); }, TypeError);
+assert.throws(function() { list.push(a, 3, 2); }, RangeError);
+assert.throws(function() { list.push(a, 0, 7); }, RangeError);
+
+// many chunks, more than one writev call takes
+var file = path.join(common.tmpDir, 'buffer-list.txt');
+var many = new BufferList();
+var expected = '';
+for (var i = 0; i < 1000; i++) {
+  many.push(new Buffer(i + ','));
+  expected += i + ',';
+}
+
+var fd = fs.openSync(file, 'w');
+assert.equal(fs.writevSync(fd, many), expected.length);
+fs.closeSync(fd);
+assert.equal(fs.readFileSync(file, 'ascii'), expected);
+assert.equal(many.length, expected.length); // writevSync leaves it alone
+
+fd = fs.openSync(file, 'r+');
+var patch = new BufferList();
+patch.push(new Buffer('ab'));
+patch.push(new Buffer('cd'));
+assert.equal(fs.writevSync(fd, patch, 2), 4);
+fs.closeSync(fd);
+assert.equal(fs.readFileSync(file, 'ascii'),
+             expected.slice(0, 2) + 'abcd' + expected.slice(6));
+
+var readDone = false;
+fs.readFile(file, 'ascii', function(err, data) {
+  assert.ifError(err);
+  assert.equal(data, expected.slice(0, 2) + 'abcd' + expected.slice(6));
+  fs.unlinkSync(file);
+  readDone = true;
+});
+
+process.on('exit', function() {
+  assert.ok(readDone);
+});
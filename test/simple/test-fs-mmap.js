@@ -0,0 +1,89 @@
+// Copyright (c) 2011, Code Aurora Forum. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to permit
+// persons to whom the Software is furnished to do so, subject to the
+// following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN
+// NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+// OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE
+// USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+var common = require('../common');
+var assert = require('assert');
+var fs = require('fs');
+var path = require('path');
+
+var file = path.join(common.tmpDir, 'mmap.bin');
+var SIZE = 3 * 4096 + 123;
+
+var data = new Buffer(SIZE);
+for (var i = 0; i < SIZE; i++) data[i] = (i * 7) & 0xff;
+fs.writeFileSync(file, data);
+
+var fd = fs.openSync(file, 'r');
+
+// the whole file
+var all = fs.mmap(fd);
+assert.equal(all.length, SIZE);
+assert.equal(all.toString('base64'), data.toString('base64'));
+
+// offsets that are not page aligned, length cut at the end of the file
+[1, 4095, 4096, 4097, SIZE - 1].forEach(function(offset) {
+  var b = fs.mmap(fd, offset, SIZE, 'r', { advise: 'sequential' });
+  assert.equal(b.length, SIZE - offset);
+  for (var i = 0; i < b.length; i++) assert.equal(b[i], data[offset + i]);
+});
+
+var part = fs.mmap(fd, 100, 10, { advise: ['sequential', 'willneed'] });
+assert.equal(part.length, 10);
+assert.equal(part[0], data[100]);
+assert.equal(part[9], data[109]);
+
+// the default mapping is private and writable, even on a read-only fd
+all[0] = data[0] ^ 0xff;
+assert.equal(all[0], data[0] ^ 0xff);
+all[0] = data[0];
+
+// slices keep the mapping alive
+var slice = part.slice(2, 4);
+part = null;
+assert.equal(slice[0], data[102]);
+
+assert.equal(fs.mmap(fd, SIZE).length, 0);
+assert.throws(function() { fs.mmap(fd, SIZE, 1); }, RangeError);
+assert.throws(function() { fs.mmap(fd, -1, 1); }, RangeError);
+assert.throws(function() { fs.mmap(fd, 0, 1, 'r', { advise: 'soon' }); });
+// read-only fd can't be mapped shared and writable
+assert.throws(function() {
+  fs.mmap(fd, 0, 1, 'rw', { shared: true });
+}, /EACCES/);
+
+fs.closeSync(fd);
+// the mapping outlives the fd
+assert.equal(all[SIZE - 1], data[SIZE - 1]);
+
+// private mappings don't write through, shared ones do
+fd = fs.openSync(file, 'r+');
+var priv = fs.mmap(fd, 0, 16, 'rw');
+priv[0] = data[0] ^ 0xff;
+var shared = fs.mmap(fd, 0, 16, 'rw', { shared: true });
+assert.equal(shared[0], data[0]);
+shared[1] = data[1] ^ 0xff;
+fs.closeSync(fd);
+
+var back = fs.readFileSync(file);
+assert.equal(back[0], data[0]);
+assert.equal(back[1], data[1] ^ 0xff);
+
+fs.unlinkSync(file);
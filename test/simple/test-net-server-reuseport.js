@@ -0,0 +1,79 @@
+// Copyright (c) 2011, Code Aurora Forum. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to permit
+// persons to whom the Software is furnished to do so, subject to the
+// following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN
+// NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+// OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE
+// USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+// Two servers listen on one port with reusePort. A burst of clients gets
+// accepted in batches and spread over both; every one of them is served
+// exactly once.
+var common = require('../common');
+var assert = require('assert');
+var net = require('net');
+
+var CLIENTS = 200;
+
+var served = 0;
+var replies = 0;
+var listening = 0;
+var unsupported = false;
+
+function createServer() {
+  var server = net.createServer({ reusePort: true }, function(socket) {
+    served++;
+    socket.end('ok');
+  });
+  server.on('error', function(e) {
+    // no SO_REUSEPORT here (both servers fail the same way and are closed
+    // already), nothing to test
+    console.error('skipping: ' + e.message);
+    unsupported = true;
+  });
+  server.listen(common.PORT, '127.0.0.1', function() {
+    if (++listening == 2) connectClients();
+  });
+  return server;
+}
+
+var server1 = createServer();
+var server2 = createServer();
+
+function connectClients() {
+  for (var i = 0; i < CLIENTS; i++) {
+    var client = net.createConnection(common.PORT, '127.0.0.1');
+    client.setEncoding('ascii');
+    client.data = '';
+    client.on('data', function(d) {
+      this.data += d;
+    });
+    client.on('end', function() {
+      assert.equal('ok', this.data);
+      if (++replies == CLIENTS) {
+        server1.close();
+        server2.close();
+      }
+    });
+  }
+}
+
+process.on('exit', function() {
+  if (unsupported) return;
+  assert.equal(2, listening);
+  assert.equal(CLIENTS, served);
+  assert.equal(CLIENTS, replies);
+});
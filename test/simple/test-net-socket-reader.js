@@ -0,0 +1,82 @@
+// Copyright (c) 2011, Code Aurora Forum. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to permit
+// persons to whom the Software is furnished to do so, subject to the
+// following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN
+// NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+// OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE
+// USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+// tcp sockets are read by a native SocketReader: a payload much bigger than
+// its slab arrives intact through 'data' and ondata, pausing from a 'data'
+// listener stops the read loop and resume picks it up again
+var common = require('../common');
+var assert = require('assert');
+var net = require('net');
+
+var SIZE = 1024 * 1024;
+
+var payload = new Buffer(SIZE);
+for (var i = 0; i < SIZE; i++) payload[i] = (i * 7 + (i >> 10)) & 0xff;
+
+var received = new Buffer(SIZE);
+var receivedLength = 0;
+var ondataLength = 0;
+var pauses = 0;
+var ended = false;
+
+var server = net.createServer(function(socket) {
+  assert.ok(socket._readWatcher);
+
+  socket.ondata = function(buffer, start, end) {
+    assert.ok(start < end);
+    assert.ok(end <= buffer.length);
+    ondataLength += end - start;
+  };
+
+  socket.on('data', function(chunk) {
+    chunk.copy(received, receivedLength);
+    receivedLength += chunk.length;
+
+    if (pauses < 10) {
+      pauses++;
+      socket.pause();
+      setTimeout(function() { socket.resume(); }, 10);
+    }
+  });
+
+  socket.on('end', function() {
+    ended = true;
+    server.close();
+  });
+});
+
+server.listen(common.PORT, function() {
+  var client = net.createConnection(common.PORT);
+  client.on('connect', function() {
+    client.end(payload);
+  });
+});
+
+process.on('exit', function() {
+  assert.ok(ended);
+  assert.equal(pauses, 10);
+  assert.equal(receivedLength, SIZE);
+  assert.equal(ondataLength, SIZE);
+  for (var i = 0; i < SIZE; i++) {
+    if (received[i] !== payload[i]) assert.fail(received[i], payload[i],
+                                                'byte ' + i, '===');
+  }
+});
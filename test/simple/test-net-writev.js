@@ -0,0 +1,100 @@
+// Copyright (c) 2011, Code Aurora Forum. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to permit
+// persons to whom the Software is furnished to do so, subject to the
+// following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN
+// NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+// OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE
+// USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+// net's writev(fd, bufferList) on a nonblocking socketpair: more than the
+// socket buffer takes, so writes come back short and then 0 (EAGAIN), and
+// the list only loses what actually went out.
+var common = require('../common');
+var assert = require('assert');
+
+var binding = process.binding('net');
+var BufferList = require('buffer').BufferList;
+
+if (!binding.writev) {
+  console.error('skipping: no writev on this platform');
+  return;
+}
+
+var CHUNKS = 300;         // more than one writev takes
+var CHUNK_SIZE = 8 * 1024;
+
+var fds = binding.socketpair();
+var list = new BufferList();
+var expected = new Buffer(CHUNKS * CHUNK_SIZE);
+
+for (var i = 0; i < CHUNKS; i++) {
+  var chunk = new Buffer(CHUNK_SIZE);
+  for (var j = 0; j < CHUNK_SIZE; j++) chunk[j] = (i * 7 + j) & 0xff;
+  chunk.copy(expected, i * CHUNK_SIZE);
+  // a range of a bigger buffer, the iovec has to start at the offset
+  var padded = new Buffer(CHUNK_SIZE + 16);
+  chunk.copy(padded, 8);
+  list.push(padded, 8, 8 + CHUNK_SIZE);
+}
+
+var received = new Buffer(expected.length);
+var receivedLength = 0;
+var wouldBlock = 0;
+var shortWrites = 0;
+
+function drain() {
+  while (true) {
+    var n = binding.read(fds[1], received, receivedLength,
+                         received.length - receivedLength);
+    if (n === null) return;
+    assert.ok(n > 0);
+    receivedLength += n;
+  }
+}
+
+while (list.length > 0) {
+  var before = list.length;
+  var written = binding.writev(fds[0], list);
+  assert.equal(list.length, before - written);
+
+  if (written === 0) {
+    // the socket buffer is full, make room
+    wouldBlock++;
+    drain();
+  } else if (written < before) {
+    shortWrites++;
+  }
+}
+drain();
+
+assert.ok(wouldBlock > 0);
+assert.ok(shortWrites > 0);
+assert.equal(receivedLength, expected.length);
+for (var i = 0; i < expected.length; i++) {
+  if (received[i] !== expected[i]) {
+    assert.fail(received[i], expected[i], 'byte ' + i + ' differs', '===');
+  }
+}
+
+// an empty list writes nothing and doesn't touch the fd
+assert.equal(binding.writev(fds[0], new BufferList()), 0);
+
+assert.throws(function() {
+  binding.writev(fds[0], [new Buffer(1)]);
+}, TypeError);
+
+binding.close(fds[0]);
+binding.close(fds[1]);
@@ -0,0 +1,140 @@
+// Copyright (c) 2011, Code Aurora Forum. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to permit
+// persons to whom the Software is furnished to do so, subject to the
+// following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN
+// NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+// OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE
+// USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+// The native decoder against whole-buffer decoding and against the JS
+// decoder it replaced, with writes split at random points
+var common = require('../common');
+var assert = require('assert');
+var StringDecoder = require('string_decoder').StringDecoder;
+
+// lib/string_decoder.js as it was, for utf8
+function LegacyDecoder() {
+  this.charBuffer = new Buffer(4);
+  this.charReceived = 0;
+  this.charLength = 0;
+}
+
+LegacyDecoder.prototype.write = function(buffer) {
+  var charStr = '';
+  if (this.charLength) {
+    var i = (buffer.length >= this.charLength - this.charReceived) ?
+                this.charLength - this.charReceived :
+                buffer.length;
+    buffer.copy(this.charBuffer, this.charReceived, 0, i);
+    this.charReceived += i;
+    if (this.charReceived < this.charLength) return '';
+    charStr = this.charBuffer.slice(0, this.charLength).toString();
+    this.charReceived = this.charLength = 0;
+    if (i == buffer.length) return charStr;
+    buffer = buffer.slice(i, buffer.length);
+  }
+
+  var i = (buffer.length >= 3) ? 3 : buffer.length;
+  for (; i > 0; i--) {
+    var c = buffer[buffer.length - i];
+    if (i == 1 && c >> 5 == 0x06) { this.charLength = 2; break; }
+    if (i <= 2 && c >> 4 == 0x0E) { this.charLength = 3; break; }
+    if (i <= 3 && c >> 3 == 0x1E) { this.charLength = 4; break; }
+  }
+
+  if (!this.charLength) return charStr + buffer.toString();
+  buffer.copy(this.charBuffer, 0, buffer.length - i, buffer.length);
+  this.charReceived = i;
+  if (buffer.length - i > 0) {
+    return charStr + buffer.toString('utf8', 0, buffer.length - i);
+  }
+  return charStr;
+};
+
+var seed = 1;
+function random(n) {
+  seed = (seed * 1103515245 + 12345) & 0x7fffffff;
+  return seed % n;
+}
+
+function randomString(length) {
+  var s = '';
+  while (s.length < length) {
+    // 1, 2 and 3 byte characters, 4 byte ones are in the garbage below
+    switch (random(4)) {
+      case 0: s += String.fromCharCode(0x80 + random(0x780)); break;
+      case 1: s += String.fromCharCode(0x800 + random(0xd000)); break;
+      default: s += String.fromCharCode(0x20 + random(0x5f));
+    }
+  }
+  return s;
+}
+
+function splits(length) {
+  var points = [0];
+  var n = random(6);
+  for (var i = 0; i < n; i++) points.push(random(length + 1));
+  points.push(length);
+  return points.sort(function(a, b) { return a - b; });
+}
+
+function decode(decoder, buffer, points) {
+  var out = '';
+  for (var i = 1; i < points.length; i++) {
+    out += decoder.write(buffer.slice(points[i - 1], points[i]));
+  }
+  return out;
+}
+
+for (var n = 0; n < 2000; n++) {
+  // valid input decodes to what went in however it is split
+  var string = randomString(random(n < 1000 ? 20 : 2000));
+  var buffer = new Buffer(string, 'utf8');
+  var points = splits(buffer.length);
+  assert.equal(decode(new StringDecoder('utf8'), buffer, points), string);
+
+  var ucs2 = new Buffer(string, 'ucs2');
+  points = splits(ucs2.length);
+  assert.equal(decode(new StringDecoder('ucs2'), ucs2, points), string);
+
+  // anything else decodes like the JS decoder did
+  var garbage = new Buffer(random(40));
+  for (var i = 0; i < garbage.length; i++) {
+    garbage[i] = random(3) ? 0x80 + random(0x80) : random(0x80);
+    if (!random(8)) garbage[i] = 0xf0 + random(8);
+  }
+  points = splits(garbage.length);
+  assert.equal(decode(new StringDecoder('utf-8'), garbage, points),
+               decode(new LegacyDecoder(), garbage, points));
+}
+
+// an odd byte is held back rather than dropped
+var decoder = new StringDecoder('ucs-2');
+assert.equal(decoder.write(new Buffer([0x61])), '');
+assert.equal(decoder.write(new Buffer([0x00, 0x62])), 'a');
+assert.equal(decoder.write(new Buffer([0x00])), 'b');
+
+// long ASCII runs come out external (node_string.h), same text
+var ascii = new Array(5000).join('x');
+decoder = new StringDecoder('utf8');
+assert.equal(decoder.write(new Buffer(ascii + 'é').slice(0, 5000)),
+             ascii);
+assert.equal(decoder.write(new Buffer([0xa9])), 'é');
+
+// other encodings go through toString
+assert.equal(new StringDecoder('hex').write(new Buffer('ab')), '6162');
+assert.throws(function() { new StringDecoder('utf8').write('ab'); },
+              TypeError);
@@ -0,0 +1,115 @@
+// Copyright (c) 2011, Code Aurora Forum. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to permit
+// persons to whom the Software is furnished to do so, subject to the
+// following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN
+// NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+// OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE
+// USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+// Reads of several connections share the slabs of tcp_wrap: every slice
+// handed to onread must keep its bytes while later reads (and later slabs)
+// come in, with read sizes growing and shrinking along the way.
+var common = require('../common');
+var assert = require('assert');
+var net = require('net');
+
+var TCP = process.binding('tcp_wrap').TCP;
+
+var CLIENTS = 3;
+var BYTES = 2 * 1024 * 1024;
+
+function byteAt(client, i) {
+  return (i * 31 + client * 7 + (i >> 12)) & 0xff;
+}
+
+var server = new TCP();
+assert.equal(0, server.bind('0.0.0.0', common.PORT));
+server.listen(128);
+
+var slices = [];
+var received = {};
+var eofCount = 0;
+var lastSlab = null;
+var slabs = 0;
+
+server.onconnection = function(client) {
+  var id = null;
+  var offset = 0;
+
+  client.readStart();
+  client.onread = function(buffer, start, length) {
+    if (!buffer) {
+      client.close();
+      if (++eofCount == CLIENTS) server.close();
+      return;
+    }
+
+    assert.ok(length > 0);
+    assert.ok(start + length <= buffer.length);
+    if (buffer !== lastSlab) {
+      lastSlab = buffer;
+      slabs++;
+    }
+
+    var slice = buffer.slice(start, start + length);
+    if (id === null) id = slice[0];
+    slices.push({ id: id, offset: offset, slice: slice });
+    offset += length;
+    received[id] = offset;
+  };
+};
+
+for (var c = 0; c < CLIENTS; c++) {
+  (function(c) {
+    var socket = net.createConnection(common.PORT);
+    var sent = 0;
+
+    function pump() {
+      while (sent < BYTES) {
+        // small and large writes, so reads of every size show up
+        var size = Math.floor(sent / 4096) % 3 ? 100 : 32768;
+        size = Math.min(BYTES - sent, size);
+        var chunk = new Buffer(size);
+        for (var i = 0; i < size; i++) chunk[i] = byteAt(c, sent + i);
+        if (sent == 0) chunk[0] = c;
+        sent += size;
+        if (!socket.write(chunk)) return;
+      }
+      socket.end();
+    }
+
+    socket.on('connect', pump);
+    socket.on('drain', pump);
+  })(c);
+}
+
+process.on('exit', function() {
+  assert.equal(CLIENTS, eofCount);
+  assert.ok(slabs > 1);
+
+  for (var c = 0; c < CLIENTS; c++) assert.equal(BYTES, received[c]);
+
+  slices.forEach(function(s) {
+    for (var i = 0; i < s.slice.length; i++) {
+      var pos = s.offset + i;
+      var expected = pos == 0 ? s.id : byteAt(s.id, pos);
+      if (s.slice[i] !== expected) {
+        assert.fail(s.slice[i], expected, 'client ' + s.id + ' byte ' + pos,
+                    '===');
+      }
+    }
+  });
+});
@@ -0,0 +1,102 @@
+// Copyright (c) 2011, Code Aurora Forum. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to permit
+// persons to whom the Software is furnished to do so, subject to the
+// following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN
+// NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+// OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE
+// USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+var common = require('../common');
+var assert = require('assert');
+
+var TCP = process.binding('tcp_wrap').TCP;
+
+var server = new TCP();
+
+var r = server.bind('0.0.0.0', common.PORT);
+assert.equal(0, r);
+
+server.listen(128);
+
+var writeCount = 0;
+var callbackCount = 0;
+var received = '';
+
+// echoes everything back as one writeBuffers() of three slices
+server.onconnection = function(client) {
+  // not an array, empty or not all buffers: no request
+  assert.equal(null, client.writeBuffers(new Buffer(1)));
+  assert.equal(null, client.writeBuffers([]));
+  assert.equal(null, client.writeBuffers([new Buffer(1), 'x']));
+  assert.equal(0, client.writeQueueSize);
+
+  client.readStart();
+  client.pendingWrites = [];
+
+  client.onread = function(buffer, offset, length) {
+    if (!buffer) {
+      server.close();
+      if (client.pendingWrites.length == 0) client.close();
+      client.gotEOF = true;
+      return;
+    }
+
+    var half = offset + (length >> 1);
+    var buffers = [buffer.slice(offset, half),
+                   buffer.slice(half, half),
+                   buffer.slice(half, offset + length)];
+    var req = client.writeBuffers(buffers);
+    assert.ok(req);
+    client.pendingWrites.push(req);
+
+    req.oncomplete = function(status, client_, req_, buffers_) {
+      assert.equal(req, client.pendingWrites.shift());
+      assert.equal(0, status);
+      assert.equal(client, client_);
+      assert.equal(req, req_);
+      assert.equal(buffers, buffers_);
+      assert.equal(0, client.writeQueueSize);
+      writeCount++;
+      if (client.gotEOF && client.pendingWrites.length == 0) client.close();
+    };
+  };
+};
+
+var net = require('net_uv');
+
+var c = net.createConnection(common.PORT);
+// queued while connecting, sent corked on connect
+c.write('hello ');
+
+c.on('connect', function() {
+  c.cork();
+  c.write('corked ', function() { callbackCount++; });
+  c.write(new Buffer('world'), function() { callbackCount++; });
+  assert.equal(12, c.bufferSize);
+  c.uncork();
+  c.end();
+});
+
+c.setEncoding('utf8');
+c.on('data', function(d) {
+  received += d;
+});
+
+process.on('exit', function() {
+  assert.equal('hello corked world', received);
+  assert.equal(2, callbackCount);
+  assert.ok(writeCount >= 1);
+});